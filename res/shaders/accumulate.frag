@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec2 in_tex_coords;
+
+layout(location = 0) out vec4 out_color;
+
+// Frame raymarched into a corner of the image, which the extent covers in
+// texture coordinates
+layout(binding = 0) uniform sampler2D u_frame;
+
+layout(push_constant) uniform Region {
+    vec2 extent;
+} u_region;
+
+void main() {
+    // Stay half a texel within the frame, filtering would otherwise blend in
+    // stale texels beyond it
+    vec2 half_texel = 0.5 / vec2(textureSize(u_frame, 0));
+    vec2 uv = min(in_tex_coords * u_region.extent, u_region.extent - half_texel);
+
+    // Blending weighs the frame against the history
+    out_color = texture(u_frame, uv);
+}
\ No newline at end of file
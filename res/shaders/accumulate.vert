@@ -0,0 +1,9 @@
+#version 450
+
+layout(location = 0) out vec2 out_tex_coords;
+
+// A single triangle covering the whole image
+void main() {
+    out_tex_coords = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(out_tex_coords * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
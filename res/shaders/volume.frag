@@ -11,40 +11,149 @@ layout(binding = 0) uniform UniformBufferObject {
     vec3 camera_position;
     float min_density;
     float max_density;
+    float lod;
     vec3 min_slice;
     vec3 max_slice;
+    vec3 volume_size;
+    float fallback_level;
+    vec3 atlas_size;
+    uint paged;
+    uvec3 page_grid;
+    float min_transmittance;
+    uvec3 macrocell_grid;
+    vec3 macrocell_extent;
+    float step_size;
+    float opacity_correction;
 } u_ubo;
 layout(binding = 1) uniform sampler3D u_volume;
-layout(binding = 2) uniform sampler1D u_transfer_func;
+// Transfer function integrated between every front and back density, holding
+// the average color and extinction per voxel of the segment
+layout(binding = 2) uniform sampler2D u_transfer_func;
 
+// Volumes too large for the device page their finest level into an atlas
+layout(std430, binding = 3) readonly buffer PageTable {
+    uint entries[];
+} u_page_table;
+layout(std430, binding = 4) writeonly buffer PageFeedback {
+    uint sampled[];
+} u_page_feedback;
+layout(binding = 5) uniform sampler3D u_atlas;
+
+// Rays leap over macrocells whose whole density range the transfer function
+// leaves invisible
+layout(binding = 6) uniform sampler3D u_macrocells;
+layout(binding = 7) uniform sampler2D u_visibility;
+
+const float PAGE_SIZE = 64.0;
+const float PAGE_CONTENT_SIZE = PAGE_SIZE - 2.0;
+const uint PAGE_RESIDENT = 1u << 31;
+
+// Samples the finest level from the atlas where it is resident, falling back
+// to the coarser levels of the image elsewhere
+float sample_density(vec3 pos, inout uint last_page) {
+    if (u_ubo.paged != 0u && u_ubo.lod < 1.0) {
+        vec3 voxel = pos * u_ubo.volume_size;
+        uvec3 page = uvec3(clamp(floor((voxel - 0.5) / PAGE_CONTENT_SIZE),
+                                 vec3(0.0), vec3(u_ubo.page_grid - 1u)));
+        uint index = page.x + u_ubo.page_grid.x * (page.y + u_ubo.page_grid.y * page.z);
+
+        // Report the page once for every run of samples within it
+        if (index != last_page) {
+            u_page_feedback.sampled[index] = 1u;
+            last_page = index;
+        }
+
+        uint entry = u_page_table.entries[index];
+        if ((entry & PAGE_RESIDENT) != 0u) {
+            vec3 slot = vec3(entry & 0x3FFu, (entry >> 10) & 0x3FFu, (entry >> 20) & 0x3FFu);
+            vec3 atlas_pos = slot * PAGE_SIZE + voxel - vec3(page) * PAGE_CONTENT_SIZE + 1.0;
+            return textureLod(u_atlas, atlas_pos / u_ubo.atlas_size, 0.0).r;
+        }
+    }
+    return textureLod(u_volume, pos, max(u_ubo.lod - u_ubo.fallback_level, 0.0)).r;
+}
+
+// Whether any density within a macrocell's range maps to a visible color. The
+// range covers every texel of the transfer function linear filtering may read.
+bool is_cell_visible(ivec3 cell) {
+    vec2 range = texelFetch(u_macrocells, cell, 0).rg;
+    vec2 t = (range - u_ubo.min_density) / (u_ubo.max_density - u_ubo.min_density);
+    float size = float(textureSize(u_visibility, 0).x);
+    vec2 texels = clamp(floor(clamp(t, -1.0, 2.0) * size - 0.5) + vec2(0.0, 1.0),
+                        vec2(0.0), vec2(size - 1.0));
+    return texelFetch(u_visibility, ivec2(texels), 0).r > 0.0;
+}
+
+// Distances along a ray to where it enters and leaves a box, the ray misses
+// the box if it leaves before entering. Axes the ray runs parallel, or all
+// but parallel, to are nudged away from zero, so their reciprocal stays
+// finite and a ray along a face never computes zero times infinity.
+vec2 intersect_box(vec3 origin, vec3 dir, vec3 box_min, vec3 box_max) {
+    vec3 inv_dir = 1.0 / mix(dir, vec3(1e-8), lessThan(abs(dir), vec3(1e-8)));
+    vec3 t0 = (box_min - origin) * inv_dir;
+    vec3 t1 = (box_max - origin) * inv_dir;
+    vec3 t_near = min(t0, t1);
+    vec3 t_far = max(t0, t1);
+    return vec2(max(max(t_near.x, t_near.y), t_near.z),
+                min(min(t_far.x, t_far.y), t_far.z));
+}
 
 void main() {
     vec4 color = vec4(0.0, 0.0, 0.0, 1.0);
     vec3 ray_dir = normalize(in_frag_position - u_ubo.camera_position);
-    vec3 ray_pos = in_tex_coords;
+    vec3 ray_origin = in_tex_coords;
+
+    // March only the part of the ray inside both the volume and the slicing
+    // box. Samples stay on the same grid along the ray wherever it enters.
+    vec3 box_min = max(u_ubo.min_slice, vec3(0.0));
+    vec3 box_max = min(u_ubo.max_slice, vec3(1.0));
+    vec2 ray_range = intersect_box(ray_origin, ray_dir, box_min, box_max);
 
-    vec3 min_bounds = vec3(0.0, 0.0, 0.0);
-    vec3 max_bounds = vec3(1.0, 1.0, 1.0);
+    float step_size = u_ubo.step_size;
+    float ray_start = ceil(max(ray_range.x, 0.0) / step_size) * step_size;
+    uint last_page = 0xFFFFFFFFu;
 
-    float ray_dist = 1.8;
-    float step_size = 0.005;
-    int steps = int(ray_dist / step_size);
+    // Density of the sample before, which starts the segment to the next one
+    float front = 0.0;
+    bool has_front = false;
 
-    for (int i = 0; i < steps; i++) {
-        if (any(greaterThan(ray_pos, max_bounds)) ||
-            any(lessThan(ray_pos, min_bounds))) {
-            break;
+    // Walk the macrocells along the ray, marching the visible ones and
+    // leaping to the first sample past the invisible ones. Nothing further
+    // along shows through once the ray is close to opaque, so it stops there.
+    float ray_dist = ray_start;
+    while (ray_dist < ray_range.y && color.a >= u_ubo.min_transmittance) {
+        vec3 ray_pos = ray_origin + ray_dir * ray_dist;
+        vec3 cell = clamp(floor(ray_pos / u_ubo.macrocell_extent), vec3(0.0),
+                          vec3(u_ubo.macrocell_grid - 1u));
+        vec3 cell_min = cell * u_ubo.macrocell_extent;
+        vec3 cell_max = min(cell_min + u_ubo.macrocell_extent, vec3(1.0));
+        float cell_exit = min(intersect_box(ray_origin, ray_dir, cell_min, cell_max).y,
+                              ray_range.y);
+
+        if (!is_cell_visible(ivec3(cell))) {
+            ray_dist = max(ceil(cell_exit / step_size) * step_size, ray_dist + step_size);
+            has_front = false;
+            continue;
         }
 
-        if (all(lessThan(ray_pos, u_ubo.max_slice)) &&
-            all(greaterThan(ray_pos, u_ubo.min_slice))) {
-            float density = texture(u_volume, ray_pos).r;
+        // Every visible cell takes at least one sample, so the walk always
+        // moves on even where rounding puts a sample on the cell's far face
+        do {
+            ray_pos = ray_origin + ray_dir * ray_dist;
+            float density = sample_density(ray_pos, last_page);
             float t = (density - u_ubo.min_density) / (u_ubo.max_density - u_ubo.min_density);
-            vec4 sample_color = texture(u_transfer_func, t);
-            color.rgb += color.a * (sample_color.a * sample_color.rgb);
-            color.a *= (1.0 - sample_color.a);
-        }
-        ray_pos += ray_dir * step_size;
+            front = has_front ? front : t;
+            has_front = true;
+
+            // Classify the segment from the sample before, whose extinction
+            // is per voxel and so scaled by the distance stepped
+            vec4 segment = texture(u_transfer_func, vec2(front, t));
+            float alpha = 1.0 - exp(-segment.a * u_ubo.opacity_correction);
+            color.rgb += color.a * (alpha * segment.rgb);
+            color.a *= (1.0 - alpha);
+            front = t;
+            ray_dist += step_size;
+        } while (ray_dist < cell_exit && color.a >= u_ubo.min_transmittance);
     }
 
     color.a = 1.0 - color.a;
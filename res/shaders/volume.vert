@@ -16,9 +16,16 @@ layout(binding = 0) uniform UniformBufferObject {
     vec3 max_slice;
 } u_ubo;
 
+// Offset of the frame in clip space, which moves the samples of refining
+// frames around within their pixels
+layout(push_constant) uniform Jitter {
+    vec2 offset;
+} u_jitter;
+
 void main() {
     out_tex_coords = in_tex_coords;
     out_frag_position = in_position;
 
-    gl_Position = u_ubo.proj * u_ubo.view * vec4(in_position, 1.0);    
+    gl_Position = u_ubo.proj * u_ubo.view * vec4(in_position, 1.0);
+    gl_Position.xy += u_jitter.offset * gl_Position.w;
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 #include "application.h"
 
+#include "batch.h"
+#include "benchmark.h"
+#include "core/thread_pool.h"
+#include "cpu_render.h"
 #include "data/importer.h"
+#include "image_export.h"
 #include "rendering/main_pass.h"
+#include "rendering/offscreen_pass.h"
 #include "rendering/vulkan_context.h"
+#include "scene/camera_path.h"
 #include "scene/scene.h"
 #include "ui/imgui_context.h"
 #include "ui/ui_context.h"
@@ -11,45 +18,92 @@
 #include <nfd.h>
 
 #include <cassert>
+#include <exception>
+#include <iostream>
 #include <numeric>
 
 Vol::Application *Vol::Application::instance = nullptr;
 
 double calculate_framerate();
 
-Vol::Application::Application()
+Vol::Application::Application(const Options &options)
     : running(false),
       window(nullptr),
+      thread_pool(std::make_unique<Core::ThreadPool>()),
       vulkan_context(nullptr),
       imgui_context(nullptr),
       ui_context(nullptr),
       importer(std::make_unique<Data::Importer>()),
-      scene(std::make_unique<Scene::Scene>())
+      scene(std::make_unique<Scene::Scene>()),
+      record_path(options.record_path)
 {
     assert(instance == nullptr);
     instance = this;
 
-    SDL_Init(SDL_INIT_VIDEO);
-    NFD_Init();
+    // Rendering on the CPU needs neither a window nor a device
+    if (options.cpu) {
+        cpu_render = std::make_unique<CpuRender>(options);
+        return;
+    }
 
-    SDL_WindowFlags window_flags =
-        (SDL_WindowFlags)(SDL_WINDOW_RESIZABLE | SDL_WINDOW_VULKAN |
-                          SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_MAXIMIZED);
-    SDL_Window *window = SDL_CreateWindow("Template", 1280, 720, window_flags);
+    // Headless contexts render offscreen at the size they were asked for
+    if (options.headless) {
+        vulkan_context = new Rendering::VulkanContext(nullptr);
+        vulkan_context->get_offscreen_pass()->framebuffer_size_changed(
+            options.window_width, options.window_height);
+    } else {
+        SDL_Init(SDL_INIT_VIDEO);
+        NFD_Init();
+
+        // Benchmarks, batches and exports render at the size they were asked
+        // for, every run alike
+        SDL_WindowFlags window_flags = (SDL_WindowFlags)(
+            SDL_WINDOW_VULKAN | SDL_WINDOW_HIGH_PIXEL_DENSITY);
+        if (!options.benchmark && !options.batch && !options.image_export) {
+            window_flags |= SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED;
+        }
+        window = SDL_CreateWindow(
+            "Template", options.window_width, options.window_height,
+            window_flags);
 
-    vulkan_context = new Rendering::VulkanContext(window);
-    imgui_context = new UI::ImGuiContext(window, vulkan_context);
-    ui_context = new UI::UIContext();
+        vulkan_context = new Rendering::VulkanContext(window);
+        imgui_context = new UI::ImGuiContext(window, vulkan_context);
+        ui_context = new UI::UIContext();
+    }
+
+    if (options.benchmark) {
+        benchmark = std::make_unique<Benchmark>(*options.benchmark);
+    }
+    if (options.batch) {
+        batch = std::make_unique<Batch>(*options.batch);
+    }
+    if (options.image_export) {
+        image_export = std::make_unique<ImageExport>(*options.image_export);
+    }
+    if (record_path) {
+        recorded_path = std::make_unique<Scene::CameraPath>();
+    }
 }
 
 Vol::Application::~Application()
 {
+    // Rendering on the CPU never created a window or device to release
+    if (cpu_render) {
+        return;
+    }
     vulkan_context->wait_till_idle();
 
+    // Stop a running import while the renderer can still release its upload
+    importer.reset();
+
     delete ui_context;
     delete imgui_context;
     delete vulkan_context;
 
+    if (is_headless()) {
+        return;
+    }
+
     SDL_DestroyWindow(window);
 
     NFD_Quit();
@@ -58,40 +112,98 @@ Vol::Application::~Application()
 
 int Vol::Application::run()
 {
+    if (cpu_render) {
+        return cpu_render->run();
+    }
+
     running = true;
     while (running) {
         // Calculate frame rate
         float framerate = calculate_framerate();
 
-        // Handle events
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            imgui_context->process_event(&e);
-            switch (e.type) {
-                case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED: {
-                    vulkan_context->get_main_pass()->framebuffer_size_changed();
-                    break;
-                }
-                case SDL_EVENT_QUIT: {
-                    running = false;
-                    break;
-                }
-            }
+        // Handle events, headless contexts have no window to get them from
+        if (!is_headless()) {
+            process_events();
         }
 
-        // Update immediate mode ui
-        ui_context->get_main_window().set_framerate(framerate);
-        ui_context->update();
+        // Hand finished imports to the renderer
+        importer->update();
+
+        // Pose the camera of a benchmark or batch frame
+        if (benchmark) {
+            benchmark->begin_frame();
+        }
+        if (batch) {
+            batch->begin_frame();
+        }
 
-        // Render frame
-        bool minimized = SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED;
-        if (!minimized) {
+        // Update immediate mode ui and render frame, headless contexts only
+        // render the volume
+        if (is_headless()) {
             vulkan_context->render();
         } else {
-            imgui_context->end_frame();
+            ui_context->get_main_window().set_framerate(framerate);
+            ui_context->update();
+
+            bool minimized = SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED;
+            if (!minimized) {
+                vulkan_context->render();
+            } else {
+                imgui_context->end_frame();
+            }
+        }
+
+        // Record the camera the frame was rendered with
+        if (recorded_path) {
+            auto [min_slice, max_slice] =
+                vulkan_context->get_offscreen_pass()->get_slicing();
+            recorded_path->append(
+                scene->get_camera(), min_slice, max_slice);
+        }
+
+        // Quit once the benchmark or batch has reported or the image was
+        // exported
+        if (benchmark && !benchmark->end_frame()) {
+            running = false;
+        }
+        if (batch && !batch->end_frame()) {
+            running = false;
+        }
+        if (image_export && !image_export->end_frame()) {
+            running = false;
+        }
+    }
+
+    if (recorded_path) {
+        try {
+            recorded_path->save(*record_path);
+        } catch (std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    bool failed = (benchmark && benchmark->has_failed()) ||
+                  (batch && batch->has_failed()) ||
+                  (image_export && image_export->has_failed());
+    return failed ? 1 : 0;
+}
+
+void Vol::Application::process_events()
+{
+    SDL_Event e;
+    while (SDL_PollEvent(&e)) {
+        imgui_context->process_event(&e);
+        switch (e.type) {
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED: {
+                vulkan_context->get_main_pass()->framebuffer_size_changed();
+                break;
+            }
+            case SDL_EVENT_QUIT: {
+                running = false;
+                break;
+            }
         }
     }
-    return 0;
 }
 
 Vol::Application &Vol::Application::main()
@@ -1,9 +1,18 @@
 #pragma once
 
+#include "options.h"
+
+#include <filesystem>
 #include <memory>
+#include <optional>
 
 struct SDL_Window;
 
+namespace Vol::Core
+{
+class ThreadPool;
+}
+
 namespace Vol::Rendering
 {
 class VulkanContext;
@@ -22,19 +31,32 @@ class Importer;
 
 namespace Vol::Scene
 {
+class CameraPath;
 class Scene;
-}
+}  // namespace Vol::Scene
+
+namespace Vol
+{
+class Batch;
+class Benchmark;
+class CpuRender;
+class ImageExport;
+}  // namespace Vol
 
 namespace Vol
 {
 class Application {
   public:
-    explicit Application();
+    explicit Application(const Options &options = {});
     ~Application();
 
     int run();
 
+    // Without a window there is no ui, only the volume is rendered
+    inline bool is_headless() const { return window == nullptr; }
+
     inline SDL_Window &get_window() { return *window; }
+    inline Core::ThreadPool &get_thread_pool() { return *thread_pool; }
     inline Rendering::VulkanContext &get_vulkan_context() const
     {
         return *vulkan_context;
@@ -44,20 +66,32 @@ class Application {
         return *imgui_context;
     }
     inline UI::UIContext &get_ui() { return *ui_context; }
-    inline const Data::Importer &get_importer() const { return *importer; };
+    inline Data::Importer &get_importer() { return *importer; };
     inline Scene::Scene &get_scene() { return *scene; }
 
   public:
     static Application &main();
 
+  private:
+    void process_events();
+
   private:
     bool running;
     SDL_Window *window;
+    std::unique_ptr<Core::ThreadPool> thread_pool;
     Rendering::VulkanContext *vulkan_context;
     UI::ImGuiContext *imgui_context;
     UI::UIContext *ui_context;
     std::unique_ptr<Data::Importer> importer;
     std::unique_ptr<Scene::Scene> scene;
+    std::unique_ptr<Benchmark> benchmark;
+    std::unique_ptr<Batch> batch;
+    std::unique_ptr<CpuRender> cpu_render;
+    std::unique_ptr<ImageExport> image_export;
+
+    // Cameras of the frames rendered, saved once the application exits
+    std::optional<std::filesystem::path> record_path;
+    std::unique_ptr<Scene::CameraPath> recorded_path;
 
   private:
     static Application *instance;
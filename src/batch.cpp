@@ -0,0 +1,409 @@
+#include "batch.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/image_writer.h"
+#include "data/importer.h"
+#include "rendering/gpu_profiler.h"
+#include "rendering/main_pass.h"
+#include "rendering/offscreen_pass.h"
+#include "rendering/vulkan_context.h"
+#include "scene/scene.h"
+#include "ui/components/gradient.h"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+// Texels the transfer function is discretized to, as the editor does
+const size_t transfer_function_texels = 256;
+
+// Most frames rendered at a pose for pages to stream in, the frame is
+// captured as it is after them
+const uint32_t max_settle_frames = 256;
+
+// Encodes queued per thread of the pool before rendering waits for them, so
+// frames read back don't pile up in memory
+const size_t encodes_per_thread = 2;
+
+Vol::Batch::Batch(const std::filesystem::path &manifest)
+{
+    start_time = std::chrono::steady_clock::now();
+    try {
+        load_manifest(manifest);
+    } catch (std::exception &e) {
+        fail(e.what());
+        return;
+    }
+
+    // Render every frame in full and as fast as the device allows
+    Rendering::VulkanContext &context =
+        Application::main().get_vulkan_context();
+    context.get_offscreen_pass()->adaptive_quality_changed(false);
+    if (Rendering::MainPass *main_pass = context.get_main_pass()) {
+        main_pass->vsync_changed(false);
+    }
+
+    import_dataset(0);
+}
+
+void Vol::Batch::begin_frame()
+{
+    frame_start = std::chrono::steady_clock::now();
+    if (stage != Stage::Rendering) {
+        return;
+    }
+
+    // Pose the camera and capture the frame into the job's sequence
+    const Scene::CameraPathFrame &path_frame =
+        camera_path[frame % camera_path.size()];
+    Application::main().get_scene().get_camera().set_pose(
+        path_frame.orientation, path_frame.radius);
+
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+    offscreen_pass->slicing_changed(path_frame.min_slice, path_frame.max_slice);
+
+    // Pages a frame samples are only requested once its slot comes around
+    // again, so a paged volume's pose is settled after as many frames
+    // without streaming, as with image exports
+    capturing = !offscreen_pass->is_paged() ||
+                settled_frames > Rendering::MAX_FRAMES_IN_FLIGHT ||
+                settling_frames >= max_settle_frames;
+    if (!capturing) {
+        return;
+    }
+    offscreen_pass->capture_next_frame(next_capture_id);
+    capture_outputs[next_capture_id++] =
+        jobs[job].output / std::format("{:04}.{}", frame, image_format);
+}
+
+bool Vol::Batch::end_frame()
+{
+    auto now = std::chrono::steady_clock::now();
+    Rendering::VulkanContext &context =
+        Application::main().get_vulkan_context();
+    Data::Importer &importer = Application::main().get_importer();
+
+    // Hand frames read back to the pool
+    encode(context.get_offscreen_pass()->take_captures());
+    collect_encodes(false);
+
+    // The import stage is done once the dataset has been staged
+    if (importing_job && !import_staged &&
+        (importer.is_staged() || !importer.is_importing())) {
+        import_seconds +=
+            std::chrono::duration<double>(now - import_start).count();
+        import_staged = true;
+    }
+
+    switch (stage) {
+        case Stage::Importing: {
+            // The dataset is rendered once the renderer has swapped it in
+            if (importer.is_staged()) {
+                importer.resume();
+            }
+            if (importer.is_importing()) {
+                break;
+            }
+            if (!importer.get_error().empty()) {
+                fail("Failed to import dataset: " + importer.get_error());
+                break;
+            }
+            importing_job.reset();
+            start_job();
+
+            // Import the next dataset while this one is rendered
+            for (size_t next = job + 1; next < jobs.size(); next++) {
+                if (jobs[next].dataset != jobs[job].dataset) {
+                    import_dataset(next);
+                    break;
+                }
+            }
+            break;
+        }
+        case Stage::Rendering: {
+            // GPU time is read back frames later, which evens out over a job
+            Rendering::GpuProfiler *profiler = context.get_profiler();
+            auto raymarch = profiler->get_frame_time(
+                Rendering::GpuScope::Raymarch);
+            auto uploads =
+                profiler->get_frame_time(Rendering::GpuScope::Uploads);
+            if (raymarch) {
+                render_seconds += (*raymarch + uploads.value_or(0.0f)) / 1e3;
+            } else {
+                render_seconds +=
+                    std::chrono::duration<double>(now - frame_start).count();
+            }
+            rendered_frames++;
+
+            // Frames are rendered at the pose until it has settled
+            settled_frames = context.get_offscreen_pass()->is_streaming()
+                                 ? 0
+                                 : settled_frames + 1;
+            if (!capturing) {
+                settling_frames++;
+                break;
+            }
+            settled_frames = 0;
+            settling_frames = 0;
+
+            if (++frame < frame_count) {
+                break;
+            }
+
+            // Jobs of the same dataset follow one another
+            job++;
+            if (job == jobs.size()) {
+                stage = Stage::Draining;
+            } else if (jobs[job].dataset == jobs[job - 1].dataset) {
+                start_job();
+            } else {
+                stage = Stage::Importing;
+            }
+            break;
+        }
+        case Stage::Draining: {
+            encode(context.get_offscreen_pass()->take_captures(true));
+            collect_encodes(true);
+            if (!failed) {
+                report();
+                stage = Stage::Done;
+            }
+            break;
+        }
+        case Stage::Done:
+            break;
+    }
+
+    return stage != Stage::Done;
+}
+
+void Vol::Batch::load_manifest(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open batch manifest");
+    }
+
+    // Paths are relative to the manifest
+    std::filesystem::path directory = path.parent_path();
+    std::filesystem::path output = directory / "renders";
+    std::vector<std::vector<std::filesystem::path>> datasets;
+    std::vector<std::optional<std::filesystem::path>> transfer_functions;
+    std::vector<std::string> camera_paths;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string key;
+        if (!(stream >> key) || key.front() == '#') {
+            continue;
+        }
+
+        std::vector<std::string> values;
+        for (std::string value; stream >> value;) {
+            values.push_back(value);
+        }
+        if (values.empty()) {
+            throw std::runtime_error("Missing value for " + key);
+        }
+
+        if (key == "output") {
+            output = directory / values.front();
+        } else if (key == "format") {
+            if (values.front() != "png" && values.front() != "ppm") {
+                throw std::runtime_error("Unsupported image format");
+            }
+            image_format = values.front();
+        } else if (key == "frames") {
+            frame_count = std::stoul(values.front());
+            if (frame_count == 0) {
+                throw std::runtime_error("Batch renders no frames");
+            }
+        } else if (key == "dataset") {
+            std::vector<std::filesystem::path> dataset;
+            for (const std::string &value : values) {
+                dataset.push_back(directory / value);
+            }
+            datasets.push_back(std::move(dataset));
+        } else if (key == "transfer_function") {
+            if (values.front() == "default") {
+                transfer_functions.emplace_back();
+            } else {
+                transfer_functions.emplace_back(directory / values.front());
+            }
+        } else if (key == "camera_path") {
+            bool scripted = values.front() == "orbit" ||
+                            values.front() == "zoom" ||
+                            values.front() == "slicing";
+            camera_paths.push_back(
+                scripted ? values.front()
+                         : (directory / values.front()).string());
+        } else {
+            throw std::runtime_error("Unknown manifest key " + key);
+        }
+    }
+
+    if (datasets.empty()) {
+        throw std::runtime_error("Batch manifest lists no datasets");
+    }
+    if (transfer_functions.empty()) {
+        transfer_functions.emplace_back();
+    }
+    if (camera_paths.empty()) {
+        camera_paths.push_back("orbit");
+    }
+
+    // Every dataset is imported once, for all of its jobs
+    for (const auto &dataset : datasets) {
+        for (const auto &transfer_function : transfer_functions) {
+            for (const std::string &path : camera_paths) {
+                std::string name = std::format(
+                    "{}_{}_{}", dataset.front().stem().string(),
+                    transfer_function ? transfer_function->stem().string()
+                                      : "default",
+                    std::filesystem::path(path).stem().string());
+                jobs.push_back(BatchJob{
+                    .dataset = dataset,
+                    .transfer_function = transfer_function,
+                    .camera_path = path,
+                    .output = output / name,
+                });
+            }
+        }
+    }
+}
+
+void Vol::Batch::import_dataset(size_t job)
+{
+    // Deferred, so the dataset rendered meanwhile stays in place
+    Data::Importer &importer = Application::main().get_importer();
+    importer.import(jobs[job].dataset, true);
+    if (!importer.get_error().empty()) {
+        fail(importer.get_error());
+        return;
+    }
+    importing_job = job;
+    import_staged = false;
+    import_start = std::chrono::steady_clock::now();
+}
+
+void Vol::Batch::start_job()
+{
+    const BatchJob &batch_job = jobs[job];
+    try {
+        // Scripted paths span the frames, recorded ones wrap around
+        if (batch_job.camera_path == "orbit") {
+            camera_path = Scene::CameraPath::orbit(frame_count);
+        } else if (batch_job.camera_path == "zoom") {
+            camera_path = Scene::CameraPath::zoom_sweep(frame_count);
+        } else if (batch_job.camera_path == "slicing") {
+            camera_path = Scene::CameraPath::slicing_sweep(frame_count);
+        } else {
+            camera_path = Scene::CameraPath::load(batch_job.camera_path);
+        }
+
+        UI::Components::Gradient gradient =
+            batch_job.transfer_function
+                ? UI::Components::Gradient::load(*batch_job.transfer_function)
+                : UI::Components::Gradient();
+        Application::main()
+            .get_vulkan_context()
+            .get_offscreen_pass()
+            ->transfer_function_changed(
+                gradient.discretize(transfer_function_texels));
+
+        std::filesystem::create_directories(batch_job.output);
+    } catch (std::exception &e) {
+        fail(e.what());
+        return;
+    }
+
+    stage = Stage::Rendering;
+    frame = 0;
+    settled_frames = 0;
+    settling_frames = 0;
+}
+
+void Vol::Batch::encode(std::vector<Rendering::FrameCapture> captures)
+{
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    for (Rendering::FrameCapture &capture : captures) {
+        auto output = capture_outputs.extract(capture.id);
+        encodes.push_back(thread_pool.submit(
+            [capture = std::move(capture), path = std::move(output.mapped())]
+            {
+                auto start = std::chrono::steady_clock::now();
+                Data::write_image(
+                    path, capture.width, capture.height, capture.pixels);
+                return std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                    .count();
+            }));
+    }
+
+    // Wait for the oldest encodes once too many are queued
+    size_t max_encodes = std::max<size_t>(
+        thread_pool.get_thread_count() * encodes_per_thread, 1);
+    while (encodes.size() > max_encodes) {
+        encodes.front().wait();
+        collect_encodes(false);
+    }
+}
+
+void Vol::Batch::collect_encodes(bool wait)
+{
+    while (!encodes.empty() &&
+           (wait || encodes.front().wait_for(std::chrono::seconds(0)) ==
+                        std::future_status::ready)) {
+        try {
+            encode_seconds += encodes.front().get();
+            encoded_frames++;
+        } catch (std::exception &e) {
+            fail(e.what());
+        }
+        encodes.pop_front();
+    }
+}
+
+void Vol::Batch::report()
+{
+    // Stages are rated by the frames they would get through on their own,
+    // the one rating lowest holds up the rest
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
+    unsigned int thread_count =
+        Application::main().get_thread_pool().get_thread_count();
+    auto get_rate = [&](double busy_seconds) {
+        return busy_seconds > 0.0 ? rendered_frames / busy_seconds : 0.0;
+    };
+
+    std::cout << std::format(
+        "Batch of {} sequences, {} frames in {:.1f} s at {:.1f} frames/s\n",
+        jobs.size(), encoded_frames, seconds, encoded_frames / seconds);
+    std::cout << std::format("{:<10}{:>12}{:>12}\n", "stage", "busy_s",
+                             "frames/s");
+    std::cout << std::format(
+        "{:<10}{:>12.2f}{:>12.1f}\n", "import", import_seconds,
+        get_rate(import_seconds));
+    std::cout << std::format(
+        "{:<10}{:>12.2f}{:>12.1f}\n", "render", render_seconds,
+        get_rate(render_seconds));
+    std::cout << std::format(
+        "{:<10}{:>12.2f}{:>12.1f}  on {} threads\n", "encode", encode_seconds,
+        get_rate(encode_seconds / thread_count), thread_count);
+}
+
+void Vol::Batch::fail(const std::string &message)
+{
+    std::cerr << "Batch failed: " << message << std::endl;
+    failed = true;
+    stage = Stage::Done;
+}
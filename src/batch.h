@@ -0,0 +1,114 @@
+#pragma once
+
+#include "scene/camera_path.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Vol::Rendering
+{
+struct FrameCapture;
+}
+
+namespace Vol
+{
+// One image sequence of a batch, a camera path replayed over a dataset with
+// a transfer function
+struct BatchJob {
+    std::vector<std::filesystem::path> dataset;
+    std::optional<std::filesystem::path> transfer_function;
+    std::string camera_path;
+    std::filesystem::path output;
+};
+
+// Renders the image sequence of every dataset, transfer function and camera
+// path a manifest lists. Three stages overlap: the next dataset is imported
+// on the pool while the current one is rendered, and frames are read back
+// without stalling the device and encoded on the pool while later frames are
+// being rendered. Frames of paged volumes are only captured once no more
+// pages stream in for their pose, so the output doesn't depend on timing.
+// Manifests hold a key and its values per line:
+//
+//   output <directory>
+//   format png|ppm
+//   frames <count>
+//   dataset <file>...
+//   transfer_function <file>|default
+//   camera_path orbit|zoom|slicing|<file>
+class Batch {
+  private:
+    enum class Stage {
+        Importing,
+        Rendering,
+        Draining,
+        Done,
+    };
+
+  public:
+    explicit Batch(const std::filesystem::path &manifest);
+
+    // Poses the camera for the frame about to be rendered
+    void begin_frame();
+
+    // Returns whether the batch wants another frame
+    bool end_frame();
+
+    inline bool has_failed() const { return failed; }
+
+  private:
+    void load_manifest(const std::filesystem::path &path);
+
+    void import_dataset(size_t job);
+    void start_job();
+
+    void encode(std::vector<Rendering::FrameCapture> captures);
+    void collect_encodes(bool wait);
+
+    void report();
+    void fail(const std::string &message);
+
+  private:
+    std::vector<BatchJob> jobs;
+    uint32_t frame_count = 120;
+    std::string image_format = "png";
+
+    Stage stage = Stage::Importing;
+    size_t job = 0;
+    uint32_t frame = 0;
+    Scene::CameraPath camera_path;
+
+    // Frames of a paged volume are rendered at their pose until no more
+    // pages stream in for it, and only captured then
+    bool capturing = false;
+    uint32_t settled_frames = 0;
+    uint32_t settling_frames = 0;
+    bool failed = false;
+
+    // Dataset being imported for the job, timed until it has been staged
+    std::optional<size_t> importing_job;
+    bool import_staged = false;
+
+    // Files the captured frames are written to, and the encodes running on
+    // the pool, each returning how long it took
+    uint64_t next_capture_id = 0;
+    std::map<uint64_t, std::filesystem::path> capture_outputs;
+    std::deque<std::future<double>> encodes;
+
+    // Time every stage was busy for, to tell which one holds up the rest
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point frame_start;
+    std::chrono::steady_clock::time_point import_start;
+    double import_seconds = 0.0;
+    double render_seconds = 0.0;
+    double encode_seconds = 0.0;
+    size_t rendered_frames = 0;
+    size_t encoded_frames = 0;
+};
+}  // namespace Vol
\ No newline at end of file
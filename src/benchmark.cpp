@@ -0,0 +1,311 @@
+#include "benchmark.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/csv_file_parser.h"
+#include "data/importer.h"
+#include "rendering/main_pass.h"
+#include "rendering/offscreen_pass.h"
+#include "rendering/vulkan_context.h"
+#include "scene/scene.h"
+#include "ui/components/gradient.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+// Texels the transfer function is discretized to, as the editor does
+const size_t transfer_function_texels = 256;
+
+// Parsing throughput each core should sustain on CSV slices, in MB/s
+const double csv_target_throughput_per_core = 150.0;
+
+// Percentiles every column of frame times is summarized with
+const std::array<float, 3> summary_percentiles = {0.5f, 0.95f, 0.99f};
+
+std::optional<float> get_total(
+    const std::array<std::optional<float>, Vol::Rendering::gpu_scope_count>
+        &times);
+
+void print_summary_row(const std::string &name, std::vector<float> times);
+
+Vol::Benchmark::Benchmark(const BenchmarkOptions &options) : options(options)
+{
+    Rendering::VulkanContext &context =
+        Application::main().get_vulkan_context();
+
+    try {
+        // Scripted paths span the measured frames, recorded ones wrap around
+        if (options.camera_path == "orbit") {
+            camera_path = Scene::CameraPath::orbit(options.frame_count);
+        } else if (options.camera_path == "zoom") {
+            camera_path = Scene::CameraPath::zoom_sweep(options.frame_count);
+        } else if (options.camera_path == "slicing") {
+            camera_path = Scene::CameraPath::slicing_sweep(options.frame_count);
+        } else {
+            camera_path = Scene::CameraPath::load(options.camera_path);
+        }
+
+        // Without a transfer function the editor's default is rendered
+        UI::Components::Gradient gradient =
+            options.transfer_function
+                ? UI::Components::Gradient::load(*options.transfer_function)
+                : UI::Components::Gradient();
+        context.get_offscreen_pass()->transfer_function_changed(
+            gradient.discretize(transfer_function_texels));
+
+        // The import may be read back from the cache, so the parser is timed
+        // on a run of its own
+        if (options.dataset.front().extension() == ".csv") {
+            measure_parse_throughput();
+        }
+    } catch (std::exception &e) {
+        fail(e.what());
+        return;
+    }
+
+    // Render every frame in full and as fast as the device allows, headless
+    // contexts never wait to present
+    context.get_offscreen_pass()->adaptive_quality_changed(false);
+    if (Rendering::MainPass *main_pass = context.get_main_pass()) {
+        main_pass->vsync_changed(false);
+    }
+
+    Data::Importer &importer = Application::main().get_importer();
+    importer.import(options.dataset);
+    if (!importer.get_error().empty()) {
+        fail(importer.get_error());
+    }
+}
+
+void Vol::Benchmark::begin_frame()
+{
+    frame_start = std::chrono::steady_clock::now();
+
+    // Warmup frames hold the first pose, the frames measured after the path
+    // keep its last
+    switch (stage) {
+        case Stage::Warmup:
+            apply_frame(0);
+            break;
+        case Stage::Measuring:
+            apply_frame(std::min(frame, options.frame_count - 1));
+            break;
+        default:
+            break;
+    }
+}
+
+bool Vol::Benchmark::end_frame()
+{
+    float cpu_time = std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - frame_start)
+                         .count();
+
+    switch (stage) {
+        case Stage::Importing: {
+            // The volume is rendered once the renderer has swapped it in
+            Data::Importer &importer = Application::main().get_importer();
+            if (importer.is_importing()) {
+                break;
+            }
+            if (!importer.get_error().empty()) {
+                fail("Failed to import dataset: " + importer.get_error());
+                break;
+            }
+            stage = options.warmup_frames > 0 ? Stage::Warmup
+                                              : Stage::Measuring;
+            frame = 0;
+            break;
+        }
+        case Stage::Warmup: {
+            if (++frame >= options.warmup_frames) {
+                stage = Stage::Measuring;
+                frame = 0;
+            }
+            break;
+        }
+        case Stage::Measuring: {
+            // GPU times read back this frame are those of the frame recorded
+            // in its slot before
+            if (frame < options.frame_count) {
+                cpu_times.push_back(cpu_time);
+            }
+            if (frame >= Rendering::MAX_FRAMES_IN_FLIGHT) {
+                Rendering::GpuProfiler *profiler =
+                    Application::main().get_vulkan_context().get_profiler();
+                GpuTimes times;
+                for (size_t i = 0; i < Rendering::gpu_scope_count; i++) {
+                    times[i] = profiler->get_frame_time(
+                        static_cast<Rendering::GpuScope>(i));
+                }
+                gpu_times.push_back(times);
+            }
+            if (++frame >=
+                options.frame_count + Rendering::MAX_FRAMES_IN_FLIGHT) {
+                report();
+                stage = Stage::Done;
+            }
+            break;
+        }
+        case Stage::Done:
+            break;
+    }
+
+    return stage != Stage::Done;
+}
+
+void Vol::Benchmark::measure_parse_throughput()
+{
+    Data::CsvFileParser parser(options.dataset);
+    Data::ImportProgress progress;
+    auto start = std::chrono::steady_clock::now();
+    parser.parse(progress, std::stop_token());
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    // Slices are parsed one per task, so no more cores than slices take part
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    parse_cores = static_cast<unsigned int>(std::min<size_t>(
+        thread_pool.get_thread_count() + 1, options.dataset.size()));
+    parse_throughput = progress.bytes_read / 1e6 / elapsed.count() /
+                       parse_cores;
+}
+
+void Vol::Benchmark::apply_frame(size_t index)
+{
+    const Scene::CameraPathFrame &path_frame =
+        camera_path[index % camera_path.size()];
+    Application::main().get_scene().get_camera().set_pose(
+        path_frame.orientation, path_frame.radius);
+    Application::main()
+        .get_vulkan_context()
+        .get_offscreen_pass()
+        ->slicing_changed(path_frame.min_slice, path_frame.max_slice);
+}
+
+void Vol::Benchmark::report()
+{
+    // Every frame as a row, the GPU's time summed over the scopes it timed
+    if (options.report) {
+        std::ofstream file(*options.report, std::ios::trunc);
+        if (!file) {
+            fail("Failed to write benchmark report");
+            return;
+        }
+
+        file << "frame,cpu_ms,gpu_ms";
+        for (size_t i = 0; i < Rendering::gpu_scope_count; i++) {
+            file << ","
+                 << Rendering::get_gpu_scope_name(
+                        static_cast<Rendering::GpuScope>(i))
+                 << "_ms";
+        }
+        file << "\n";
+
+        for (size_t i = 0; i < cpu_times.size(); i++) {
+            file << i << "," << cpu_times[i] << ",";
+            if (auto total = get_total(gpu_times[i])) {
+                file << *total;
+            }
+            for (const std::optional<float> &time : gpu_times[i]) {
+                file << ",";
+                if (time) {
+                    file << *time;
+                }
+            }
+            file << "\n";
+        }
+    }
+
+    // Summary of every column, scopes that were never timed are left out
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(
+        Application::main().get_vulkan_context().get_physical_device(),
+        &properties);
+    std::cout << std::format(
+        "Benchmark of {} frames along {} on {}\n", cpu_times.size(),
+        options.camera_path, properties.deviceName);
+    std::cout << std::format(
+        "{:<14}{:>10}{:>10}{:>10}{:>10}{:>10}{:>10}\n", "", "min", "avg",
+        "p50", "p95", "p99", "max");
+
+    print_summary_row("cpu_ms", cpu_times);
+
+    std::vector<float> totals;
+    for (const GpuTimes &times : gpu_times) {
+        if (auto total = get_total(times)) {
+            totals.push_back(*total);
+        }
+    }
+    print_summary_row("gpu_ms", totals);
+
+    for (size_t i = 0; i < Rendering::gpu_scope_count; i++) {
+        std::vector<float> times;
+        for (const GpuTimes &frame_times : gpu_times) {
+            if (frame_times[i]) {
+                times.push_back(*frame_times[i]);
+            }
+        }
+        print_summary_row(
+            std::string(Rendering::get_gpu_scope_name(
+                static_cast<Rendering::GpuScope>(i))) +
+                "_ms",
+            times);
+    }
+
+    // The parser is held to a throughput every core should sustain
+    if (parse_throughput) {
+        std::cout << std::format(
+            "CSV parse: {:.1f} MB/s per core over {} cores, target {:.1f} "
+            "MB/s ({})\n",
+            *parse_throughput, parse_cores, csv_target_throughput_per_core,
+            *parse_throughput >= csv_target_throughput_per_core ? "met"
+                                                                : "missed");
+    }
+}
+
+void Vol::Benchmark::fail(const std::string &message)
+{
+    std::cerr << "Benchmark failed: " << message << std::endl;
+    failed = true;
+    stage = Stage::Done;
+}
+
+std::optional<float> get_total(
+    const std::array<std::optional<float>, Vol::Rendering::gpu_scope_count>
+        &times)
+{
+    std::optional<float> total;
+    for (const std::optional<float> &time : times) {
+        if (time) {
+            total = total.value_or(0.0f) + *time;
+        }
+    }
+    return total;
+}
+
+void print_summary_row(const std::string &name, std::vector<float> times)
+{
+    if (times.empty()) {
+        return;
+    }
+
+    // Nearest rank percentiles of the sorted times
+    std::sort(times.begin(), times.end());
+    auto get_percentile = [&](float fraction) {
+        size_t rank = static_cast<size_t>(std::ceil(times.size() * fraction));
+        return times[std::clamp<size_t>(rank, 1, times.size()) - 1];
+    };
+    float average = std::accumulate(times.begin(), times.end(), 0.0f) /
+                    times.size();
+
+    std::cout << std::format(
+        "{:<14}{:>10.3f}{:>10.3f}{:>10.3f}{:>10.3f}{:>10.3f}{:>10.3f}\n", name,
+        times.front(), average, get_percentile(summary_percentiles[0]),
+        get_percentile(summary_percentiles[1]),
+        get_percentile(summary_percentiles[2]), times.back());
+}
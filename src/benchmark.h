@@ -0,0 +1,68 @@
+#pragma once
+
+#include "options.h"
+#include "rendering/gpu_profiler.h"
+#include "scene/camera_path.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Vol
+{
+// Replays a camera path over a dataset with vsync and adaptive quality off,
+// so runs are comparable across builds and machines. Once the dataset has
+// been imported and the warmup frames rendered, the time every frame takes on
+// the CPU and its scopes on the GPU are measured, then reported. CSV datasets
+// are parsed once up front as well, timing the parser on its own.
+class Benchmark {
+  private:
+    enum class Stage {
+        Importing,
+        Warmup,
+        Measuring,
+        Done,
+    };
+
+    using GpuTimes =
+        std::array<std::optional<float>, Rendering::gpu_scope_count>;
+
+  public:
+    explicit Benchmark(const BenchmarkOptions &options);
+
+    // Poses the camera for the frame about to be rendered
+    void begin_frame();
+
+    // Returns whether the benchmark wants another frame
+    bool end_frame();
+
+    inline bool has_failed() const { return failed; }
+
+  private:
+    void measure_parse_throughput();
+    void apply_frame(size_t index);
+    void report();
+    void fail(const std::string &message);
+
+  private:
+    BenchmarkOptions options;
+    Scene::CameraPath camera_path;
+    Stage stage = Stage::Importing;
+    uint32_t frame = 0;
+    bool failed = false;
+
+    // Throughput the CSV slices were parsed at, in MB/s per core
+    std::optional<double> parse_throughput;
+    unsigned int parse_cores = 0;
+
+    // The time a frame took on the GPU is read back once its slot comes
+    // around again, so measuring runs for as many frames longer as there are
+    // frames in flight
+    std::chrono::steady_clock::time_point frame_start;
+    std::vector<float> cpu_times;
+    std::vector<GpuTimes> gpu_times;
+};
+}  // namespace Vol
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "simd.h"
+
+#if defined(VOL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+Vol::Core::SimdLevel detect_simd_level();
+
+Vol::Core::SimdLevel Vol::Core::get_simd_level()
+{
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+Vol::Core::SimdLevel detect_simd_level()
+{
+#if defined(VOL_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse41 = info[2] & (1 << 19);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                        (_xgetbv(0) & 0x6) == 0x6;
+
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_saves_ymm) {
+        __cpuidex(info, 7, 0);
+        avx2 = info[1] & (1 << 5);
+    }
+
+    if (avx2) {
+        return Vol::Core::SimdLevel::Avx2;
+    }
+    if (sse41) {
+        return Vol::Core::SimdLevel::Sse41;
+    }
+#elif defined(VOL_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Vol::Core::SimdLevel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return Vol::Core::SimdLevel::Sse41;
+    }
+#endif  // VOL_X86
+    return Vol::Core::SimdLevel::Scalar;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define VOL_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit instructions a function has been enabled for
+#if defined(VOL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define VOL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define VOL_TARGET(isa)
+#endif
+
+namespace Vol::Core
+{
+enum class SimdLevel {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+// Widest instruction set the CPU supports, kernels built for several pick
+// theirs by it at runtime
+SimdLevel get_simd_level();
+}  // namespace Vol::Core
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+struct ParallelForState {
+    size_t count;
+    size_t grain;
+    size_t chunk_count;
+    const std::function<void(size_t, size_t)> *body;
+
+    std::atomic<size_t> next_chunk = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr exception;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t finished_chunks = 0;
+};
+
+void run_chunks(ParallelForState &state);
+
+Vol::Core::ThreadPool::ThreadPool(unsigned int thread_count)
+{
+    thread_count = std::max(thread_count, 1u);
+    threads.reserve(thread_count);
+    for (unsigned int i = 0; i < thread_count; i++) {
+        threads.emplace_back(
+            [this](std::stop_token stop_token) { work(stop_token); });
+    }
+}
+
+Vol::Core::ThreadPool::~ThreadPool()
+{
+    for (std::jthread &thread : threads) {
+        thread.request_stop();
+    }
+    threads.clear();
+}
+
+void Vol::Core::ThreadPool::parallel_for(
+    size_t count,
+    size_t grain,
+    const std::function<void(size_t begin, size_t end)> &body)
+{
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+
+    auto state = std::make_shared<ParallelForState>();
+    state->count = count;
+    state->grain = grain;
+    state->chunk_count = (count + grain - 1) / grain;
+    state->body = &body;
+
+    // Wake enough workers to share the chunks with the calling thread.
+    // Workers that arrive after every chunk is taken return immediately.
+    size_t helper_count =
+        std::min<size_t>(get_thread_count(), state->chunk_count - 1);
+    for (size_t i = 0; i < helper_count; i++) {
+        enqueue([state]() { run_chunks(*state); });
+    }
+
+    run_chunks(*state);
+
+    // Wait for chunks still running on workers
+    {
+        std::unique_lock lock(state->mutex);
+        state->condition.wait(lock, [&state]() {
+            return state->finished_chunks == state->chunk_count;
+        });
+    }
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+void Vol::Core::ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard lock(mutex);
+        tasks.push(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void Vol::Core::ThreadPool::work(std::stop_token stop_token)
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            if (!condition.wait(
+                    lock, stop_token, [this]() { return !tasks.empty(); })) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void run_chunks(ParallelForState &state)
+{
+    size_t finished = 0;
+    while (true) {
+        size_t chunk = state.next_chunk.fetch_add(1);
+        if (chunk >= state.chunk_count) {
+            break;
+        }
+
+        // Skip the remaining work once a chunk has failed
+        if (!state.failed.load(std::memory_order_relaxed)) {
+            size_t begin = chunk * state.grain;
+            size_t end = std::min(begin + state.grain, state.count);
+            try {
+                (*state.body)(begin, end);
+            } catch (...) {
+                std::lock_guard lock(state.mutex);
+                if (!state.exception) {
+                    state.exception = std::current_exception();
+                }
+                state.failed = true;
+            }
+        }
+        finished++;
+    }
+
+    if (finished > 0) {
+        std::lock_guard lock(state.mutex);
+        state.finished_chunks += finished;
+        if (state.finished_chunks == state.chunk_count) {
+            state.condition.notify_all();
+        }
+    }
+}
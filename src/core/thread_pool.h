@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Vol::Core
+{
+class ThreadPool {
+  public:
+    explicit ThreadPool(
+        unsigned int thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    template <typename F>
+    auto submit(F &&function) -> std::future<std::invoke_result_t<F>>;
+
+    // Splits [0, count) into chunks of at most grain indices and runs them
+    // across the pool. The calling thread works through chunks as well, so it
+    // is safe to call from within a pool task. The first exception thrown by
+    // the body is rethrown once every chunk has finished.
+    void parallel_for(
+        size_t count,
+        size_t grain,
+        const std::function<void(size_t begin, size_t end)> &body);
+
+    inline unsigned int get_thread_count() const
+    {
+        return static_cast<unsigned int>(threads.size());
+    }
+
+  private:
+    void enqueue(std::function<void()> task);
+    void work(std::stop_token stop_token);
+
+  private:
+    std::mutex mutex;
+    std::condition_variable_any condition;
+    std::queue<std::function<void()>> tasks;
+    std::vector<std::jthread> threads;
+};
+
+template <typename F>
+auto ThreadPool::submit(F &&function) -> std::future<std::invoke_result_t<F>>
+{
+    using Result = std::invoke_result_t<F>;
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<F>(function));
+    std::future<Result> future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+}
+}  // namespace Vol::Core
@@ -0,0 +1,181 @@
+#include "cpu_render.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/image_writer.h"
+#include "data/importer.h"
+#include "rendering/cpu_raymarcher.h"
+#include "scene/camera_path.h"
+#include "scene/scene.h"
+#include "ui/components/gradient.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Texels the transfer function is discretized to, as the editor does
+const size_t transfer_function_texels = 256;
+
+std::vector<unsigned int> get_core_counts();
+
+Vol::CpuRender::CpuRender(const Options &options) : options(options) {}
+
+int Vol::CpuRender::run()
+{
+    const std::vector<std::filesystem::path> &dataset =
+        options.benchmark ? options.benchmark->dataset
+                          : options.image_export->dataset;
+    const std::optional<std::filesystem::path> &transfer_function =
+        options.benchmark ? options.benchmark->transfer_function
+                          : options.image_export->transfer_function;
+
+    try {
+        // Without a transfer function the editor's default is rendered
+        UI::Components::Gradient gradient =
+            transfer_function
+                ? UI::Components::Gradient::load(*transfer_function)
+                : UI::Components::Gradient();
+        Rendering::CpuRaymarcher raymarcher(
+            Data::load_dataset(dataset),
+            gradient.discretize(transfer_function_texels),
+            &Application::main().get_thread_pool());
+
+        if (options.benchmark) {
+            benchmark(raymarcher);
+        } else {
+            export_image(raymarcher);
+        }
+    } catch (std::exception &e) {
+        std::cerr << "CPU render failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void Vol::CpuRender::export_image(const Rendering::CpuRaymarcher &raymarcher)
+{
+    std::vector<uint8_t> pixels = raymarcher.render(
+        get_view(), options.window_width, options.window_height,
+        &Application::main().get_thread_pool());
+    Data::write_image(
+        options.image_export->output, options.window_width,
+        options.window_height, pixels);
+}
+
+void Vol::CpuRender::benchmark(const Rendering::CpuRaymarcher &raymarcher)
+{
+    const BenchmarkOptions &benchmark = *options.benchmark;
+    Scene::Camera &camera = Application::main().get_scene().get_camera();
+
+    // Scripted paths span the measured frames, recorded ones wrap around
+    Scene::CameraPath camera_path;
+    if (benchmark.camera_path == "orbit") {
+        camera_path = Scene::CameraPath::orbit(benchmark.frame_count);
+    } else if (benchmark.camera_path == "zoom") {
+        camera_path = Scene::CameraPath::zoom_sweep(benchmark.frame_count);
+    } else if (benchmark.camera_path == "slicing") {
+        camera_path = Scene::CameraPath::slicing_sweep(benchmark.frame_count);
+    } else {
+        camera_path = Scene::CameraPath::load(benchmark.camera_path);
+    }
+    auto get_frame_view = [&](uint32_t frame) {
+        const Scene::CameraPathFrame &path_frame =
+            camera_path[frame % camera_path.size()];
+        camera.set_pose(path_frame.orientation, path_frame.radius);
+        Rendering::CpuView view = get_view();
+        view.min_slice = path_frame.min_slice;
+        view.max_slice = path_frame.max_slice;
+        return view;
+    };
+
+    // Warmup frames hold the first pose and fault the volume in on all cores
+    for (uint32_t frame = 0; frame < benchmark.warmup_frames; frame++) {
+        raymarcher.render(
+            get_frame_view(0), options.window_width, options.window_height,
+            &Application::main().get_thread_pool());
+    }
+
+    // The calling thread traces rays too, so a pool one smaller than the
+    // cores measured makes up the rest
+    std::vector<unsigned int> core_counts = get_core_counts();
+    std::vector<double> seconds;
+    for (unsigned int core_count : core_counts) {
+        std::unique_ptr<Core::ThreadPool> thread_pool;
+        if (core_count > 1) {
+            thread_pool = std::make_unique<Core::ThreadPool>(core_count - 1);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < benchmark.frame_count; frame++) {
+            raymarcher.render(
+                get_frame_view(frame), options.window_width,
+                options.window_height, thread_pool.get());
+        }
+        seconds.push_back(std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+    }
+
+    double rays = static_cast<double>(options.window_width) *
+                  options.window_height * benchmark.frame_count;
+    auto get_mrays = [&](size_t i) { return rays / seconds[i] / 1e6; };
+
+    if (benchmark.report) {
+        std::ofstream file(*benchmark.report);
+        if (!file) {
+            throw std::runtime_error("Failed to open benchmark report");
+        }
+        file << "cores,seconds,mrays_per_second\n";
+        for (size_t i = 0; i < core_counts.size(); i++) {
+            file << core_counts[i] << "," << seconds[i] << ","
+                 << get_mrays(i) << "\n";
+        }
+    }
+
+    // Speedup and efficiency are relative to a single core
+    std::cout << std::format(
+        "CPU benchmark of {} frames along {} at {}x{}, traced with {}\n",
+        benchmark.frame_count, benchmark.camera_path, options.window_width,
+        options.window_height, raymarcher.get_simd_name());
+    std::cout << std::format(
+        "{:<8}{:>10}{:>10}{:>10}{:>12}\n", "cores", "seconds", "Mrays/s",
+        "speedup", "efficiency");
+    for (size_t i = 0; i < core_counts.size(); i++) {
+        double speedup = get_mrays(i) / get_mrays(0);
+        std::cout << std::format(
+            "{:<8}{:>10.2f}{:>10.2f}{:>10.2f}{:>11.0f}%\n", core_counts[i],
+            seconds[i], get_mrays(i), speedup,
+            speedup / core_counts[i] * 100.0);
+    }
+}
+
+Vol::Rendering::CpuView Vol::CpuRender::get_view() const
+{
+    const Scene::Camera &camera = Application::main().get_scene().get_camera();
+    float aspect = static_cast<float>(options.window_width) /
+                   static_cast<float>(options.window_height);
+    return Rendering::CpuView{
+        .view = camera.get_view(),
+        .proj = camera.get_projection(aspect),
+        .camera_position = camera.get_position(),
+    };
+}
+
+std::vector<unsigned int> get_core_counts()
+{
+    // Powers of two up to the cores there are, and all of them
+    unsigned int max_count = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned int> counts;
+    for (unsigned int count = 1; count < max_count; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(max_count);
+    return counts;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "options.h"
+
+namespace Vol::Rendering
+{
+class CpuRaymarcher;
+struct CpuView;
+}  // namespace Vol::Rendering
+
+namespace Vol
+{
+// Benchmarks and exports rendered on the CPU, for machines without a device
+// and to check shader changes against. Exports write the image the device's
+// export would. Benchmarks replay the camera path on ever more cores and
+// report the rays traced per second on each.
+class CpuRender {
+  public:
+    explicit CpuRender(const Options &options);
+
+    // Returns the exit code
+    int run();
+
+  private:
+    void export_image(const Rendering::CpuRaymarcher &raymarcher);
+    void benchmark(const Rendering::CpuRaymarcher &raymarcher);
+
+    // Camera of the scene, as the offscreen pass renders with it
+    Rendering::CpuView get_view() const;
+
+  private:
+    Options options;
+};
+}  // namespace Vol
\ No newline at end of file
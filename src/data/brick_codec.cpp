@@ -0,0 +1,341 @@
+#include "brick_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// LZ4 block format limits, matches are at least 4 bytes, end at least 5 bytes
+// before the end of the block and start at least 12 bytes before it
+const size_t min_match = 4;
+const size_t last_literals = 5;
+const size_t match_find_limit = 12;
+const size_t max_offset = 65535;
+const int hash_log = 12;
+
+// Sequences are mostly short, so they are copied in fixed size steps that may
+// run past their end while there is room left in both buffers
+const size_t copy_size = 16;
+
+std::vector<std::byte> compress_block(std::span<const std::byte> src);
+
+void decompress_block(std::span<const std::byte> src, std::span<std::byte> dst);
+
+void write_sequence(
+    std::vector<std::byte> &out,
+    const std::byte *literals,
+    size_t literal_count,
+    size_t offset,
+    size_t match_length);
+
+void write_length(std::vector<std::byte> &out, size_t length);
+
+size_t read_length(const std::byte *&it, const std::byte *end);
+
+void copy_bytes(
+    std::byte *dst,
+    const std::byte *src,
+    size_t count,
+    size_t room);
+
+uint32_t read_u32(const std::byte *data);
+
+void shuffle(
+    const std::byte *src,
+    std::byte *dst,
+    size_t count,
+    size_t voxel_size);
+
+void unshuffle(
+    const std::byte *src,
+    std::byte *dst,
+    size_t count,
+    size_t voxel_size);
+
+template <size_t voxel_size>
+void shuffle_(const std::byte *src, std::byte *dst, size_t count);
+
+template <size_t voxel_size>
+void unshuffle_(const std::byte *src, std::byte *dst, size_t count);
+
+std::vector<std::byte> Vol::Data::compress_brick(
+    std::span<const std::byte> voxels,
+    size_t voxel_size)
+{
+    // Group the bytes of each significance together
+    std::vector<std::byte> shuffled;
+    std::span<const std::byte> src = voxels;
+    if (voxel_size > 1) {
+        shuffled.resize(voxels.size());
+        shuffle(
+            voxels.data(), shuffled.data(), voxels.size() / voxel_size,
+            voxel_size);
+        src = shuffled;
+    }
+
+    std::vector<std::byte> compressed = compress_block(src);
+    if (compressed.size() >= voxels.size()) {
+        return {};
+    }
+    return compressed;
+}
+
+void Vol::Data::decompress_brick(
+    std::span<const std::byte> compressed,
+    std::span<std::byte> voxels,
+    size_t voxel_size)
+{
+    if (voxel_size == 1) {
+        decompress_block(compressed, voxels);
+        return;
+    }
+
+    // Scratch space is kept per thread, bricks are decompressed in parallel
+    thread_local std::vector<std::byte> shuffled;
+    shuffled.resize(voxels.size());
+    decompress_block(compressed, shuffled);
+    unshuffle(
+        shuffled.data(), voxels.data(), voxels.size() / voxel_size,
+        voxel_size);
+}
+
+std::vector<std::byte> compress_block(std::span<const std::byte> src)
+{
+    const std::byte *in = src.data();
+    size_t size = src.size();
+
+    std::vector<std::byte> out;
+    out.reserve(size + size / 255 + 16);
+
+    // Last position each 4 byte sequence was seen at, offset by one so zero
+    // means never
+    std::vector<uint32_t> table(size_t(1) << hash_log, 0);
+
+    size_t anchor = 0;
+    size_t it = 0;
+    if (size > match_find_limit) {
+        size_t find_limit = size - match_find_limit;
+        size_t match_limit = size - last_literals;
+        while (it < find_limit) {
+            uint32_t sequence = read_u32(in + it);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - hash_log);
+            size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(it + 1);
+
+            if (candidate == 0 || it - (candidate - 1) > max_offset ||
+                read_u32(in + candidate - 1) != sequence) {
+                // Step faster through data that does not compress
+                it += 1 + ((it - anchor) >> 6);
+                continue;
+            }
+
+            // Extend the match as far as it goes
+            size_t match = candidate - 1;
+            size_t length = min_match;
+            while (it + length < match_limit &&
+                   in[match + length] == in[it + length]) {
+                length++;
+            }
+
+            write_sequence(out, in + anchor, it - anchor, it - match, length);
+            it += length;
+            anchor = it;
+        }
+    }
+
+    // The block always ends in literals
+    write_sequence(out, in + anchor, size - anchor, 0, 0);
+
+    return out;
+}
+
+void decompress_block(std::span<const std::byte> src, std::span<std::byte> dst)
+{
+    const std::byte *in = src.data();
+    const std::byte *in_end = in + src.size();
+    std::byte *out = dst.data();
+    std::byte *out_end = out + dst.size();
+
+    while (true) {
+        if (in == in_end) {
+            throw std::runtime_error("Failed to decompress brick");
+        }
+        uint8_t token = static_cast<uint8_t>(*in++);
+
+        // Copy literals
+        size_t literal_count = token >> 4;
+        if (literal_count == 15) {
+            literal_count += read_length(in, in_end);
+        }
+        if (literal_count > static_cast<size_t>(in_end - in) ||
+            literal_count > static_cast<size_t>(out_end - out)) {
+            throw std::runtime_error("Failed to decompress brick");
+        }
+        copy_bytes(
+            out, in, literal_count,
+            std::min<size_t>(out_end - out, in_end - in));
+        in += literal_count;
+        out += literal_count;
+
+        // The last sequence has no match
+        if (in == in_end) {
+            break;
+        }
+
+        // Copy match, which may overlap the bytes it produces
+        if (in_end - in < 2) {
+            throw std::runtime_error("Failed to decompress brick");
+        }
+        size_t offset = static_cast<size_t>(in[0]) |
+                        (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15) {
+            length += read_length(in, in_end);
+        }
+        length += min_match;
+        if (offset == 0 || offset > static_cast<size_t>(out - dst.data()) ||
+            length > static_cast<size_t>(out_end - out)) {
+            throw std::runtime_error("Failed to decompress brick");
+        }
+
+        const std::byte *match = out - offset;
+        if (offset >= copy_size) {
+            copy_bytes(out, match, length, out_end - out);
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                out[i] = match[i];
+            }
+        }
+        out += length;
+    }
+
+    if (out != out_end) {
+        throw std::runtime_error("Failed to decompress brick");
+    }
+}
+
+void write_sequence(
+    std::vector<std::byte> &out,
+    const std::byte *literals,
+    size_t literal_count,
+    size_t offset,
+    size_t match_length)
+{
+    // Lengths that don't fit the token's nibbles continue after it
+    size_t match_code = offset ? match_length - min_match : 0;
+    uint8_t token = static_cast<uint8_t>(
+        (std::min<size_t>(literal_count, 15) << 4) |
+        std::min<size_t>(match_code, 15));
+    out.push_back(static_cast<std::byte>(token));
+    if (literal_count >= 15) {
+        write_length(out, literal_count - 15);
+    }
+    out.insert(out.end(), literals, literals + literal_count);
+
+    if (offset) {
+        out.push_back(static_cast<std::byte>(offset & 0xFF));
+        out.push_back(static_cast<std::byte>(offset >> 8));
+        if (match_code >= 15) {
+            write_length(out, match_code - 15);
+        }
+    }
+}
+
+void write_length(std::vector<std::byte> &out, size_t length)
+{
+    while (length >= 255) {
+        out.push_back(std::byte{255});
+        length -= 255;
+    }
+    out.push_back(static_cast<std::byte>(length));
+}
+
+size_t read_length(const std::byte *&it, const std::byte *end)
+{
+    size_t length = 0;
+    uint8_t byte;
+    do {
+        if (it == end) {
+            throw std::runtime_error("Failed to decompress brick");
+        }
+        byte = static_cast<uint8_t>(*it++);
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+void copy_bytes(
+    std::byte *dst,
+    const std::byte *src,
+    size_t count,
+    size_t room)
+{
+    // Near the end bytes are copied one at a time, going forward so
+    // overlapping matches repeat
+    if (room < count + copy_size) {
+        for (size_t i = 0; i < count; i++) {
+            dst[i] = src[i];
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; i += copy_size) {
+        std::memcpy(dst + i, src + i, copy_size);
+    }
+}
+
+uint32_t read_u32(const std::byte *data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void shuffle(
+    const std::byte *src,
+    std::byte *dst,
+    size_t count,
+    size_t voxel_size)
+{
+    // Voxel sizes are known up front so the loops can be vectorized
+    switch (voxel_size) {
+        case 2: shuffle_<2>(src, dst, count); break;
+        case 4: shuffle_<4>(src, dst, count); break;
+        case 8: shuffle_<8>(src, dst, count); break;
+        default: std::memcpy(dst, src, count * voxel_size); break;
+    }
+}
+
+void unshuffle(
+    const std::byte *src,
+    std::byte *dst,
+    size_t count,
+    size_t voxel_size)
+{
+    switch (voxel_size) {
+        case 2: unshuffle_<2>(src, dst, count); break;
+        case 4: unshuffle_<4>(src, dst, count); break;
+        case 8: unshuffle_<8>(src, dst, count); break;
+        default: std::memcpy(dst, src, count * voxel_size); break;
+    }
+}
+
+template <size_t voxel_size>
+void shuffle_(const std::byte *src, std::byte *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        for (size_t byte = 0; byte < voxel_size; byte++) {
+            dst[byte * count + i] = src[i * voxel_size + byte];
+        }
+    }
+}
+
+template <size_t voxel_size>
+void unshuffle_(const std::byte *src, std::byte *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        for (size_t byte = 0; byte < voxel_size; byte++) {
+            dst[i * voxel_size + byte] = src[byte * count + i];
+        }
+    }
+}
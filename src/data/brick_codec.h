@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Vol::Data
+{
+// Bricks are compressed as LZ4 blocks. The bytes of multi-byte voxels are
+// grouped by significance first, which turns the slowly varying high bytes
+// into long runs the block compressor can match.
+
+// Compresses a brick, returning nothing if it would not get any smaller
+std::vector<std::byte> compress_brick(
+    std::span<const std::byte> voxels,
+    size_t voxel_size);
+
+// Decompresses a brick into voxels, which must be its exact original size
+void decompress_brick(
+    std::span<const std::byte> compressed,
+    std::span<std::byte> voxels,
+    size_t voxel_size);
+}  // namespace Vol::Data
\ No newline at end of file
@@ -1,9 +1,26 @@
 #include "csv_file_parser.h"
 
+#include "application.h"
+#include "core/thread_pool.h"
+
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <charconv>
 #include <fstream>
-#include <sstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+std::string read_file(const std::filesystem::path &filepath);
+
+glm::u32vec2 measure_slice(const std::string &text);
+
+std::pair<float, float> parse_slice(
+    const std::string &text,
+    glm::u32vec2 dimensions,
+    float *values);
 
 Vol::Data::CsvFileParser::CsvFileParser(
     const std::vector<std::filesystem::path> &filepaths)
@@ -11,40 +28,175 @@ Vol::Data::CsvFileParser::CsvFileParser(
 {
 }
 
-Vol::Data::Dataset Vol::Data::CsvFileParser::parse()
+Vol::Data::Dataset Vol::Data::CsvFileParser::parse(
+    ImportProgress &progress,
+    std::stop_token stop_token)
 {
-    Dataset dataset{};
-
-    std::string line, value_str;
-    uint32_t x = 0, y = 0, z = 0;
-    for (const std::filesystem::path &filepath : get_filepaths()) {
-        std::ifstream file(filepath);
-        y = 0;
-        while (std::getline(file, line)) {
-            std::stringstream ss(line);
-            x = 0;
-            while (std::getline(ss, value_str, ',')) {
-                float value = std::stof(value_str);
-                dataset.min = std::min(dataset.min, value);
-                dataset.max = std::max(dataset.max, value);
-                dataset.data.push_back(value);
-                x++;
+    const std::vector<std::filesystem::path> filepaths = get_filepaths();
+    if (filepaths.empty()) {
+        throw std::runtime_error("No files selected");
+    }
+
+    // Report totals up front
+    size_t bytes_total = 0;
+    for (const std::filesystem::path &filepath : filepaths) {
+        bytes_total += std::filesystem::file_size(filepath);
+    }
+    progress.bytes_total = bytes_total;
+    progress.slices_total = static_cast<uint32_t>(filepaths.size());
+
+    // The first slice sets the dimensions every other slice must match
+    glm::u32vec2 slice_dimensions = measure_slice(read_file(filepaths[0]));
+    size_t slice_size = static_cast<size_t>(slice_dimensions.x) *
+                        slice_dimensions.y;
+
+    Dataset dataset{
+        .dimensions = glm::u32vec3(
+            slice_dimensions, static_cast<uint32_t>(filepaths.size())),
+        .type = VoxelType::Float32,
+        .data = std::vector<std::byte>(
+            slice_size * filepaths.size() * sizeof(float)),
+    };
+    float *values = reinterpret_cast<float *>(dataset.data.data());
+
+    // Parse slices in parallel, each straight into its place in the volume
+    std::vector<std::pair<float, float>> ranges(filepaths.size());
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    thread_pool.parallel_for(
+        filepaths.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t z = begin; z < end; z++) {
+                if (stop_token.stop_requested()) {
+                    throw std::runtime_error("Import cancelled");
+                }
+
+                std::string text = read_file(filepaths[z]);
+                progress.bytes_read += text.size();
+
+                ranges[z] = parse_slice(
+                    text, slice_dimensions, values + z * slice_size);
+                progress.slices_parsed++;
             }
-            if (z == 0 && y == 0) {
-                dataset.dimensions.x = x;
-            } else if (x != dataset.dimensions.x) {
+        });
+
+    // Reduce slice ranges
+    dataset.min = std::numeric_limits<float>::max();
+    dataset.max = std::numeric_limits<float>::lowest();
+    for (const auto &[min, max] : ranges) {
+        dataset.min = std::min(dataset.min, min);
+        dataset.max = std::max(dataset.max, max);
+    }
+
+    return dataset;
+}
+
+std::string read_file(const std::filesystem::path &filepath)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to read file");
+    }
+
+    std::string text(std::filesystem::file_size(filepath), '\0');
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+    return text;
+}
+
+glm::u32vec2 measure_slice(const std::string &text)
+{
+    glm::u32vec2 dimensions(0, 0);
+
+    // Columns are counted on the first line
+    size_t first_line_end = std::min(text.find('\n'), text.size());
+    auto first_line = std::string_view(text).substr(0, first_line_end);
+    if (first_line.find_first_not_of(" \t\r") != std::string_view::npos) {
+        dimensions.x =
+            std::count(first_line.begin(), first_line.end(), ',') + 1;
+
+        // A trailing separator does not start another column
+        size_t last = first_line.find_last_not_of(" \t\r");
+        if (first_line[last] == ',') {
+            dimensions.x--;
+        }
+    }
+
+    // Rows are counted as lines, with or without a final line break
+    dimensions.y = std::count(text.begin(), text.end(), '\n');
+    if (!text.empty() && text.back() != '\n') {
+        dimensions.y++;
+    }
+
+    return dimensions;
+}
+
+std::pair<float, float> parse_slice(
+    const std::string &text,
+    glm::u32vec2 dimensions,
+    float *values)
+{
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+
+    const char *it = text.data();
+    const char *end = text.data() + text.size();
+    auto skip_blanks = [&]() {
+        while (it != end && (*it == ' ' || *it == '\t' || *it == '\r')) {
+            it++;
+        }
+    };
+
+    uint32_t y = 0;
+    while (it != end) {
+        if (y >= dimensions.y) {
+            throw std::runtime_error("Inconsistant dimensions");
+        }
+
+        // Parse one row
+        float *row = values + static_cast<size_t>(y) * dimensions.x;
+        uint32_t x = 0;
+        while (true) {
+            skip_blanks();
+            if (it == end || *it == '\n') {
+                break;
+            }
+            if (*it == '+') {
+                it++;
+            }
+
+            float value;
+            auto [next, error] = std::from_chars(it, end, value);
+            if (error != std::errc()) {
+                throw std::runtime_error("Failed to parse value");
+            }
+            if (x >= dimensions.x) {
                 throw std::runtime_error("Inconsistant dimensions");
             }
-            y++;
+            row[x++] = value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+
+            it = next;
+            skip_blanks();
+            if (it == end || *it == '\n') {
+                break;
+            }
+            if (*it != ',') {
+                throw std::runtime_error("Failed to parse value");
+            }
+            it++;
         }
-        if (z == 0) {
-            dataset.dimensions.y = y;
-        } else if (y != dataset.dimensions.y) {
+
+        if (x != dimensions.x) {
             throw std::runtime_error("Inconsistant dimensions");
         }
-        z++;
-        file.close();
+        if (it != end) {
+            it++;
+        }
+        y++;
     }
-    dataset.dimensions.z = z;
-    return dataset;
+
+    if (y != dimensions.y) {
+        throw std::runtime_error("Inconsistant dimensions");
+    }
+
+    return {min, max};
 }
@@ -8,6 +8,8 @@ class CsvFileParser : public MultiFileParser {
   public:
     CsvFileParser(const std::vector<std::filesystem::path> &filepaths);
 
-    virtual Dataset parse() override;
+    virtual Dataset parse(
+        ImportProgress &progress,
+        std::stop_token stop_token) override;
 };
 }  // namespace Vol::Data
\ No newline at end of file
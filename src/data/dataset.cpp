@@ -0,0 +1,246 @@
+#include "dataset.h"
+
+#include "data/mapped_file.h"
+#include "data/volume_cache.h"
+#include "data/voxel_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+size_t Vol::Data::Dataset::get_voxel_count() const
+{
+    return static_cast<size_t>(dimensions.x) * dimensions.y * dimensions.z;
+}
+
+size_t Vol::Data::Dataset::get_size() const
+{
+    return get_voxel_count() * get_voxel_size(type);
+}
+
+std::span<const std::byte> Vol::Data::Dataset::get_voxels() const
+{
+    if (cache) {
+        throw std::logic_error("Voxels are not resident");
+    }
+    if (mapping) {
+        return {mapping->get_data() + mapping_offset, get_size()};
+    }
+    return {data.data(), data.size()};
+}
+
+void Vol::Data::Dataset::read_voxels(
+    std::byte *dst,
+    std::atomic<float> *progress) const
+{
+    if (cache) {
+        cache->decode(cache_level, dst, progress);
+        return;
+    }
+
+    // Copied in chunks so progress can be reported
+    constexpr size_t chunk_size = 64 * 1024 * 1024;
+    std::span<const std::byte> voxels = get_voxels();
+    for (size_t offset = 0; offset < voxels.size(); offset += chunk_size) {
+        size_t length = std::min(chunk_size, voxels.size() - offset);
+        std::memcpy(dst + offset, &voxels[offset], length);
+        if (progress) {
+            *progress = static_cast<float>(offset + length) / voxels.size();
+        }
+    }
+}
+
+void Vol::Data::Dataset::read_region(
+    glm::ivec3 origin,
+    glm::u32vec3 extent,
+    std::byte *dst) const
+{
+    size_t voxel_size = get_voxel_size(type);
+
+    // Part of the box within the volume, every voxel outside of it is clamped
+    // to its edge
+    glm::ivec3 last = glm::ivec3(dimensions) - glm::ivec3(1);
+    glm::ivec3 begin = glm::clamp(origin, glm::ivec3(0), last);
+    glm::ivec3 end =
+        glm::clamp(
+            origin + glm::ivec3(extent) - glm::ivec3(1), glm::ivec3(0), last) +
+        glm::ivec3(1);
+
+    // Cached voxels are decoded for just that part, resident ones are read
+    // in place
+    std::vector<std::byte> decoded;
+    const std::byte *src;
+    glm::ivec3 src_origin(0);
+    glm::u32vec3 src_dimensions = dimensions;
+    if (cache) {
+        src_origin = begin;
+        src_dimensions = glm::u32vec3(end - begin);
+        decoded.resize(
+            static_cast<size_t>(src_dimensions.x) * src_dimensions.y *
+            src_dimensions.z * voxel_size);
+        cache->read_region(
+            cache_level, glm::u32vec3(begin), src_dimensions, decoded.data());
+        src = decoded.data();
+    } else {
+        src = get_voxels().data();
+    }
+
+    // Rows are copied in one piece, then padded with their first and last
+    // voxel
+    uint32_t pad = static_cast<uint32_t>(begin.x - origin.x);
+    uint32_t inside = static_cast<uint32_t>(end.x - begin.x);
+    size_t src_x = static_cast<size_t>(begin.x - src_origin.x);
+    size_t row_size = extent.x * voxel_size;
+    for (uint32_t z = 0; z < extent.z; z++) {
+        size_t src_z = static_cast<size_t>(
+            std::clamp(origin.z + static_cast<int32_t>(z), begin.z, end.z - 1) -
+            src_origin.z);
+        for (uint32_t y = 0; y < extent.y; y++) {
+            size_t src_y = static_cast<size_t>(
+                std::clamp(
+                    origin.y + static_cast<int32_t>(y), begin.y, end.y - 1) -
+                src_origin.y);
+            const std::byte *row =
+                src + ((src_z * src_dimensions.y + src_y) * src_dimensions.x +
+                       src_x) *
+                          voxel_size;
+            std::byte *dst_row =
+                dst + (static_cast<size_t>(z) * extent.y + y) * row_size;
+
+            for (uint32_t x = 0; x < pad; x++) {
+                std::memcpy(dst_row + x * voxel_size, row, voxel_size);
+            }
+            std::memcpy(dst_row + pad * voxel_size, row, inside * voxel_size);
+            for (uint32_t x = pad + inside; x < extent.x; x++) {
+                std::memcpy(
+                    dst_row + x * voxel_size,
+                    row + (inside - 1) * voxel_size, voxel_size);
+            }
+        }
+    }
+}
+
+size_t Vol::Data::get_voxel_size(VoxelType type)
+{
+    switch (type) {
+        case VoxelType::UInt8: return sizeof(uint8_t);
+        case VoxelType::Int8: return sizeof(int8_t);
+        case VoxelType::UInt16: return sizeof(uint16_t);
+        case VoxelType::Int16: return sizeof(int16_t);
+        case VoxelType::Float16: return sizeof(uint16_t);
+        case VoxelType::Float32: return sizeof(float);
+    }
+    throw std::invalid_argument("Unknown voxel type");
+}
+
+float Vol::Data::half_to_float(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            // Signed zero
+            bits = sign;
+        } else {
+            // Subnormal, renormalize
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x3FF;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    } else if (exponent == 0x1F) {
+        // Infinity or NaN
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+uint16_t Vol::Data::float_to_half(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t float_exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    int32_t exponent = static_cast<int32_t>(float_exponent) - 127 + 15;
+
+    // Infinity or NaN
+    if (float_exponent == 0xFF) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    // Overflow to infinity
+    if (exponent >= 0x1F) {
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+
+    // Underflow to subnormal or zero
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (remainder > midpoint || (remainder == midpoint && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Round to nearest even, carry may promote to the next exponent
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+void Vol::Data::widen_to_float(
+    const std::byte *src,
+    float *dst,
+    size_t count,
+    VoxelType type)
+{
+    switch (type) {
+        case VoxelType::UInt8:
+            convert_to_float(src, dst, count, ScalarType::UInt8);
+            break;
+        case VoxelType::Int8:
+            convert_to_float(src, dst, count, ScalarType::Int8);
+            break;
+        case VoxelType::UInt16:
+            convert_to_float(src, dst, count, ScalarType::UInt16);
+            break;
+        case VoxelType::Int16:
+            convert_to_float(src, dst, count, ScalarType::Int16);
+            break;
+        case VoxelType::Float16: {
+            for (size_t i = 0; i < count; i++) {
+                uint16_t value;
+                std::memcpy(&value, src + i * sizeof(uint16_t), sizeof(value));
+                dst[i] = half_to_float(value);
+            }
+            break;
+        }
+        case VoxelType::Float32: {
+            std::memcpy(dst, src, count * sizeof(float));
+            break;
+        }
+    }
+}
@@ -2,13 +2,86 @@
 
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace Vol::Data
 {
+class CachedVolume;
+class Histogram;
+class MappedFile;
+struct RangeGrid;
+}  // namespace Vol::Data
+
+namespace Vol::Data
+{
+enum class VoxelType {
+    UInt8,
+    Int8,
+    UInt16,
+    Int16,
+    Float16,
+    Float32,
+};
+
 struct Dataset {
     glm::u32vec3 dimensions;
+    VoxelType type;
     float min, max;
-    std::vector<float> data;
+    std::vector<std::byte> data;
+
+    // Voxels may instead live in a memory mapped file, starting at the offset
+    std::shared_ptr<const MappedFile> mapping;
+    size_t mapping_offset = 0;
+
+    // Coarser levels of detail, each half the size of the one before
+    std::vector<Dataset> levels;
+
+    // Value ranges of the volume's bricks and of the finer cells rendering
+    // skips empty space in, if they have been found
+    std::shared_ptr<const RangeGrid> range_grid;
+    std::shared_ptr<const RangeGrid> macrocells;
+
+    // Distribution of the volume's values, which its levels share
+    std::shared_ptr<const Histogram> histogram;
+
+    // Voxels loaded from the cache aren't resident, they are only decoded
+    // when read
+    std::shared_ptr<const CachedVolume> cache;
+    uint32_t cache_level = 0;
+
+    size_t get_voxel_count() const;
+    size_t get_size() const;
+
+    // Resident voxels, which a dataset loaded from the cache doesn't have
+    std::span<const std::byte> get_voxels() const;
+
+    // Writes every voxel to dst, reporting progress as a fraction
+    void read_voxels(
+        std::byte *dst,
+        std::atomic<float> *progress = nullptr) const;
+
+    // Writes a box of voxels to dst x fastest. The box has to overlap the
+    // volume, voxels outside of it repeat the nearest voxel on its edge.
+    void read_region(
+        glm::ivec3 origin,
+        glm::u32vec3 extent,
+        std::byte *dst) const;
 };
-}  // namespace Vol::Data
\ No newline at end of file
+
+size_t get_voxel_size(VoxelType type);
+
+float half_to_float(uint16_t value);
+uint16_t float_to_half(float value);
+
+// Converts count voxels to float, for formats the device can't filter
+void widen_to_float(
+    const std::byte *src,
+    float *dst,
+    size_t count,
+    VoxelType type);
+}  // namespace Vol::Data
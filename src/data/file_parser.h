@@ -4,14 +4,42 @@
 
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <filesystem>
+#include <stop_token>
 #include <string>
+#include <vector>
 
 namespace Vol::Data
 {
+enum class ImportStage {
+    Parsing,
+    Uploading,
+    Transferring,
+};
+
+// Shared between the import job and the UI, a total of zero means unknown
+struct ImportProgress {
+    std::atomic<ImportStage> stage = ImportStage::Parsing;
+    std::atomic<size_t> bytes_read = 0;
+    std::atomic<size_t> bytes_total = 0;
+    std::atomic<uint32_t> slices_parsed = 0;
+    std::atomic<uint32_t> slices_total = 0;
+    std::atomic<float> upload = 0.0f;
+    std::atomic<float> transfer = 0.0f;
+};
+
 class FileParser {
   public:
-    virtual Dataset parse() = 0;
+    virtual ~FileParser() = default;
+
+    // Parsers poll the stop token between slices and throw once it is set
+    virtual Dataset parse(
+        ImportProgress &progress,
+        std::stop_token stop_token) = 0;
+
+    // Files the dataset is read from, which key its cache entry
+    virtual std::vector<std::filesystem::path> get_source_paths() const = 0;
 };
 
 class SingleFileParser : public FileParser {
@@ -19,6 +47,11 @@ class SingleFileParser : public FileParser {
     SingleFileParser(const std::filesystem::path &filepath)
         : filepath(filepath){};
 
+    virtual std::vector<std::filesystem::path> get_source_paths() const override
+    {
+        return {filepath};
+    }
+
   protected:
     const std::filesystem::path &get_filepath() const { return filepath; };
 
@@ -31,6 +64,11 @@ class MultiFileParser : public FileParser {
     MultiFileParser(const std::vector<std::filesystem::path> &filepaths)
         : filepaths(filepaths){};
 
+    virtual std::vector<std::filesystem::path> get_source_paths() const override
+    {
+        return filepaths;
+    }
+
   protected:
     const std::vector<std::filesystem::path> get_filepaths() const
     {
@@ -0,0 +1,197 @@
+#include "histogram.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/dataset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Tasks per thread of the pool when binning, so a slow thread doesn't hold up
+// the rest for long
+const size_t histogram_tasks_per_thread = 4;
+
+// Half floats are stored as their bits
+struct Half {
+    uint16_t bits;
+};
+
+template <typename T>
+void count_voxels(
+    const std::byte *voxels,
+    size_t count,
+    float min,
+    float scale,
+    std::vector<uint64_t> &bins);
+
+Vol::Data::Histogram::Histogram(
+    float min,
+    float max,
+    std::vector<uint64_t> bins)
+    : min(min), max(max), bins(std::move(bins))
+{
+    cumulative.resize(this->bins.size() + 1);
+    for (size_t i = 0; i < this->bins.size(); i++) {
+        cumulative[i + 1] = cumulative[i] + this->bins[i];
+    }
+}
+
+float Vol::Data::Histogram::get_percentile(float fraction) const
+{
+    if (bins.empty() || get_total() == 0) {
+        return min;
+    }
+
+    // Find the bin the fraction ends in, then interpolate within it
+    float target = std::clamp(fraction, 0.0f, 1.0f) * get_total();
+    auto it = std::lower_bound(
+        cumulative.begin() + 1, cumulative.end(),
+        static_cast<uint64_t>(std::ceil(target)));
+    size_t bin = std::min<size_t>(
+        std::distance(cumulative.begin() + 1, it), bins.size() - 1);
+    float within = bins[bin] ? (target - cumulative[bin]) / bins[bin] : 0.0f;
+
+    float bin_width = (max - min) / bins.size();
+    return min + (bin + std::clamp(within, 0.0f, 1.0f)) * bin_width;
+}
+
+std::pair<float, float> Vol::Data::Histogram::get_window() const
+{
+    // Volumes with almost every voxel in one bin keep their full range
+    std::pair<float, float> window = {
+        get_percentile(window_clip_fraction),
+        get_percentile(1.0f - window_clip_fraction),
+    };
+    if (window.second <= window.first) {
+        return {min, max};
+    }
+    return window;
+}
+
+std::vector<float> Vol::Data::Histogram::resample(
+    float min,
+    float max,
+    size_t count) const
+{
+    std::vector<float> columns(count);
+    if (get_total() == 0 || max <= min) {
+        return columns;
+    }
+
+    float column_width = (max - min) / count;
+    float below = get_count_below(min);
+    for (size_t i = 0; i < count; i++) {
+        float next = get_count_below(min + (i + 1) * column_width);
+        columns[i] = (next - below) / get_total();
+        below = next;
+    }
+    return columns;
+}
+
+float Vol::Data::Histogram::get_count_below(float value) const
+{
+    if (value <= min) {
+        return 0.0f;
+    }
+    if (value >= max) {
+        return static_cast<float>(get_total());
+    }
+
+    float position = (value - min) / (max - min) * bins.size();
+    size_t bin = std::min(static_cast<size_t>(position), bins.size() - 1);
+    return cumulative[bin] + (position - bin) * bins[bin];
+}
+
+Vol::Data::Histogram Vol::Data::compute_histogram(
+    const Dataset &dataset,
+    size_t bin_count)
+{
+    const std::byte *voxels = dataset.get_voxels().data();
+    size_t voxel_size = get_voxel_size(dataset.type);
+    size_t slice_count =
+        static_cast<size_t>(dataset.dimensions.x) * dataset.dimensions.y;
+    float scale =
+        dataset.max > dataset.min ? bin_count / (dataset.max - dataset.min)
+                                  : 0.0f;
+
+    // Every task bins a run of slices into its own histogram, so no two
+    // threads ever count into the same bins
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    size_t task_count =
+        (thread_pool.get_thread_count() + 1) * histogram_tasks_per_thread;
+    size_t grain = std::max<size_t>(
+        (dataset.dimensions.z + task_count - 1) / task_count, 1);
+    std::vector<std::vector<uint64_t>> partials(
+        (dataset.dimensions.z + grain - 1) / grain,
+        std::vector<uint64_t>(bin_count));
+    thread_pool.parallel_for(
+        dataset.dimensions.z, grain, [&](size_t begin, size_t end) {
+            const std::byte *slab = voxels + begin * slice_count * voxel_size;
+            size_t count = (end - begin) * slice_count;
+            std::vector<uint64_t> &bins = partials[begin / grain];
+            switch (dataset.type) {
+                case VoxelType::UInt8:
+                    count_voxels<uint8_t>(
+                        slab, count, dataset.min, scale, bins);
+                    break;
+                case VoxelType::Int8:
+                    count_voxels<int8_t>(slab, count, dataset.min, scale, bins);
+                    break;
+                case VoxelType::UInt16:
+                    count_voxels<uint16_t>(
+                        slab, count, dataset.min, scale, bins);
+                    break;
+                case VoxelType::Int16:
+                    count_voxels<int16_t>(
+                        slab, count, dataset.min, scale, bins);
+                    break;
+                case VoxelType::Float16:
+                    count_voxels<Half>(slab, count, dataset.min, scale, bins);
+                    break;
+                case VoxelType::Float32:
+                    count_voxels<float>(slab, count, dataset.min, scale, bins);
+                    break;
+            }
+        });
+
+    // Merge the partial histograms
+    std::vector<uint64_t> bins(bin_count);
+    for (const std::vector<uint64_t> &partial : partials) {
+        for (size_t i = 0; i < bin_count; i++) {
+            bins[i] += partial[i];
+        }
+    }
+
+    return Histogram(dataset.min, dataset.max, std::move(bins));
+}
+
+template <typename T>
+void count_voxels(
+    const std::byte *voxels,
+    size_t count,
+    float min,
+    float scale,
+    std::vector<uint64_t> &bins)
+{
+    float last = static_cast<float>(bins.size() - 1);
+    for (size_t i = 0; i < count; i++) {
+        T voxel;
+        std::memcpy(&voxel, voxels + i * sizeof(T), sizeof(T));
+        float value;
+        if constexpr (std::is_same_v<T, Half>) {
+            value = Vol::Data::half_to_float(voxel.bits);
+        } else {
+            value = static_cast<float>(voxel);
+        }
+
+        // Values that aren't numbers have no place in any bin
+        float position = (value - min) * scale;
+        if (std::isnan(position)) {
+            continue;
+        }
+        bins[static_cast<size_t>(std::clamp(position, 0.0f, last))]++;
+    }
+}
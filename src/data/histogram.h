@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Vol::Data
+{
+struct Dataset;
+}  // namespace Vol::Data
+
+namespace Vol::Data
+{
+// Bins a volume's histogram is computed with unless asked otherwise
+const size_t default_histogram_bins = 256;
+
+// Fraction of voxels left out at either end of a volume's default density
+// window, so a few outliers don't squeeze the rest into a sliver of it
+const float window_clip_fraction = 0.005f;
+
+// Voxel counts in equally wide bins between the volume's min and max. Voxels
+// are assumed to spread evenly within a bin, which is what percentiles and
+// resampling interpolate with.
+class Histogram {
+  public:
+    Histogram(float min, float max, std::vector<uint64_t> bins);
+
+    // Value below which the given fraction of voxels lies
+    float get_percentile(float fraction) const;
+
+    // Density window leaving out the clipped fraction at either end, or the
+    // full range if that would leave an empty window
+    std::pair<float, float> get_window() const;
+
+    // Fraction of voxels in each of count equally wide columns between min
+    // and max
+    std::vector<float> resample(float min, float max, size_t count) const;
+
+    inline float get_min() const { return min; }
+    inline float get_max() const { return max; }
+    inline const std::vector<uint64_t> &get_bins() const { return bins; }
+    inline uint64_t get_total() const { return cumulative.back(); }
+
+  private:
+    // Number of voxels below a value
+    float get_count_below(float value) const;
+
+  private:
+    float min, max;
+    std::vector<uint64_t> bins;
+    std::vector<uint64_t> cumulative;
+};
+
+// Bins every voxel of a dataset with resident voxels across the pool, each
+// task counting into a histogram of its own that is merged at the end
+Histogram compute_histogram(
+    const Dataset &dataset,
+    size_t bin_count = default_histogram_bins);
+}  // namespace Vol::Data
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "image_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Largest block of data deflate stores without compressing it
+const size_t stored_block_size = 65535;
+
+void write_ppm(
+    std::ofstream &file,
+    uint32_t width,
+    uint32_t height,
+    std::span<const uint8_t> pixels);
+
+void write_png(
+    std::ofstream &file,
+    uint32_t width,
+    uint32_t height,
+    std::span<const uint8_t> pixels);
+
+void write_png_chunk(
+    std::ofstream &file,
+    const char *type,
+    const std::vector<uint8_t> &data);
+
+void append_big_endian(std::vector<uint8_t> &bytes, uint32_t value);
+
+uint32_t get_crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+
+void Vol::Data::write_image(
+    const std::filesystem::path &path,
+    uint32_t width,
+    uint32_t height,
+    std::span<const uint8_t> pixels)
+{
+    if (pixels.size() < static_cast<size_t>(width) * height * 4) {
+        throw std::invalid_argument("Image has fewer pixels than its size");
+    }
+
+    std::filesystem::path extension = path.extension();
+    if (extension != ".png" && extension != ".ppm") {
+        throw std::runtime_error(
+            "Unsupported image format " + extension.string());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+
+    if (extension == ".png") {
+        write_png(file, width, height, pixels);
+    } else {
+        write_ppm(file, width, height, pixels);
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+void write_ppm(
+    std::ofstream &file,
+    uint32_t width,
+    uint32_t height,
+    std::span<const uint8_t> pixels)
+{
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    // Binary rows of RGB
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *src = pixels.data() + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            std::copy_n(src + x * 4, 3, row.data() + x * 3);
+        }
+        file.write(reinterpret_cast<const char *>(row.data()), row.size());
+    }
+}
+
+void write_png(
+    std::ofstream &file,
+    uint32_t width,
+    uint32_t height,
+    std::span<const uint8_t> pixels)
+{
+    const std::array<uint8_t, 8> signature = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char *>(signature.data()), 8);
+
+    // 8 bit RGB, neither compressed beyond deflate nor interlaced
+    std::vector<uint8_t> header;
+    append_big_endian(header, width);
+    append_big_endian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    write_png_chunk(file, "IHDR", header);
+
+    // Every row starts with the filter it was stored with, none
+    size_t row_size = static_cast<size_t>(width) * 3 + 1;
+    std::vector<uint8_t> scanlines(row_size * height);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *src = pixels.data() + static_cast<size_t>(y) * width * 4;
+        uint8_t *dst = scanlines.data() + y * row_size;
+        dst[0] = 0;
+        for (uint32_t x = 0; x < width; x++) {
+            std::copy_n(src + x * 4, 3, dst + 1 + x * 3);
+        }
+    }
+
+    // A zlib stream of stored deflate blocks, followed by the Adler-32 of
+    // the scanlines
+    std::vector<uint8_t> data = {0x78, 0x01};
+    size_t block_count =
+        std::max<size_t>((scanlines.size() + stored_block_size - 1) /
+                             stored_block_size,
+                         1);
+    data.reserve(scanlines.size() + block_count * 5 + 6);
+    for (size_t i = 0; i < block_count; i++) {
+        size_t offset = i * stored_block_size;
+        uint16_t length = static_cast<uint16_t>(
+            std::min(stored_block_size, scanlines.size() - offset));
+        data.push_back(i + 1 == block_count ? 1 : 0);
+        data.push_back(length & 0xFF);
+        data.push_back(length >> 8);
+        data.push_back(~length & 0xFF);
+        data.push_back((~length >> 8) & 0xFF);
+        data.insert(
+            data.end(), scanlines.begin() + offset,
+            scanlines.begin() + offset + length);
+    }
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : scanlines) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    append_big_endian(data, (b << 16) | a);
+    write_png_chunk(file, "IDAT", data);
+
+    write_png_chunk(file, "IEND", {});
+}
+
+void write_png_chunk(
+    std::ofstream &file,
+    const char *type,
+    const std::vector<uint8_t> &data)
+{
+    // Length, type, data and the CRC of type and data
+    std::vector<uint8_t> prefix;
+    append_big_endian(prefix, static_cast<uint32_t>(data.size()));
+    prefix.insert(prefix.end(), type, type + 4);
+
+    uint32_t crc = get_crc32(prefix.data() + 4, 4);
+    crc = get_crc32(data.data(), data.size(), crc);
+    std::vector<uint8_t> suffix;
+    append_big_endian(suffix, crc);
+
+    file.write(reinterpret_cast<const char *>(prefix.data()), prefix.size());
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    file.write(reinterpret_cast<const char *>(suffix.data()), suffix.size());
+}
+
+void append_big_endian(std::vector<uint8_t> &bytes, uint32_t value)
+{
+    bytes.insert(
+        bytes.end(),
+        {static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+         static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)});
+}
+
+uint32_t get_crc32(const uint8_t *data, size_t size, uint32_t crc)
+{
+    // Table of the reflected polynomial, built on first use
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
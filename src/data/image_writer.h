@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace Vol::Data
+{
+// Writes rows of RGBA pixels from the top as an image without alpha, PNG or
+// PPM by the extension of the path. PNGs are stored uncompressed, which
+// keeps writing them about as fast as writing a PPM.
+void write_image(
+    const std::filesystem::path &path,
+    uint32_t width,
+    uint32_t height,
+    std::span<const uint8_t> pixels);
+}  // namespace Vol::Data
\ No newline at end of file
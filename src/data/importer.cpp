@@ -1,15 +1,43 @@
 #include "importer.h"
 
 #include "application.h"
+#include "core/thread_pool.h"
 #include "data/csv_file_parser.h"
+#include "data/histogram.h"
 #include "data/nrrd_file_parser.h"
+#include "data/range_grid.h"
+#include "data/volume_cache.h"
+#include "data/volume_pyramid.h"
 #include "rendering/offscreen_pass.h"
 #include "rendering/vulkan_context.h"
 #include "ui/ui_context.h"
 
 #include <nfd.h>
 
+#include <chrono>
+#include <exception>
 #include <memory>
+#include <stdexcept>
+
+// Volumes larger than this are previewed at their first coarser level while
+// the full volume is staged
+const size_t preview_threshold = 256 * 1024 * 1024;
+
+std::unique_ptr<Vol::Data::FileParser> create_file_parser(
+    const std::vector<std::filesystem::path> &filepaths);
+
+std::shared_ptr<Vol::Data::Dataset> read_dataset(
+    Vol::Data::FileParser &file_parser,
+    Vol::Data::ImportProgress &progress,
+    std::stop_token stop_token,
+    std::optional<std::filesystem::path> &uncached_path);
+
+Vol::Rendering::VolumeUpload load_volume(
+    Vol::Data::FileParser &file_parser,
+    Vol::Rendering::OffscreenPass &offscreen_pass,
+    Vol::Data::ImportProgress &progress,
+    std::promise<std::optional<Vol::Rendering::VolumeUpload>> &preview,
+    std::stop_token stop_token);
 
 std::optional<std::filesystem::path> open_file_dialog(
     std::vector<nfdfilteritem_t> filters);
@@ -17,8 +45,23 @@ std::optional<std::filesystem::path> open_file_dialog(
 std::optional<std::vector<std::filesystem::path>> open_multifile_dialog(
     std::vector<nfdfilteritem_t> filters);
 
-void Vol::Data::Importer::import(FileFormat file_format) const
+Vol::Data::Importer::~Importer()
+{
+    // Let a running job finish, then release what it staged
+    cancel();
+    if (job.joinable()) {
+        job.join();
+    }
+    discard_upload();
+}
+
+void Vol::Data::Importer::import(FileFormat file_format)
 {
+    if (importing) {
+        return;
+    }
+    deferred = false;
+
     std::unique_ptr<FileParser> file_parser;
     switch (file_format) {
         case FileFormat::Nrrd: {
@@ -35,20 +78,290 @@ void Vol::Data::Importer::import(FileFormat file_format) const
             break;
         }
     }
-    if (!file_parser) {
+    if (file_parser) {
+        start(std::move(file_parser));
+    }
+}
+
+void Vol::Data::Importer::import(
+    const std::vector<std::filesystem::path> &filepaths,
+    bool deferred)
+{
+    if (importing || filepaths.empty()) {
         return;
     }
-    try {
-        Dataset dataset = file_parser->parse();
-        Application::main()
-            .get_vulkan_context()
-            .get_offscreen_pass()
-            ->volume_dataset_changed(dataset);
-    } catch (std::exception &e) {
-        Application::main().get_ui().show_error("Import Error", e.what());
+    this->deferred = deferred;
+
+    if (auto file_parser = create_file_parser(filepaths)) {
+        start(std::move(file_parser));
+    } else {
+        error = "Unsupported file format " +
+                filepaths.front().extension().string();
+    }
+}
+
+void Vol::Data::Importer::start(std::unique_ptr<FileParser> file_parser)
+{
+    // Reset progress of the previous import
+    progress.stage = ImportStage::Parsing;
+    progress.bytes_read = 0;
+    progress.bytes_total = 0;
+    progress.slices_parsed = 0;
+    progress.slices_total = 0;
+    progress.upload = 0.0f;
+    progress.transfer = 0.0f;
+    error.clear();
+
+    // Parse and stage the volume in the background
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+    std::promise<std::optional<Rendering::VolumeUpload>> preview_promise;
+    std::promise<Rendering::VolumeUpload> promise;
+    preview = preview_promise.get_future();
+    upload = promise.get_future();
+    importing = true;
+    job = std::jthread(
+        [this, offscreen_pass, file_parser = std::move(file_parser),
+         preview_promise = std::move(preview_promise),
+         promise = std::move(promise)](std::stop_token stop_token) mutable {
+            try {
+                promise.set_value(load_volume(
+                    *file_parser, *offscreen_pass, progress, preview_promise,
+                    stop_token));
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        });
+}
+
+void Vol::Data::Importer::resume()
+{
+    deferred = false;
+}
+
+bool Vol::Data::Importer::is_staged()
+{
+    return importing && deferred && upload.valid() &&
+           upload.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+}
+
+void Vol::Data::Importer::update()
+{
+    if (!importing) {
+        return;
+    }
+
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+
+    // Show the preview as soon as it is staged, any failure to stage it is
+    // reported along with the volume. Deferred imports have no preview, it
+    // would replace the volume being rendered.
+    if (preview.valid() && preview.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+        bool cancelled = job.get_stop_source().stop_requested();
+        try {
+            std::optional<Rendering::VolumeUpload> preview_upload =
+                preview.get();
+            if (preview_upload && (cancelled || deferred)) {
+                offscreen_pass->discard_volume(*preview_upload);
+            } else if (preview_upload) {
+                offscreen_pass->submit_volume(*preview_upload);
+            }
+        } catch (std::exception &) {
+        }
+    }
+
+    // Hand the staged volume to the renderer once the job has finished, and
+    // a deferred one once it is resumed
+    if (!deferred && upload.valid() &&
+        upload.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        job.join();
+        bool cancelled = job.get_stop_source().stop_requested();
+        try {
+            Rendering::VolumeUpload volume_upload = upload.get();
+            if (cancelled) {
+                offscreen_pass->discard_volume(volume_upload);
+            } else {
+                offscreen_pass->submit_volume(volume_upload);
+                progress.stage = ImportStage::Transferring;
+            }
+        } catch (std::exception &e) {
+            if (!cancelled) {
+                error = e.what();
+                if (!Application::main().is_headless()) {
+                    Application::main().get_ui().show_error(
+                        "Import Error", e.what());
+                }
+            }
+        }
+    }
+
+    // Copies on the device report their progress once staging is done
+    if (progress.stage == ImportStage::Transferring) {
+        progress.transfer = offscreen_pass->get_upload_progress();
+    }
+
+    // The import is done once the renderer has swapped in the new volume
+    if (!preview.valid() && !upload.valid() &&
+        !offscreen_pass->is_uploading()) {
+        importing = false;
     }
 }
 
+void Vol::Data::Importer::cancel()
+{
+    job.request_stop();
+}
+
+void Vol::Data::Importer::discard_upload()
+{
+    // Importers that never staged anything may have no renderer to ask
+    if (!preview.valid() && !upload.valid()) {
+        return;
+    }
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+
+    if (preview.valid()) {
+        try {
+            std::optional<Rendering::VolumeUpload> preview_upload =
+                preview.get();
+            if (preview_upload) {
+                offscreen_pass->discard_volume(*preview_upload);
+            }
+        } catch (std::exception &) {
+        }
+    }
+
+    if (upload.valid()) {
+        try {
+            Rendering::VolumeUpload volume_upload = upload.get();
+            offscreen_pass->discard_volume(volume_upload);
+        } catch (std::exception &) {
+        }
+    }
+}
+
+std::shared_ptr<const Vol::Data::Dataset> Vol::Data::load_dataset(
+    const std::vector<std::filesystem::path> &filepaths)
+{
+    std::unique_ptr<FileParser> file_parser;
+    if (!filepaths.empty()) {
+        file_parser = create_file_parser(filepaths);
+    }
+    if (!file_parser) {
+        throw std::runtime_error("Unsupported file format");
+    }
+
+    // Datasets rendered without a device are left out of the cache, which
+    // only speeds up imports
+    ImportProgress progress;
+    std::optional<std::filesystem::path> cache_path;
+    return read_dataset(
+        *file_parser, progress, std::stop_token(), cache_path);
+}
+
+std::unique_ptr<Vol::Data::FileParser> create_file_parser(
+    const std::vector<std::filesystem::path> &filepaths)
+{
+    // The format is told by the extension of the first file
+    std::filesystem::path extension = filepaths.front().extension();
+    if (extension == ".csv") {
+        return std::make_unique<Vol::Data::CsvFileParser>(filepaths);
+    }
+    if (extension == ".nrrd" || extension == ".nhdr") {
+        return std::make_unique<Vol::Data::NrrdFileParser>(filepaths.front());
+    }
+    return nullptr;
+}
+
+// Datasets parsed rather than read back from the cache return the path of the
+// cache entry they are to be stored in
+std::shared_ptr<Vol::Data::Dataset> read_dataset(
+    Vol::Data::FileParser &file_parser,
+    Vol::Data::ImportProgress &progress,
+    std::stop_token stop_token,
+    std::optional<std::filesystem::path> &uncached_path)
+{
+    // Files imported before are read back from the cache instead of parsed
+    std::optional<std::filesystem::path> cache_path =
+        Vol::Data::get_cache_path(file_parser.get_source_paths());
+    std::optional<Vol::Data::Dataset> cached;
+    if (cache_path) {
+        cached = Vol::Data::load_cached_volume(*cache_path);
+    }
+
+    std::shared_ptr<Vol::Data::Dataset> dataset;
+    if (cached) {
+        dataset = std::make_shared<Vol::Data::Dataset>(std::move(*cached));
+    } else {
+        dataset = std::make_shared<Vol::Data::Dataset>(
+            file_parser.parse(progress, stop_token));
+        dataset->range_grid = std::make_shared<Vol::Data::RangeGrid>(
+            Vol::Data::compute_range_grid(*dataset));
+        dataset->macrocells = std::make_shared<Vol::Data::RangeGrid>(
+            Vol::Data::compute_macrocell_grid(*dataset));
+        dataset->histogram = std::make_shared<Vol::Data::Histogram>(
+            Vol::Data::compute_histogram(*dataset));
+        dataset->levels = Vol::Data::build_pyramid(*dataset);
+        for (Vol::Data::Dataset &level : dataset->levels) {
+            level.histogram = dataset->histogram;
+        }
+        uncached_path = cache_path;
+    }
+    return dataset;
+}
+
+Vol::Rendering::VolumeUpload load_volume(
+    Vol::Data::FileParser &file_parser,
+    Vol::Rendering::OffscreenPass &offscreen_pass,
+    Vol::Data::ImportProgress &progress,
+    std::promise<std::optional<Vol::Rendering::VolumeUpload>> &preview,
+    std::stop_token stop_token)
+{
+    std::optional<std::filesystem::path> cache_path;
+    std::shared_ptr<Vol::Data::Dataset> dataset =
+        read_dataset(file_parser, progress, stop_token, cache_path);
+
+    // Staging only needs the device, the queue is left to the main thread
+    progress.stage = Vol::Data::ImportStage::Uploading;
+
+    // Large volumes get a preview, staged ahead of the full volume. Volumes
+    // too large for the device only stage their coarser levels, so they
+    // need none.
+    if (dataset->get_size() > preview_threshold && !dataset->levels.empty() &&
+        offscreen_pass.fits_on_device(*dataset)) {
+        preview.set_value(offscreen_pass.stage_volume(
+            std::shared_ptr<const Vol::Data::Dataset>(
+                dataset, &dataset->levels[0])));
+    } else {
+        preview.set_value(std::nullopt);
+    }
+    if (stop_token.stop_requested()) {
+        throw std::runtime_error("Import cancelled");
+    }
+
+    Vol::Rendering::VolumeUpload upload =
+        offscreen_pass.stage_volume(dataset, &progress.upload);
+
+    // Write the cache entry in the background once the volume is staged, a
+    // failure to do so only costs the next import its head start
+    if (cache_path) {
+        Vol::Application::main().get_thread_pool().submit(
+            [dataset = std::shared_ptr<const Vol::Data::Dataset>(dataset),
+             cache_path = *cache_path]() {
+                try {
+                    Vol::Data::store_cached_volume(*dataset, cache_path);
+                } catch (std::exception &) {
+                }
+            });
+    }
+
+    return upload;
+}
+
 std::optional<std::filesystem::path> open_file_dialog(
     std::vector<nfdfilteritem_t> filters)
 {
@@ -1,11 +1,15 @@
 #pragma once
 
-#include <filesystem>
+#include "data/file_parser.h"
+#include "rendering/offscreen_pass.h"
 
-namespace Vol::Data
-{
-class FileParser;
-}  // namespace Vol::Data
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace Vol::Data
 {
@@ -14,8 +18,55 @@ enum class FileFormat {
     CSV,
 };
 
+// Imports run as a background job that parses the dataset, builds its levels
+// of detail and stages it for upload. The staged volume is handed to the
+// renderer on the main thread, which keeps showing the previous volume until
+// the upload has completed. Large volumes are previewed at a coarser level
+// while the full volume is still being staged.
 class Importer {
   public:
-    void import(FileFormat file_format) const;
+    ~Importer();
+
+    void import(FileFormat file_format);
+
+    // Imports the files without asking for them, the format is told by the
+    // extension of the first. Deferred imports are staged but only handed to
+    // the renderer once resumed, so the next dataset can be staged while the
+    // current one is still being rendered.
+    void import(
+        const std::vector<std::filesystem::path> &filepaths,
+        bool deferred = false);
+    void resume();
+
+    void update();
+    void cancel();
+
+    inline bool is_importing() const { return importing; }
+
+    // Whether a deferred import has been staged and waits to be resumed
+    bool is_staged();
+
+    inline const ImportProgress &get_progress() const { return progress; }
+
+    // Why the last import failed, empty if it didn't
+    inline const std::string &get_error() const { return error; }
+
+  private:
+    void start(std::unique_ptr<FileParser> file_parser);
+    void discard_upload();
+
+  private:
+    ImportProgress progress;
+    std::future<std::optional<Rendering::VolumeUpload>> preview;
+    std::future<Rendering::VolumeUpload> upload;
+    std::jthread job;
+    bool importing = false;
+    bool deferred = false;
+    std::string error;
 };
+
+// Reads a dataset on the calling thread without staging it, for rendering
+// without a device. The format is told by the extension of the first file.
+std::shared_ptr<const Dataset> load_dataset(
+    const std::vector<std::filesystem::path> &filepaths);
 }  // namespace Vol::Data
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+Vol::Data::MappedFile::MappedFile(FILE *file, bool copy_on_write)
+{
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to get file handle");
+    }
+
+    // Query file size
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0) {
+        throw std::runtime_error("Failed to get file size");
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+
+    // Create mapping of the whole file
+    mapping = CreateFileMappingW(
+        handle, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0,
+        nullptr);
+    if (!mapping) {
+        throw std::runtime_error("Failed to create file mapping");
+    }
+
+    // Map view of the file
+    data = static_cast<std::byte *>(MapViewOfFile(
+        mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        CloseHandle(mapping);
+        throw std::runtime_error("Failed to map file");
+    }
+}
+
+Vol::Data::MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+}
+#else
+Vol::Data::MappedFile::MappedFile(FILE *file, bool copy_on_write)
+{
+    int descriptor = fileno(file);
+
+    // Query file size
+    struct stat file_stat;
+    if (fstat(descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+        throw std::runtime_error("Failed to get file size");
+    }
+    size = static_cast<size_t>(file_stat.st_size);
+
+    // Map the whole file, private so writes never reach the disk
+    int protection = PROT_READ | (copy_on_write ? PROT_WRITE : 0);
+    void *address =
+        mmap(nullptr, size, protection, MAP_PRIVATE, descriptor, 0);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file");
+    }
+    data = static_cast<std::byte *>(address);
+
+    // Voxels are consumed front to back, let the kernel read ahead
+    madvise(address, size, MADV_SEQUENTIAL);
+}
+
+Vol::Data::MappedFile::~MappedFile()
+{
+    munmap(data, size);
+}
+#endif
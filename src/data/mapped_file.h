@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+namespace Vol::Data
+{
+class MappedFile {
+  public:
+    // Maps the whole of an open file into memory. A copy on write mapping
+    // can be modified in place without touching the file on disk.
+    MappedFile(FILE *file, bool copy_on_write = false);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    inline std::byte *get_data() const { return data; }
+    inline size_t get_size() const { return size; }
+
+  private:
+    std::byte *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *mapping = nullptr;
+#endif
+};
+}  // namespace Vol::Data
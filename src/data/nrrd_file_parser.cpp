@@ -1,77 +1,344 @@
 #include "nrrd_file_parser.h"
 
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/mapped_file.h"
+#include "data/voxel_kernels.h"
+
 #include <NrrdIO.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <exception>
 #include <iostream>
-#include <map>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Voxels per block when converting a decoded volume across the thread pool
+const size_t convert_block_size = 1 << 20;
+
+Vol::Data::Dataset load_decoded(const std::string &path);
+
+Vol::Data::Dataset load_mapped(
+    NrrdIoState *nio,
+    const Nrrd *nrrd,
+    Vol::Data::ImportProgress &progress,
+    std::stop_token stop_token);
+
+void close_nrrd(Nrrd *nrrd, NrrdIoState *nio);
+
+glm::u32vec3 get_dimensions(const Nrrd *nrrd);
 
-std::vector<float> convert(void *data, int nrrd_type, glm::u32vec3 dimensions);
+Vol::Data::ScalarType get_scalar_type(int nrrd_type);
 
-template <typename T>
-std::vector<float> convert(void *data, size_t size);
+std::optional<Vol::Data::VoxelType> get_voxel_type(int nrrd_type);
+
+uint64_t tell(FILE *file);
+
+void swap_bytes(std::byte *data, size_t count, size_t element_size);
+
+std::pair<float, float> merge_ranges(
+    const std::vector<std::pair<float, float>> &ranges);
+
+Vol::Data::Dataset convert(
+    const std::byte *data,
+    int nrrd_type,
+    glm::u32vec3 dimensions);
 
 Vol::Data::NrrdFileParser::NrrdFileParser(const std::filesystem::path &filepath)
     : SingleFileParser(filepath)
 {
 }
 
-Vol::Data::Dataset Vol::Data::NrrdFileParser::parse()
+Vol::Data::Dataset Vol::Data::NrrdFileParser::parse(
+    ImportProgress &progress,
+    std::stop_token stop_token)
 {
+    std::string path = get_filepath().string();
+
+    // Read the header only, keeping the data file open at the start of the data
+    NrrdIoState *nio = nrrdIoStateNew();
+    nrrdIoStateSet(nio, nrrdIoStateSkipData, AIR_TRUE);
+    nrrdIoStateSet(nio, nrrdIoStateKeepNrrdDataFileOpen, AIR_TRUE);
+
     Nrrd *nrrd_file = nrrdNew();
-    if (nrrdLoad(nrrd_file, get_filepath().string().c_str(), nullptr)) {
+    if (nrrdLoad(nrrd_file, path.c_str(), nio)) {
+        nrrdIoStateNix(nio);
+        nrrdNuke(nrrd_file);
         throw std::runtime_error("Failed to read file");
     }
 
     if (nrrd_file->dim != 3) {
+        close_nrrd(nrrd_file, nio);
         throw std::runtime_error("Invalid file properties");
     }
 
-    NrrdAxisInfo *axis = nrrd_file->axis;
-    glm::u32vec3 dimensions(axis[0].size, axis[1].size, axis[2].size);
+    // Encoded data has to be decoded into memory by NrrdIO
+    if (!nio->dataFile || nio->encoding != nrrdEncodingRaw) {
+        close_nrrd(nrrd_file, nio);
+        return load_decoded(path);
+    }
 
-    std::vector<float> data =
-        convert(nrrd_file->data, nrrd_file->type, dimensions);
-    Dataset dataset{
-        .dimensions = dimensions,
-        .min = *std::min_element(data.begin(), data.end()),
-        .max = *std::max_element(data.begin(), data.end()),
-        .data = data,
-    };
+    // Raw data is mapped and read in place
+    Dataset dataset;
+    try {
+        dataset = load_mapped(nio, nrrd_file, progress, stop_token);
+    } catch (...) {
+        close_nrrd(nrrd_file, nio);
+        throw;
+    }
+
+    close_nrrd(nrrd_file, nio);
+
+    return dataset;
+}
+
+Vol::Data::Dataset load_decoded(const std::string &path)
+{
+    Nrrd *nrrd_file = nrrdNew();
+    if (nrrdLoad(nrrd_file, path.c_str(), nullptr)) {
+        nrrdNuke(nrrd_file);
+        throw std::runtime_error("Failed to read file");
+    }
+
+    if (nrrd_file->dim != 3) {
+        nrrdNuke(nrrd_file);
+        throw std::runtime_error("Invalid file properties");
+    }
+
+    Vol::Data::Dataset dataset;
+    try {
+        dataset = convert(
+            static_cast<const std::byte *>(nrrd_file->data), nrrd_file->type,
+            get_dimensions(nrrd_file));
+    } catch (...) {
+        nrrdNuke(nrrd_file);
+        throw;
+    }
 
     nrrdNuke(nrrd_file);
 
     return dataset;
 }
 
-std::vector<float> convert(void *data, int nrrd_type, glm::u32vec3 dimensions)
+Vol::Data::Dataset load_mapped(
+    NrrdIoState *nio,
+    const Nrrd *nrrd,
+    Vol::Data::ImportProgress &progress,
+    std::stop_token stop_token)
 {
-    size_t size = (size_t)dimensions.x * dimensions.y * dimensions.z;
+    glm::u32vec3 dimensions = get_dimensions(nrrd);
+    size_t count = nrrdElementNumber(nrrd);
+    size_t element_size = nrrdElementSize(nrrd);
+
+    // Line and byte skips have already been applied to the data file
+    uint64_t offset = tell(nio->dataFile);
+
+    // Data in foreign byte order is swapped within private copies of the pages
+    bool swap = element_size > 1 && nio->endian != airEndianUnknown &&
+                nio->endian != airMyEndian();
+
+    auto mapping = std::make_shared<Vol::Data::MappedFile>(nio->dataFile, swap);
+    if (offset + count * element_size > mapping->get_size()) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+
+    std::byte *voxels = mapping->get_data() + offset;
+    Vol::Data::ScalarType scalar_type = get_scalar_type(nrrd->type);
+    std::optional<Vol::Data::VoxelType> type = get_voxel_type(nrrd->type);
+
+    // Types without a matching sampled image format are widened while the
+    // mapping is read, the rest are referenced in place
+    std::vector<std::byte> widened;
+    if (!type) {
+        widened.resize(count * sizeof(float));
+    }
+    float *widened_voxels = reinterpret_cast<float *>(widened.data());
+
+    progress.bytes_total = count * element_size;
+    progress.slices_total = dimensions.z;
+
+    // Walk the mapping slice by slice across the pool, which pages the file in
+    size_t slice_count = static_cast<size_t>(dimensions.x) * dimensions.y;
+    size_t slice_size = slice_count * element_size;
+    std::vector<std::pair<float, float>> ranges(dimensions.z);
+    Vol::Core::ThreadPool &thread_pool =
+        Vol::Application::main().get_thread_pool();
+    thread_pool.parallel_for(dimensions.z, 1, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++) {
+            if (stop_token.stop_requested()) {
+                throw std::runtime_error("Import cancelled");
+            }
+
+            std::byte *slice = voxels + z * slice_size;
+            if (swap) {
+                swap_bytes(slice, slice_count, element_size);
+            }
+            if (type) {
+                ranges[z] =
+                    Vol::Data::find_range(slice, slice_count, scalar_type);
+            } else {
+                ranges[z] = Vol::Data::convert_to_float(
+                    slice, widened_voxels + z * slice_count, slice_count,
+                    scalar_type);
+            }
+
+            progress.bytes_read += slice_size;
+            progress.slices_parsed++;
+        }
+    });
+    auto [min, max] = merge_ranges(ranges);
+
+    if (!type) {
+        return Vol::Data::Dataset{
+            .dimensions = dimensions,
+            .type = Vol::Data::VoxelType::Float32,
+            .min = min,
+            .max = max,
+            .data = std::move(widened),
+        };
+    }
+
+    return Vol::Data::Dataset{
+        .dimensions = dimensions,
+        .type = *type,
+        .min = min,
+        .max = max,
+        .mapping = std::move(mapping),
+        .mapping_offset = static_cast<size_t>(offset),
+    };
+}
+
+void close_nrrd(Nrrd *nrrd, NrrdIoState *nio)
+{
+    if (nio->dataFile) {
+        airFclose(nio->dataFile);
+    }
+    nrrdIoStateNix(nio);
+    nrrdNuke(nrrd);
+}
+
+glm::u32vec3 get_dimensions(const Nrrd *nrrd)
+{
+    const NrrdAxisInfo *axis = nrrd->axis;
+    return glm::u32vec3(axis[0].size, axis[1].size, axis[2].size);
+}
+
+Vol::Data::ScalarType get_scalar_type(int nrrd_type)
+{
+    using Vol::Data::ScalarType;
+
+    switch (nrrd_type) {
+        case nrrdTypeChar: return ScalarType::Int8;
+        case nrrdTypeUChar: return ScalarType::UInt8;
+        case nrrdTypeShort: return ScalarType::Int16;
+        case nrrdTypeUShort: return ScalarType::UInt16;
+        case nrrdTypeInt: return ScalarType::Int32;
+        case nrrdTypeUInt: return ScalarType::UInt32;
+        case nrrdTypeLLong: return ScalarType::Int64;
+        case nrrdTypeULLong: return ScalarType::UInt64;
+        case nrrdTypeFloat: return ScalarType::Float32;
+        case nrrdTypeDouble: return ScalarType::Float64;
+    }
+    throw std::runtime_error("Unsupported data type");
+}
+
+std::optional<Vol::Data::VoxelType> get_voxel_type(int nrrd_type)
+{
+    using Vol::Data::VoxelType;
+
     switch (nrrd_type) {
-        case nrrdTypeChar: return convert<int8_t>(data, size);
-        case nrrdTypeUChar: return convert<uint8_t>(data, size);
-        case nrrdTypeShort: return convert<int16_t>(data, size);
-        case nrrdTypeUShort: return convert<uint16_t>(data, size);
-        case nrrdTypeInt: return convert<int32_t>(data, size);
-        case nrrdTypeUInt: return convert<uint32_t>(data, size);
-        case nrrdTypeLLong: return convert<int64_t>(data, size);
-        case nrrdTypeULLong: return convert<uint64_t>(data, size);
-        case nrrdTypeFloat: return convert<float>(data, size);
-        case nrrdTypeDouble: return convert<double>(data, size);
+        case nrrdTypeChar: return VoxelType::Int8;
+        case nrrdTypeUChar: return VoxelType::UInt8;
+        case nrrdTypeShort: return VoxelType::Int16;
+        case nrrdTypeUShort: return VoxelType::UInt16;
+        case nrrdTypeFloat: return VoxelType::Float32;
     }
-    return std::vector<float>();
+    return std::nullopt;
+}
+
+uint64_t tell(FILE *file)
+{
+#ifdef _WIN32
+    return static_cast<uint64_t>(_ftelli64(file));
+#else
+    return static_cast<uint64_t>(ftello(file));
+#endif
 }
 
-template <typename T>
-std::vector<float> convert(void *data, size_t size)
+void swap_bytes(std::byte *data, size_t count, size_t element_size)
 {
-    T *d = static_cast<T *>(data);
-    std::vector<float> result(size);
+    for (size_t i = 0; i < count; i++) {
+        std::byte *element = data + i * element_size;
+        std::reverse(element, element + element_size);
+    }
+}
 
-    for (size_t i = 0; i < size; i++) {
-        result[i] = static_cast<float>(d[i]);
+std::pair<float, float> merge_ranges(
+    const std::vector<std::pair<float, float>> &ranges)
+{
+    std::pair<float, float> range = {
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::lowest(),
+    };
+    for (const std::pair<float, float> &part : ranges) {
+        range = Vol::Data::merge_ranges(range, part);
     }
-    return result;
+    return range;
+}
+
+Vol::Data::Dataset convert(
+    const std::byte *data,
+    int nrrd_type,
+    glm::u32vec3 dimensions)
+{
+    using Vol::Data::VoxelType;
+
+    Vol::Data::ScalarType scalar_type = get_scalar_type(nrrd_type);
+    std::optional<VoxelType> type = get_voxel_type(nrrd_type);
+    size_t element_size = Vol::Data::get_scalar_size(scalar_type);
+    size_t count = (size_t)dimensions.x * dimensions.y * dimensions.z;
+
+    // Types with a matching sampled image format are kept as is, the rest are
+    // widened to float
+    Vol::Data::Dataset dataset{
+        .dimensions = dimensions,
+        .type = type.value_or(VoxelType::Float32),
+        .data = std::vector<std::byte>(
+            count * (type ? element_size : sizeof(float))),
+    };
+    std::byte *copied = dataset.data.data();
+    float *widened = reinterpret_cast<float *>(dataset.data.data());
+
+    // Copy or widen blocks across the pool, finding the range of each block
+    // while it is still in cache
+    size_t block_count = (count + convert_block_size - 1) / convert_block_size;
+    std::vector<std::pair<float, float>> ranges(block_count);
+    Vol::Core::ThreadPool &thread_pool =
+        Vol::Application::main().get_thread_pool();
+    thread_pool.parallel_for(block_count, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; block++) {
+            size_t first = block * convert_block_size;
+            size_t length = std::min(convert_block_size, count - first);
+            const std::byte *src = data + first * element_size;
+            if (type) {
+                std::byte *dst = copied + first * element_size;
+                std::memcpy(dst, src, length * element_size);
+                ranges[block] =
+                    Vol::Data::find_range(dst, length, scalar_type);
+            } else {
+                ranges[block] = Vol::Data::convert_to_float(
+                    src, widened + first, length, scalar_type);
+            }
+        }
+    });
+    std::tie(dataset.min, dataset.max) = merge_ranges(ranges);
+
+    return dataset;
 }
@@ -8,6 +8,8 @@ class NrrdFileParser : public SingleFileParser {
   public:
     explicit NrrdFileParser(const std::filesystem::path &filepath);
 
-    virtual Dataset parse() override;
+    virtual Dataset parse(
+        ImportProgress &progress,
+        std::stop_token stop_token) override;
 };
 }  // namespace Vol::Data
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "range_grid.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/dataset.h"
+#include "data/voxel_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+std::pair<float, float> find_box_range(
+    const Vol::Data::Dataset &dataset,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent);
+
+std::pair<float, float> find_row_range(
+    const std::byte *row,
+    size_t count,
+    Vol::Data::VoxelType type);
+
+glm::u32vec3 Vol::Data::get_brick_grid_dimensions(
+    glm::u32vec3 volume_dimensions)
+{
+    glm::u32vec3 size(brick_size);
+    return (volume_dimensions + size - glm::u32vec3(1)) / size;
+}
+
+glm::u32vec3 Vol::Data::get_brick_origin(
+    size_t index,
+    glm::u32vec3 volume_dimensions)
+{
+    glm::u32vec3 grid = get_brick_grid_dimensions(volume_dimensions);
+    size_t layer = static_cast<size_t>(grid.x) * grid.y;
+    glm::u32vec3 brick(
+        static_cast<uint32_t>(index % grid.x),
+        static_cast<uint32_t>(index / grid.x % grid.y),
+        static_cast<uint32_t>(index / layer));
+    return brick * brick_size;
+}
+
+glm::u32vec3 Vol::Data::get_brick_extent(
+    glm::u32vec3 origin,
+    glm::u32vec3 volume_dimensions)
+{
+    return glm::min(glm::u32vec3(brick_size), volume_dimensions - origin);
+}
+
+Vol::Data::RangeGrid Vol::Data::compute_range_grid(const Dataset &dataset)
+{
+    RangeGrid grid;
+    grid.dimensions = get_brick_grid_dimensions(dataset.dimensions);
+    grid.ranges.resize(
+        static_cast<size_t>(grid.dimensions.x) * grid.dimensions.y *
+        grid.dimensions.z);
+
+    // Bricks are independent, reduce each across the pool
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    thread_pool.parallel_for(
+        grid.ranges.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                glm::u32vec3 origin = get_brick_origin(i, dataset.dimensions);
+                glm::u32vec3 extent =
+                    get_brick_extent(origin, dataset.dimensions);
+                grid.ranges[i] = find_box_range(dataset, origin, extent);
+            }
+        });
+
+    return grid;
+}
+
+glm::u32vec3 Vol::Data::get_macrocell_grid_dimensions(
+    glm::u32vec3 volume_dimensions)
+{
+    glm::u32vec3 size(macrocell_size);
+    return (volume_dimensions + size - glm::u32vec3(1)) / size;
+}
+
+Vol::Data::RangeGrid Vol::Data::compute_macrocell_grid(const Dataset &dataset)
+{
+    RangeGrid grid;
+    grid.dimensions = get_macrocell_grid_dimensions(dataset.dimensions);
+    grid.ranges.resize(
+        static_cast<size_t>(grid.dimensions.x) * grid.dimensions.y *
+        grid.dimensions.z);
+
+    // Cells are small, so every task reduces a whole row of them
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    size_t row_count =
+        static_cast<size_t>(grid.dimensions.y) * grid.dimensions.z;
+    thread_pool.parallel_for(row_count, 1, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            for (uint32_t x = 0; x < grid.dimensions.x; x++) {
+                glm::u32vec3 cell(
+                    x, static_cast<uint32_t>(row % grid.dimensions.y),
+                    static_cast<uint32_t>(row / grid.dimensions.y));
+                glm::u32vec3 origin = cell * macrocell_size;
+                glm::u32vec3 first =
+                    glm::max(origin, glm::u32vec3(1)) - glm::u32vec3(1);
+                glm::u32vec3 last = glm::min(
+                    origin + glm::u32vec3(macrocell_size + 1),
+                    dataset.dimensions);
+                grid.ranges[row * grid.dimensions.x + x] =
+                    find_box_range(dataset, first, last - first);
+            }
+        }
+    });
+
+    return grid;
+}
+
+std::pair<float, float> find_box_range(
+    const Vol::Data::Dataset &dataset,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent)
+{
+    const std::byte *voxels = dataset.get_voxels().data();
+    size_t voxel_size = Vol::Data::get_voxel_size(dataset.type);
+    size_t row_size = static_cast<size_t>(dataset.dimensions.x) * voxel_size;
+    size_t slice_size = row_size * dataset.dimensions.y;
+
+    // Reduce the box row by row
+    std::pair<float, float> range = {
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::lowest(),
+    };
+    for (uint32_t z = origin.z; z < origin.z + extent.z; z++) {
+        for (uint32_t y = origin.y; y < origin.y + extent.y; y++) {
+            const std::byte *row = voxels + z * slice_size + y * row_size +
+                                   origin.x * voxel_size;
+            range = Vol::Data::merge_ranges(
+                range, find_row_range(row, extent.x, dataset.type));
+        }
+    }
+    return range;
+}
+
+std::pair<float, float> find_row_range(
+    const std::byte *row,
+    size_t count,
+    Vol::Data::VoxelType type)
+{
+    using Vol::Data::ScalarType;
+    using Vol::Data::VoxelType;
+
+    switch (type) {
+        case VoxelType::UInt8:
+            return Vol::Data::find_range(row, count, ScalarType::UInt8);
+        case VoxelType::Int8:
+            return Vol::Data::find_range(row, count, ScalarType::Int8);
+        case VoxelType::UInt16:
+            return Vol::Data::find_range(row, count, ScalarType::UInt16);
+        case VoxelType::Int16:
+            return Vol::Data::find_range(row, count, ScalarType::Int16);
+        case VoxelType::Float32:
+            return Vol::Data::find_range(row, count, ScalarType::Float32);
+        case VoxelType::Float16: break;
+    }
+
+    // Half floats have no kernel, they never come out of a parser in bulk
+    std::pair<float, float> range = {
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::lowest(),
+    };
+    for (size_t i = 0; i < count; i++) {
+        uint16_t bits;
+        std::memcpy(&bits, row + i * sizeof(uint16_t), sizeof(bits));
+        float value = Vol::Data::half_to_float(bits);
+        if (value == value) {
+            range.first = std::min(range.first, value);
+            range.second = std::max(range.second, value);
+        }
+    }
+    return range;
+}
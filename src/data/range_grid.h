@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Vol::Data
+{
+struct Dataset;
+}  // namespace Vol::Data
+
+namespace Vol::Data
+{
+// Edge length of the bricks volumes are cached and summarized in, in voxels
+const uint32_t brick_size = 64;
+
+// Value range of every brick of a volume, coarse enough to keep around for
+// skipping empty space. Bricks are ordered x fastest.
+struct RangeGrid {
+    glm::u32vec3 dimensions;
+    std::vector<std::pair<float, float>> ranges;
+};
+
+// Number of bricks along each axis, bricks on the far edges may be partial
+glm::u32vec3 get_brick_grid_dimensions(glm::u32vec3 volume_dimensions);
+
+// First voxel and extent of a brick, given its index in x fastest order
+glm::u32vec3 get_brick_origin(size_t index, glm::u32vec3 volume_dimensions);
+glm::u32vec3 get_brick_extent(
+    glm::u32vec3 origin,
+    glm::u32vec3 volume_dimensions);
+
+// Finds the range of every brick of a dataset with resident voxels
+RangeGrid compute_range_grid(const Dataset &dataset);
+
+// Edge length of the cells rendering skips empty space in, in voxels
+const uint32_t macrocell_size = 16;
+
+// Number of macrocells along each axis, cells on the far edges may be partial
+glm::u32vec3 get_macrocell_grid_dimensions(glm::u32vec3 volume_dimensions);
+
+// Finds the range of every macrocell of a dataset with resident voxels. Each
+// range takes in a voxel beyond every side of its cell, which filtering near
+// the cell's faces blends in.
+RangeGrid compute_macrocell_grid(const Dataset &dataset);
+}  // namespace Vol::Data
\ No newline at end of file
@@ -0,0 +1,707 @@
+#include "volume_cache.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/brick_codec.h"
+#include "data/mapped_file.h"
+#include "data/volume_pyramid.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+// Bumped whenever the layout changes, which also changes every cache key
+const char cache_magic[8] = {'V', 'O', 'L', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t cache_version = 4;
+
+// Histograms with more bins than this are rejected as malformed
+const uint32_t max_histogram_bins = 1 << 16;
+
+// Bricks compressed at once while an entry is written, which bounds the
+// memory a write holds on to
+const size_t cache_batch = 64;
+
+// Least recently used entries are evicted once the cache outgrows this
+const uintmax_t cache_capacity = 16ull << 30;
+
+// Followed by the dimensions of every level, the histogram bins and macrocell
+// ranges of the finest level, then the index of every brick of every level
+// from the finest level to the coarsest
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t brick_size;
+    uint32_t type;
+    uint32_t level_count;
+    float min, max;
+    uint64_t brick_count;
+    uint32_t histogram_bins;
+    uint32_t reserved;
+};
+
+std::filesystem::path get_cache_directory();
+
+void evict_cache_entries(const std::filesystem::path &keep);
+
+void write_bytes(std::ofstream &file, const void *data, size_t size);
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size);
+
+void gather_brick(
+    const std::byte *voxels,
+    std::byte *brick,
+    glm::u32vec3 dimensions,
+    size_t voxel_size,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent);
+
+void scatter_brick(
+    const std::byte *brick,
+    std::byte *voxels,
+    glm::u32vec3 dimensions,
+    size_t voxel_size,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent);
+
+size_t get_brick_size(glm::u32vec3 extent, size_t voxel_size);
+
+size_t get_voxel_offset(
+    glm::u32vec3 position,
+    glm::u32vec3 dimensions,
+    size_t voxel_size);
+
+size_t get_brick_count(glm::u32vec3 dimensions);
+
+Vol::Data::CachedVolume::CachedVolume(const std::filesystem::path &path)
+{
+    FILE *file = std::fopen(path.string().c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Failed to open cache");
+    }
+    try {
+        mapping = std::make_unique<MappedFile>(file);
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+    std::fclose(file);
+
+    const std::byte *data = mapping->get_data();
+    size_t size = mapping->get_size();
+
+    // Validate header
+    CacheHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Invalid cache header");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version || header.brick_size != brick_size ||
+        header.type > static_cast<uint32_t>(VoxelType::Float32) ||
+        header.level_count == 0 || header.level_count > 32 ||
+        header.histogram_bins == 0 ||
+        header.histogram_bins > max_histogram_bins) {
+        throw std::runtime_error("Invalid cache header");
+    }
+
+    type = static_cast<VoxelType>(header.type);
+    min = header.min;
+    max = header.max;
+
+    // Validate levels, each must halve the one before
+    size_t levels_size = header.level_count * sizeof(uint32_t[3]);
+    if (size < sizeof(header) + levels_size) {
+        throw std::runtime_error("Invalid cache levels");
+    }
+    size_t brick_count = 0;
+    for (uint32_t i = 0; i < header.level_count; i++) {
+        uint32_t level_dimensions[3];
+        std::memcpy(
+            level_dimensions, data + sizeof(header) + i * sizeof(uint32_t[3]),
+            sizeof(uint32_t[3]));
+        glm::u32vec3 dimensions(
+            level_dimensions[0], level_dimensions[1], level_dimensions[2]);
+        if (dimensions.x == 0 || dimensions.y == 0 || dimensions.z == 0 ||
+            (i > 0 && dimensions !=
+                          get_level_dimensions(levels.back().dimensions))) {
+            throw std::runtime_error("Invalid cache levels");
+        }
+
+        levels.push_back(Level{
+            .dimensions = dimensions,
+            .first_brick = brick_count,
+        });
+        brick_count += get_brick_count(dimensions);
+    }
+
+    // Read the histogram, which follows the levels
+    size_t histogram_offset = sizeof(header) + levels_size;
+    size_t histogram_size = header.histogram_bins * sizeof(uint64_t);
+    if (size < histogram_offset + histogram_size) {
+        throw std::runtime_error("Invalid cache histogram");
+    }
+    histogram_bins.resize(header.histogram_bins);
+    std::memcpy(
+        histogram_bins.data(), data + histogram_offset, histogram_size);
+
+    // Read the macrocell ranges, which follow the histogram
+    size_t macrocells_offset = histogram_offset + histogram_size;
+    glm::u32vec3 macrocell_grid =
+        get_macrocell_grid_dimensions(levels[0].dimensions);
+    size_t macrocells_size = static_cast<size_t>(macrocell_grid.x) *
+                             macrocell_grid.y * macrocell_grid.z *
+                             sizeof(float[2]);
+    if (size < macrocells_offset + macrocells_size) {
+        throw std::runtime_error("Invalid cache macrocells");
+    }
+    macrocell_ranges.resize(macrocells_size / sizeof(float));
+    std::memcpy(
+        macrocell_ranges.data(), data + macrocells_offset, macrocells_size);
+
+    size_t index_offset = macrocells_offset + macrocells_size;
+    if (header.brick_count != brick_count ||
+        size < index_offset + brick_count * sizeof(CacheBrick)) {
+        throw std::runtime_error("Invalid cache index");
+    }
+
+    // Validate index, bricks must lie within the file
+    bricks.resize(brick_count);
+    std::memcpy(
+        bricks.data(), data + index_offset, brick_count * sizeof(CacheBrick));
+    size_t voxel_size = get_voxel_size(type);
+    for (const Level &level : levels) {
+        size_t level_brick_count = get_brick_count(level.dimensions);
+        for (size_t i = 0; i < level_brick_count; i++) {
+            const CacheBrick &brick = bricks[level.first_brick + i];
+            glm::u32vec3 extent = get_brick_extent(
+                get_brick_origin(i, level.dimensions), level.dimensions);
+            if (brick.offset > size || brick.size > size - brick.offset ||
+                brick.size > get_brick_size(extent, voxel_size)) {
+                throw std::runtime_error("Invalid cache index");
+            }
+        }
+    }
+}
+
+Vol::Data::CachedVolume::~CachedVolume() = default;
+
+void Vol::Data::CachedVolume::decode(
+    uint32_t level,
+    std::byte *dst,
+    std::atomic<float> *progress) const
+{
+    glm::u32vec3 dimensions = levels[level].dimensions;
+    size_t first_brick = levels[level].first_brick;
+    size_t brick_count = get_brick_count(dimensions);
+    size_t voxel_size = get_voxel_size(type);
+    std::atomic<size_t> decoded = 0;
+
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    thread_pool.parallel_for(brick_count, 1, [&](size_t begin, size_t end) {
+        thread_local std::vector<std::byte> decompressed;
+
+        for (size_t i = begin; i < end; i++) {
+            glm::u32vec3 origin = get_brick_origin(i, dimensions);
+            glm::u32vec3 extent = get_brick_extent(origin, dimensions);
+            const std::byte *voxels = read_brick(
+                first_brick + i, get_brick_size(extent, voxel_size),
+                decompressed);
+            scatter_brick(
+                voxels, dst, dimensions, voxel_size, origin, extent);
+
+            if (progress) {
+                *progress = static_cast<float>(++decoded) / brick_count;
+            }
+        }
+    });
+}
+
+void Vol::Data::CachedVolume::read_region(
+    uint32_t level,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent,
+    std::byte *dst) const
+{
+    thread_local std::vector<std::byte> decompressed;
+
+    glm::u32vec3 dimensions = levels[level].dimensions;
+    glm::u32vec3 grid = get_brick_grid_dimensions(dimensions);
+    size_t voxel_size = get_voxel_size(type);
+    glm::u32vec3 end = origin + extent;
+    glm::u32vec3 first = origin / glm::u32vec3(brick_size);
+    glm::u32vec3 last = (end - glm::u32vec3(1)) / glm::u32vec3(brick_size);
+
+    for (uint32_t z = first.z; z <= last.z; z++) {
+        for (uint32_t y = first.y; y <= last.y; y++) {
+            for (uint32_t x = first.x; x <= last.x; x++) {
+                size_t index =
+                    (static_cast<size_t>(z) * grid.y + y) * grid.x + x;
+                glm::u32vec3 brick_origin = get_brick_origin(index, dimensions);
+                glm::u32vec3 brick_extent =
+                    get_brick_extent(brick_origin, dimensions);
+                const std::byte *voxels = read_brick(
+                    levels[level].first_brick + index,
+                    get_brick_size(brick_extent, voxel_size), decompressed);
+
+                // Copy the rows of the brick that lie within the box
+                glm::u32vec3 begin = glm::max(origin, brick_origin);
+                glm::u32vec3 stop = glm::min(end, brick_origin + brick_extent);
+                size_t row_size = (stop.x - begin.x) * voxel_size;
+                for (glm::u32vec3 p = begin; p.z < stop.z; p.z++) {
+                    for (p.y = begin.y; p.y < stop.y; p.y++) {
+                        std::memcpy(
+                            dst + get_voxel_offset(
+                                      p - origin, extent, voxel_size),
+                            voxels + get_voxel_offset(
+                                         p - brick_origin, brick_extent,
+                                         voxel_size),
+                            row_size);
+                    }
+                }
+            }
+        }
+    }
+}
+
+Vol::Data::RangeGrid Vol::Data::CachedVolume::get_range_grid(
+    uint32_t level) const
+{
+    RangeGrid grid;
+    grid.dimensions = get_brick_grid_dimensions(levels[level].dimensions);
+    size_t first_brick = levels[level].first_brick;
+    size_t brick_count = get_brick_count(levels[level].dimensions);
+    grid.ranges.reserve(brick_count);
+    for (size_t i = first_brick; i < first_brick + brick_count; i++) {
+        grid.ranges.emplace_back(bricks[i].min, bricks[i].max);
+    }
+    return grid;
+}
+
+Vol::Data::RangeGrid Vol::Data::CachedVolume::get_macrocell_grid() const
+{
+    RangeGrid grid;
+    grid.dimensions = get_macrocell_grid_dimensions(levels[0].dimensions);
+    grid.ranges.reserve(macrocell_ranges.size() / 2);
+    for (size_t i = 0; i < macrocell_ranges.size(); i += 2) {
+        grid.ranges.emplace_back(macrocell_ranges[i], macrocell_ranges[i + 1]);
+    }
+    return grid;
+}
+
+Vol::Data::Histogram Vol::Data::CachedVolume::get_histogram() const
+{
+    return Histogram(min, max, histogram_bins);
+}
+
+const std::byte *Vol::Data::CachedVolume::read_brick(
+    size_t index,
+    size_t size,
+    std::vector<std::byte> &buffer) const
+{
+    // Bricks stored as is are read straight from the mapping
+    const CacheBrick &brick = bricks[index];
+    std::span<const std::byte> stored(
+        mapping->get_data() + brick.offset, brick.size);
+    if (brick.size == size) {
+        return stored.data();
+    }
+    buffer.resize(size);
+    decompress_brick(stored, buffer, get_voxel_size(type));
+    return buffer.data();
+}
+
+std::optional<std::filesystem::path> Vol::Data::get_cache_path(
+    const std::vector<std::filesystem::path> &sources)
+{
+    // FNV-1a over the layout version and every source's identity
+    uint64_t key = 14695981039346656037ull;
+    key = hash_bytes(key, &cache_version, sizeof(cache_version));
+    for (const std::filesystem::path &source : sources) {
+        std::error_code error;
+        std::filesystem::path absolute =
+            std::filesystem::absolute(source, error).lexically_normal();
+        if (error) {
+            return std::nullopt;
+        }
+        uintmax_t size = std::filesystem::file_size(source, error);
+        if (error) {
+            return std::nullopt;
+        }
+        auto modified = std::filesystem::last_write_time(source, error)
+                            .time_since_epoch()
+                            .count();
+        if (error) {
+            return std::nullopt;
+        }
+
+        std::string name = absolute.generic_string();
+        key = hash_bytes(key, name.data(), name.size());
+        key = hash_bytes(key, &size, sizeof(size));
+        key = hash_bytes(key, &modified, sizeof(modified));
+    }
+
+    return get_cache_directory() / std::format("{:016x}.volcache", key);
+}
+
+std::optional<Vol::Data::Dataset> Vol::Data::load_cached_volume(
+    const std::filesystem::path &path)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        return std::nullopt;
+    }
+
+    std::shared_ptr<CachedVolume> cache;
+    try {
+        cache = std::make_shared<CachedVolume>(path);
+    } catch (std::exception &) {
+        std::filesystem::remove(path, error);
+        return std::nullopt;
+    }
+
+    // Entries are evicted least recently used first, mark this one used
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now(), error);
+
+    // Every level decodes from the same entry
+    Dataset dataset{
+        .dimensions = cache->get_dimensions(0),
+        .type = cache->get_type(),
+        .min = cache->get_min(),
+        .max = cache->get_max(),
+        .range_grid = std::make_shared<RangeGrid>(cache->get_range_grid(0)),
+        .macrocells = std::make_shared<RangeGrid>(cache->get_macrocell_grid()),
+        .histogram = std::make_shared<Histogram>(cache->get_histogram()),
+        .cache = cache,
+        .cache_level = 0,
+    };
+    for (uint32_t level = 1; level < cache->get_level_count(); level++) {
+        dataset.levels.push_back(Dataset{
+            .dimensions = cache->get_dimensions(level),
+            .type = cache->get_type(),
+            .min = cache->get_min(),
+            .max = cache->get_max(),
+            .histogram = dataset.histogram,
+            .cache = cache,
+            .cache_level = level,
+        });
+    }
+
+    return dataset;
+}
+
+void Vol::Data::store_cached_volume(
+    const Dataset &dataset,
+    const std::filesystem::path &path)
+{
+    size_t voxel_size = get_voxel_size(dataset.type);
+
+    // Levels are stored from the finest to the coarsest, each with the value
+    // ranges of its bricks
+    std::vector<const Dataset *> levels = {&dataset};
+    for (const Dataset &level : dataset.levels) {
+        levels.push_back(&level);
+    }
+    std::vector<RangeGrid> range_grids;
+    std::vector<size_t> first_bricks;
+    size_t brick_count = 0;
+    for (const Dataset *level : levels) {
+        range_grids.push_back(
+            level->range_grid ? *level->range_grid
+                              : compute_range_grid(*level));
+        first_bricks.push_back(brick_count);
+        brick_count += range_grids.back().ranges.size();
+    }
+
+    Histogram histogram =
+        dataset.histogram ? *dataset.histogram : compute_histogram(dataset);
+    RangeGrid macrocell_grid = dataset.macrocells
+                                   ? *dataset.macrocells
+                                   : compute_macrocell_grid(dataset);
+    std::vector<float> macrocell_ranges;
+    for (const std::pair<float, float> &range : macrocell_grid.ranges) {
+        macrocell_ranges.push_back(range.first);
+        macrocell_ranges.push_back(range.second);
+    }
+
+    // The magic is only filled in once every brick has been written, so an
+    // entry cut short is never mistaken for a complete one
+    CacheHeader header{
+        .version = cache_version,
+        .brick_size = brick_size,
+        .type = static_cast<uint32_t>(dataset.type),
+        .level_count = static_cast<uint32_t>(levels.size()),
+        .min = dataset.min,
+        .max = dataset.max,
+        .brick_count = brick_count,
+        .histogram_bins = static_cast<uint32_t>(histogram.get_bins().size()),
+        .reserved = 0,
+    };
+
+    std::vector<uint32_t> level_dimensions;
+    for (const Dataset *level : levels) {
+        level_dimensions.push_back(level->dimensions.x);
+        level_dimensions.push_back(level->dimensions.y);
+        level_dimensions.push_back(level->dimensions.z);
+    }
+
+    // Lay out the levels and index, bricks follow them in order
+    std::vector<CacheBrick> index(brick_count);
+    uint64_t index_offset = sizeof(header) +
+                            level_dimensions.size() * sizeof(uint32_t) +
+                            histogram.get_bins().size() * sizeof(uint64_t) +
+                            macrocell_ranges.size() * sizeof(float);
+    uint64_t offset = index_offset + brick_count * sizeof(CacheBrick);
+
+    // Write next to the entry and move it into place once complete, so a
+    // partially written entry is never read and concurrent writers of the
+    // same entry don't interleave
+    std::filesystem::create_directories(path.parent_path());
+    std::filesystem::path partial = path;
+    size_t writer = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    partial += std::format(".{:x}.partial", writer);
+    std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+    try {
+        if (!file) {
+            throw std::runtime_error("Failed to create cache");
+        }
+        write_bytes(file, &header, sizeof(header));
+        write_bytes(
+            file, level_dimensions.data(),
+            level_dimensions.size() * sizeof(uint32_t));
+        write_bytes(
+            file, histogram.get_bins().data(),
+            histogram.get_bins().size() * sizeof(uint64_t));
+        write_bytes(
+            file, macrocell_ranges.data(),
+            macrocell_ranges.size() * sizeof(float));
+
+        // Reserve the index, it is patched in once the bricks are written
+        write_bytes(file, index.data(), index.size() * sizeof(CacheBrick));
+
+        // Gather and compress the bricks a batch at a time across the pool,
+        // appending each batch before the next, so only one is held in memory
+        Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+        std::vector<std::vector<std::byte>> stored;
+        for (size_t first = 0; first < brick_count; first += cache_batch) {
+            size_t count = std::min(cache_batch, brick_count - first);
+            stored.assign(count, {});
+            thread_pool.parallel_for(count, 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    size_t brick = first + i;
+                    size_t level_index =
+                        std::upper_bound(
+                            first_bricks.begin(), first_bricks.end(), brick) -
+                        first_bricks.begin() - 1;
+                    const Dataset &level = *levels[level_index];
+                    size_t brick_index = brick - first_bricks[level_index];
+
+                    glm::u32vec3 origin =
+                        get_brick_origin(brick_index, level.dimensions);
+                    glm::u32vec3 extent =
+                        get_brick_extent(origin, level.dimensions);
+                    std::vector<std::byte> voxels(
+                        get_brick_size(extent, voxel_size));
+                    gather_brick(
+                        level.get_voxels().data(), voxels.data(),
+                        level.dimensions, voxel_size, origin, extent);
+
+                    std::vector<std::byte> compressed =
+                        compress_brick(voxels, voxel_size);
+                    stored[i] = compressed.empty() ? std::move(voxels)
+                                                   : std::move(compressed);
+
+                    const std::pair<float, float> &range =
+                        range_grids[level_index].ranges[brick_index];
+                    index[brick] = CacheBrick{
+                        .offset = 0,
+                        .size = static_cast<uint32_t>(stored[i].size()),
+                        .min = range.first,
+                        .max = range.second,
+                        .reserved = 0,
+                    };
+                }
+            });
+
+            for (size_t i = 0; i < count; i++) {
+                index[first + i].offset = offset;
+                offset += stored[i].size();
+                write_bytes(file, stored[i].data(), stored[i].size());
+            }
+            if (!file) {
+                throw std::runtime_error("Failed to write cache");
+            }
+        }
+
+        // Patch in the index and, last, the magic that marks it complete
+        file.seekp(static_cast<std::streamoff>(index_offset));
+        write_bytes(file, index.data(), index.size() * sizeof(CacheBrick));
+        std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+        file.seekp(0);
+        write_bytes(file, &header, sizeof(header));
+        if (!file.flush()) {
+            throw std::runtime_error("Failed to write cache");
+        }
+        file.close();
+        std::filesystem::rename(partial, path);
+    } catch (...) {
+        std::error_code error;
+        file.close();
+        std::filesystem::remove(partial, error);
+        throw;
+    }
+
+    evict_cache_entries(path);
+}
+
+std::filesystem::path get_cache_directory()
+{
+    std::filesystem::path base;
+#ifdef _WIN32
+    if (const char *local_app_data = std::getenv("LOCALAPPDATA")) {
+        base = local_app_data;
+    }
+#else
+    if (const char *cache_home = std::getenv("XDG_CACHE_HOME")) {
+        base = cache_home;
+    } else if (const char *home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".cache";
+    }
+#endif
+    if (base.empty()) {
+        base = std::filesystem::temp_directory_path();
+    }
+    return base / "volumetric-renderer";
+}
+
+void evict_cache_entries(const std::filesystem::path &keep)
+{
+    struct Entry {
+        std::filesystem::file_time_type used;
+        uintmax_t size;
+        std::filesystem::path path;
+    };
+
+    // Entries other writers or readers remove or hold open meanwhile are
+    // skipped, the next sweep catches whatever this one missed
+    std::error_code error;
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+    for (const std::filesystem::directory_entry &file :
+         std::filesystem::directory_iterator(keep.parent_path(), error)) {
+        if (file.path().extension() != ".volcache") {
+            continue;
+        }
+        uintmax_t size = file.file_size(error);
+        std::filesystem::file_time_type used = file.last_write_time(error);
+        if (error) {
+            continue;
+        }
+        total += size;
+        if (file.path() != keep) {
+            entries.push_back(Entry{used, size, file.path()});
+        }
+    }
+
+    std::sort(
+        entries.begin(), entries.end(),
+        [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &entry : entries) {
+        if (total <= cache_capacity) {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+}
+
+void write_bytes(std::ofstream &file, const void *data, size_t size)
+{
+    file.write(
+        static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void gather_brick(
+    const std::byte *voxels,
+    std::byte *brick,
+    glm::u32vec3 dimensions,
+    size_t voxel_size,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent)
+{
+    size_t row_size = static_cast<size_t>(dimensions.x) * voxel_size;
+    size_t slice_size = row_size * dimensions.y;
+    size_t brick_row_size = extent.x * voxel_size;
+    for (uint32_t z = 0; z < extent.z; z++) {
+        for (uint32_t y = 0; y < extent.y; y++) {
+            const std::byte *row = voxels + (origin.z + z) * slice_size +
+                                   (origin.y + y) * row_size +
+                                   origin.x * voxel_size;
+            std::memcpy(brick, row, brick_row_size);
+            brick += brick_row_size;
+        }
+    }
+}
+
+void scatter_brick(
+    const std::byte *brick,
+    std::byte *voxels,
+    glm::u32vec3 dimensions,
+    size_t voxel_size,
+    glm::u32vec3 origin,
+    glm::u32vec3 extent)
+{
+    size_t row_size = static_cast<size_t>(dimensions.x) * voxel_size;
+    size_t slice_size = row_size * dimensions.y;
+    size_t brick_row_size = extent.x * voxel_size;
+    for (uint32_t z = 0; z < extent.z; z++) {
+        for (uint32_t y = 0; y < extent.y; y++) {
+            std::byte *row = voxels + (origin.z + z) * slice_size +
+                             (origin.y + y) * row_size + origin.x * voxel_size;
+            std::memcpy(row, brick, brick_row_size);
+            brick += brick_row_size;
+        }
+    }
+}
+
+size_t get_brick_size(glm::u32vec3 extent, size_t voxel_size)
+{
+    return static_cast<size_t>(extent.x) * extent.y * extent.z * voxel_size;
+}
+
+size_t get_voxel_offset(
+    glm::u32vec3 position,
+    glm::u32vec3 dimensions,
+    size_t voxel_size)
+{
+    return ((static_cast<size_t>(position.z) * dimensions.y + position.y) *
+                dimensions.x +
+            position.x) *
+           voxel_size;
+}
+
+size_t get_brick_count(glm::u32vec3 dimensions)
+{
+    glm::u32vec3 grid = Vol::Data::get_brick_grid_dimensions(dimensions);
+    return static_cast<size_t>(grid.x) * grid.y * grid.z;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "data/dataset.h"
+#include "data/histogram.h"
+#include "data/range_grid.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Vol::Data
+{
+class MappedFile;
+}  // namespace Vol::Data
+
+namespace Vol::Data
+{
+// Imported volumes are cached on disk so later imports of the same files skip
+// parsing. An entry is a header, the dimensions of every level of detail, the
+// histogram and macrocell ranges of the volume, an index of every brick with
+// its value range and offset, then the bricks themselves, each compressed on
+// its own so they can be decompressed in parallel. Entries are keyed on the
+// path, size and modification time of their source files.
+
+struct CacheBrick {
+    uint64_t offset;
+
+    // Stored as is if compression did not make the brick any smaller
+    uint32_t size;
+    float min, max;
+    uint32_t reserved;
+};
+
+class CachedVolume {
+  public:
+    // Maps a cache entry, throwing if it is missing or malformed
+    explicit CachedVolume(const std::filesystem::path &path);
+    ~CachedVolume();
+
+    CachedVolume(const CachedVolume &) = delete;
+    CachedVolume &operator=(const CachedVolume &) = delete;
+
+    // Decompresses the bricks of a level across the thread pool, each
+    // straight into its place within dst, which holds the whole level
+    void decode(
+        uint32_t level,
+        std::byte *dst,
+        std::atomic<float> *progress = nullptr) const;
+
+    // Decompresses just the bricks of a level a box overlaps, writing the box,
+    // which has to lie within the level, to dst x fastest
+    void read_region(
+        uint32_t level,
+        glm::u32vec3 origin,
+        glm::u32vec3 extent,
+        std::byte *dst) const;
+
+    RangeGrid get_range_grid(uint32_t level) const;
+    RangeGrid get_macrocell_grid() const;
+    Histogram get_histogram() const;
+
+    inline uint32_t get_level_count() const
+    {
+        return static_cast<uint32_t>(levels.size());
+    }
+    inline glm::u32vec3 get_dimensions(uint32_t level) const
+    {
+        return levels[level].dimensions;
+    }
+    inline VoxelType get_type() const { return type; }
+    inline float get_min() const { return min; }
+    inline float get_max() const { return max; }
+
+  private:
+    // Voxels of a brick, decompressed into buffer unless stored as is
+    const std::byte *read_brick(
+        size_t index,
+        size_t size,
+        std::vector<std::byte> &buffer) const;
+
+  private:
+    struct Level {
+        glm::u32vec3 dimensions;
+        size_t first_brick;
+    };
+
+  private:
+    std::unique_ptr<MappedFile> mapping;
+    std::vector<Level> levels;
+    VoxelType type;
+    float min, max;
+    std::vector<uint64_t> histogram_bins;
+    std::vector<float> macrocell_ranges;
+    std::vector<CacheBrick> bricks;
+};
+
+// Location of the cache entry for a set of source files, if they all exist
+std::optional<std::filesystem::path> get_cache_path(
+    const std::vector<std::filesystem::path> &sources);
+
+// Opens a cache entry as a dataset, removing it if it can't be read and
+// marking it recently used if it can
+std::optional<Dataset> load_cached_volume(const std::filesystem::path &path);
+
+// Writes a dataset and its levels, all with resident voxels, as a cache entry,
+// replacing any existing entry only once it has been written in full, then
+// evicts the least recently used entries beyond the capacity of the cache
+void store_cached_volume(
+    const Dataset &dataset,
+    const std::filesystem::path &path);
+}  // namespace Vol::Data
\ No newline at end of file
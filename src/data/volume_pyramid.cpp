@@ -0,0 +1,178 @@
+#include "volume_pyramid.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+// Half floats are stored as their bits
+struct Half {
+    uint16_t bits;
+};
+
+Vol::Data::Dataset downsample(const Vol::Data::Dataset &dataset);
+
+template <typename T>
+void downsample_(
+    const std::byte *src,
+    glm::u32vec3 src_dimensions,
+    std::byte *dst,
+    glm::u32vec3 dst_dimensions,
+    size_t z_begin,
+    size_t z_end);
+
+template <typename T>
+float load_voxel(const std::byte *voxel);
+
+template <typename T>
+void store_voxel(std::byte *voxel, float value);
+
+glm::u32vec3 Vol::Data::get_level_dimensions(glm::u32vec3 dimensions)
+{
+    return glm::max(dimensions / glm::u32vec3(2), glm::u32vec3(1));
+}
+
+std::vector<Vol::Data::Dataset> Vol::Data::build_pyramid(
+    const Dataset &dataset)
+{
+    std::vector<Dataset> levels;
+
+    const Dataset *level = &dataset;
+    while (level->dimensions != glm::u32vec3(1)) {
+        levels.push_back(downsample(*level));
+        level = &levels.back();
+    }
+
+    return levels;
+}
+
+Vol::Data::Dataset downsample(const Vol::Data::Dataset &dataset)
+{
+    using Vol::Data::VoxelType;
+
+    glm::u32vec3 dimensions =
+        Vol::Data::get_level_dimensions(dataset.dimensions);
+    Vol::Data::Dataset level{
+        .dimensions = dimensions,
+        .type = dataset.type,
+        .min = dataset.min,
+        .max = dataset.max,
+    };
+    level.data.resize(level.get_size());
+
+    // Slices of the level are independent, filter them across the pool
+    const std::byte *src = dataset.get_voxels().data();
+    std::byte *dst = level.data.data();
+    Vol::Core::ThreadPool &thread_pool =
+        Vol::Application::main().get_thread_pool();
+    thread_pool.parallel_for(dimensions.z, 1, [&](size_t begin, size_t end) {
+        switch (dataset.type) {
+            case VoxelType::UInt8:
+                downsample_<uint8_t>(
+                    src, dataset.dimensions, dst, dimensions, begin, end);
+                break;
+            case VoxelType::Int8:
+                downsample_<int8_t>(
+                    src, dataset.dimensions, dst, dimensions, begin, end);
+                break;
+            case VoxelType::UInt16:
+                downsample_<uint16_t>(
+                    src, dataset.dimensions, dst, dimensions, begin, end);
+                break;
+            case VoxelType::Int16:
+                downsample_<int16_t>(
+                    src, dataset.dimensions, dst, dimensions, begin, end);
+                break;
+            case VoxelType::Float16:
+                downsample_<Half>(
+                    src, dataset.dimensions, dst, dimensions, begin, end);
+                break;
+            case VoxelType::Float32:
+                downsample_<float>(
+                    src, dataset.dimensions, dst, dimensions, begin, end);
+                break;
+        }
+    });
+
+    return level;
+}
+
+template <typename T>
+void downsample_(
+    const std::byte *src,
+    glm::u32vec3 src_dimensions,
+    std::byte *dst,
+    glm::u32vec3 dst_dimensions,
+    size_t z_begin,
+    size_t z_end)
+{
+    size_t src_row = static_cast<size_t>(src_dimensions.x);
+    size_t src_slice = src_row * src_dimensions.y;
+    size_t dst_row = static_cast<size_t>(dst_dimensions.x);
+    size_t dst_slice = dst_row * dst_dimensions.y;
+
+    // Each voxel averages the two voxels it covers along every axis, or three
+    // at the end of an odd axis so no voxel is left out
+    auto cover = [](uint32_t i, uint32_t src_size, uint32_t dst_size) {
+        return std::pair<uint32_t, uint32_t>(
+            static_cast<uint64_t>(i) * src_size / dst_size,
+            static_cast<uint64_t>(i + 1) * src_size / dst_size);
+    };
+
+    for (size_t z = z_begin; z < z_end; z++) {
+        auto [z0, z1] =
+            cover(static_cast<uint32_t>(z), src_dimensions.z, dst_dimensions.z);
+        for (uint32_t y = 0; y < dst_dimensions.y; y++) {
+            auto [y0, y1] = cover(y, src_dimensions.y, dst_dimensions.y);
+            for (uint32_t x = 0; x < dst_dimensions.x; x++) {
+                auto [x0, x1] = cover(x, src_dimensions.x, dst_dimensions.x);
+
+                float sum = 0.0f;
+                for (uint32_t sz = z0; sz < z1; sz++) {
+                    for (uint32_t sy = y0; sy < y1; sy++) {
+                        const std::byte *row =
+                            src + (sz * src_slice + sy * src_row) * sizeof(T);
+                        for (uint32_t sx = x0; sx < x1; sx++) {
+                            sum += load_voxel<T>(row + sx * sizeof(T));
+                        }
+                    }
+                }
+                float count = static_cast<float>(
+                    (z1 - z0) * (y1 - y0) * (x1 - x0));
+
+                std::byte *voxel =
+                    dst + (z * dst_slice + y * dst_row + x) * sizeof(T);
+                store_voxel<T>(voxel, sum / count);
+            }
+        }
+    }
+}
+
+template <typename T>
+float load_voxel(const std::byte *voxel)
+{
+    T value;
+    std::memcpy(&value, voxel, sizeof(T));
+    if constexpr (std::is_same_v<T, Half>) {
+        return Vol::Data::half_to_float(value.bits);
+    } else {
+        return static_cast<float>(value);
+    }
+}
+
+template <typename T>
+void store_voxel(std::byte *voxel, float value)
+{
+    T result;
+    if constexpr (std::is_same_v<T, Half>) {
+        result.bits = Vol::Data::float_to_half(value);
+    } else if constexpr (std::is_integral_v<T>) {
+        result = static_cast<T>(std::lround(value));
+    } else {
+        result = value;
+    }
+    std::memcpy(voxel, &result, sizeof(T));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "data/dataset.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace Vol::Data
+{
+// Dimensions of the next coarser level, halved and rounded down the same way
+// as the mip chain of an image
+glm::u32vec3 get_level_dimensions(glm::u32vec3 dimensions);
+
+// Builds every coarser level of a dataset with resident voxels down to a
+// single voxel, each box filtered from the one before across the thread pool.
+// Levels keep the voxel type and density range of the dataset.
+std::vector<Dataset> build_pyramid(const Dataset &dataset);
+}  // namespace Vol::Data
\ No newline at end of file
@@ -0,0 +1,549 @@
+#include "voxel_kernels.h"
+
+#include "core/simd.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+const std::pair<float, float> empty_range = {
+    std::numeric_limits<float>::max(),
+    std::numeric_limits<float>::lowest(),
+};
+
+template <typename T>
+std::pair<float, float> dispatch_find_range(const std::byte *src, size_t count);
+
+template <typename T>
+std::pair<float, float> dispatch_convert(
+    const std::byte *src,
+    float *dst,
+    size_t count);
+
+template <typename T>
+std::pair<float, float> find_range_scalar(const std::byte *src, size_t count);
+
+template <typename T>
+std::pair<float, float> convert_scalar(
+    const std::byte *src,
+    float *dst,
+    size_t count);
+
+template <typename T, size_t N>
+std::pair<float, float> reduce_lanes(const T (&min)[N], const T (&max)[N]);
+
+#ifdef VOL_X86
+template <typename T>
+VOL_TARGET("sse4.1")
+std::pair<float, float> find_range_sse41(const std::byte *src, size_t count);
+
+template <typename T>
+VOL_TARGET("avx2")
+std::pair<float, float> find_range_avx2(const std::byte *src, size_t count);
+
+template <typename T>
+VOL_TARGET("sse4.1")
+std::pair<float, float> convert_sse41(
+    const std::byte *src,
+    float *dst,
+    size_t count);
+
+template <typename T>
+VOL_TARGET("avx2")
+std::pair<float, float> convert_avx2(
+    const std::byte *src,
+    float *dst,
+    size_t count);
+#endif  // VOL_X86
+
+// Integer types the min/max instructions cover, and types that can be loaded
+// as packed floats
+template <typename T>
+constexpr bool has_packed_range =
+    std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t> ||
+    std::is_same_v<T, uint16_t> || std::is_same_v<T, int16_t> ||
+    std::is_same_v<T, uint32_t> || std::is_same_v<T, int32_t> ||
+    std::is_same_v<T, float>;
+
+template <typename T>
+constexpr bool has_packed_convert =
+    has_packed_range<T> || std::is_same_v<T, double>;
+
+size_t Vol::Data::get_scalar_size(ScalarType type)
+{
+    switch (type) {
+        case ScalarType::UInt8: return sizeof(uint8_t);
+        case ScalarType::Int8: return sizeof(int8_t);
+        case ScalarType::UInt16: return sizeof(uint16_t);
+        case ScalarType::Int16: return sizeof(int16_t);
+        case ScalarType::UInt32: return sizeof(uint32_t);
+        case ScalarType::Int32: return sizeof(int32_t);
+        case ScalarType::UInt64: return sizeof(uint64_t);
+        case ScalarType::Int64: return sizeof(int64_t);
+        case ScalarType::Float32: return sizeof(float);
+        case ScalarType::Float64: return sizeof(double);
+    }
+    throw std::invalid_argument("Unknown scalar type");
+}
+
+std::pair<float, float> Vol::Data::find_range(
+    const std::byte *src,
+    size_t count,
+    ScalarType type)
+{
+    switch (type) {
+        case ScalarType::UInt8: return dispatch_find_range<uint8_t>(src, count);
+        case ScalarType::Int8: return dispatch_find_range<int8_t>(src, count);
+        case ScalarType::UInt16:
+            return dispatch_find_range<uint16_t>(src, count);
+        case ScalarType::Int16: return dispatch_find_range<int16_t>(src, count);
+        case ScalarType::UInt32:
+            return dispatch_find_range<uint32_t>(src, count);
+        case ScalarType::Int32: return dispatch_find_range<int32_t>(src, count);
+        case ScalarType::UInt64:
+            return dispatch_find_range<uint64_t>(src, count);
+        case ScalarType::Int64: return dispatch_find_range<int64_t>(src, count);
+        case ScalarType::Float32: return dispatch_find_range<float>(src, count);
+        case ScalarType::Float64:
+            return dispatch_find_range<double>(src, count);
+    }
+    throw std::invalid_argument("Unknown scalar type");
+}
+
+std::pair<float, float> Vol::Data::convert_to_float(
+    const std::byte *src,
+    float *dst,
+    size_t count,
+    ScalarType type)
+{
+    switch (type) {
+        case ScalarType::UInt8:
+            return dispatch_convert<uint8_t>(src, dst, count);
+        case ScalarType::Int8: return dispatch_convert<int8_t>(src, dst, count);
+        case ScalarType::UInt16:
+            return dispatch_convert<uint16_t>(src, dst, count);
+        case ScalarType::Int16:
+            return dispatch_convert<int16_t>(src, dst, count);
+        case ScalarType::UInt32:
+            return dispatch_convert<uint32_t>(src, dst, count);
+        case ScalarType::Int32:
+            return dispatch_convert<int32_t>(src, dst, count);
+        case ScalarType::UInt64:
+            return dispatch_convert<uint64_t>(src, dst, count);
+        case ScalarType::Int64:
+            return dispatch_convert<int64_t>(src, dst, count);
+        case ScalarType::Float32:
+            return dispatch_convert<float>(src, dst, count);
+        case ScalarType::Float64:
+            return dispatch_convert<double>(src, dst, count);
+    }
+    throw std::invalid_argument("Unknown scalar type");
+}
+
+std::pair<float, float> Vol::Data::merge_ranges(
+    std::pair<float, float> a,
+    std::pair<float, float> b)
+{
+    return {std::min(a.first, b.first), std::max(a.second, b.second)};
+}
+
+template <typename T>
+std::pair<float, float> dispatch_find_range(const std::byte *src, size_t count)
+{
+#ifdef VOL_X86
+    if constexpr (has_packed_range<T>) {
+        switch (Vol::Core::get_simd_level()) {
+            case Vol::Core::SimdLevel::Avx2:
+                return find_range_avx2<T>(src, count);
+            case Vol::Core::SimdLevel::Sse41:
+                return find_range_sse41<T>(src, count);
+            case Vol::Core::SimdLevel::Scalar: break;
+        }
+    }
+#endif  // VOL_X86
+    return find_range_scalar<T>(src, count);
+}
+
+template <typename T>
+std::pair<float, float> dispatch_convert(
+    const std::byte *src,
+    float *dst,
+    size_t count)
+{
+#ifdef VOL_X86
+    if constexpr (has_packed_convert<T>) {
+        switch (Vol::Core::get_simd_level()) {
+            case Vol::Core::SimdLevel::Avx2:
+                return convert_avx2<T>(src, dst, count);
+            case Vol::Core::SimdLevel::Sse41:
+                return convert_sse41<T>(src, dst, count);
+            case Vol::Core::SimdLevel::Scalar: break;
+        }
+    }
+#endif  // VOL_X86
+    return convert_scalar<T>(src, dst, count);
+}
+
+template <typename T>
+std::pair<float, float> find_range_scalar(const std::byte *src, size_t count)
+{
+    if (count == 0) {
+        return empty_range;
+    }
+
+    // Comparisons against NaN are false, so NaNs never replace a bound
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    for (size_t i = 0; i < count; i++) {
+        T value;
+        std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    return {static_cast<float>(min), static_cast<float>(max)};
+}
+
+template <typename T>
+std::pair<float, float> convert_scalar(
+    const std::byte *src,
+    float *dst,
+    size_t count)
+{
+    std::pair<float, float> range = empty_range;
+    for (size_t i = 0; i < count; i++) {
+        T value;
+        std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+        float converted = static_cast<float>(value);
+        dst[i] = converted;
+        range.first = std::min(range.first, converted);
+        range.second = std::max(range.second, converted);
+    }
+    return range;
+}
+
+template <typename T, size_t N>
+std::pair<float, float> reduce_lanes(const T (&min)[N], const T (&max)[N])
+{
+    return {
+        static_cast<float>(*std::min_element(min, min + N)),
+        static_cast<float>(*std::max_element(max, max + N)),
+    };
+}
+
+#ifdef VOL_X86
+// Packed integer min/max, signed 8-bit and unsigned 16/32-bit need SSE4.1
+template <typename T>
+VOL_TARGET("sse4.1")
+__m128i min_sse41(__m128i a, __m128i b)
+{
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        return _mm_min_epu8(a, b);
+    } else if constexpr (std::is_same_v<T, int8_t>) {
+        return _mm_min_epi8(a, b);
+    } else if constexpr (std::is_same_v<T, uint16_t>) {
+        return _mm_min_epu16(a, b);
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+        return _mm_min_epi16(a, b);
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        return _mm_min_epu32(a, b);
+    } else {
+        return _mm_min_epi32(a, b);
+    }
+}
+
+template <typename T>
+VOL_TARGET("sse4.1")
+__m128i max_sse41(__m128i a, __m128i b)
+{
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        return _mm_max_epu8(a, b);
+    } else if constexpr (std::is_same_v<T, int8_t>) {
+        return _mm_max_epi8(a, b);
+    } else if constexpr (std::is_same_v<T, uint16_t>) {
+        return _mm_max_epu16(a, b);
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+        return _mm_max_epi16(a, b);
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        return _mm_max_epu32(a, b);
+    } else {
+        return _mm_max_epi32(a, b);
+    }
+}
+
+template <typename T>
+VOL_TARGET("avx2")
+__m256i min_avx2(__m256i a, __m256i b)
+{
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        return _mm256_min_epu8(a, b);
+    } else if constexpr (std::is_same_v<T, int8_t>) {
+        return _mm256_min_epi8(a, b);
+    } else if constexpr (std::is_same_v<T, uint16_t>) {
+        return _mm256_min_epu16(a, b);
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+        return _mm256_min_epi16(a, b);
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        return _mm256_min_epu32(a, b);
+    } else {
+        return _mm256_min_epi32(a, b);
+    }
+}
+
+template <typename T>
+VOL_TARGET("avx2")
+__m256i max_avx2(__m256i a, __m256i b)
+{
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        return _mm256_max_epu8(a, b);
+    } else if constexpr (std::is_same_v<T, int8_t>) {
+        return _mm256_max_epi8(a, b);
+    } else if constexpr (std::is_same_v<T, uint16_t>) {
+        return _mm256_max_epu16(a, b);
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+        return _mm256_max_epi16(a, b);
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        return _mm256_max_epu32(a, b);
+    } else {
+        return _mm256_max_epi32(a, b);
+    }
+}
+
+// Loads four voxels as floats
+template <typename T>
+VOL_TARGET("sse4.1")
+__m128 load_sse41(const std::byte *src)
+{
+    if constexpr (std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>) {
+        int32_t bytes;
+        std::memcpy(&bytes, src, sizeof(bytes));
+        __m128i packed = _mm_cvtsi32_si128(bytes);
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(packed));
+        } else {
+            return _mm_cvtepi32_ps(_mm_cvtepi8_epi32(packed));
+        }
+    } else if constexpr (
+        std::is_same_v<T, uint16_t> || std::is_same_v<T, int16_t>) {
+        __m128i packed =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+        if constexpr (std::is_same_v<T, uint16_t>) {
+            return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(packed));
+        } else {
+            return _mm_cvtepi32_ps(_mm_cvtepi16_epi32(packed));
+        }
+    } else if constexpr (std::is_same_v<T, int32_t>) {
+        return _mm_cvtepi32_ps(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        // Only signed conversion exists, convert the halves separately. The
+        // high half scales exactly, so the sum is rounded once like a cast.
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128 high = _mm_cvtepi32_ps(_mm_srli_epi32(value, 16));
+        __m128 low = _mm_cvtepi32_ps(
+            _mm_and_si128(value, _mm_set1_epi32(0xFFFF)));
+        return _mm_add_ps(_mm_mul_ps(high, _mm_set1_ps(65536.0f)), low);
+    } else if constexpr (std::is_same_v<T, float>) {
+        return _mm_loadu_ps(reinterpret_cast<const float *>(src));
+    } else {
+        const double *values = reinterpret_cast<const double *>(src);
+        return _mm_movelh_ps(
+            _mm_cvtpd_ps(_mm_loadu_pd(values)),
+            _mm_cvtpd_ps(_mm_loadu_pd(values + 2)));
+    }
+}
+
+// Loads eight voxels as floats
+template <typename T>
+VOL_TARGET("avx2")
+__m256 load_avx2(const std::byte *src)
+{
+    if constexpr (std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>) {
+        __m128i packed =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(packed));
+        } else {
+            return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(packed));
+        }
+    } else if constexpr (
+        std::is_same_v<T, uint16_t> || std::is_same_v<T, int16_t>) {
+        __m128i packed =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        if constexpr (std::is_same_v<T, uint16_t>) {
+            return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(packed));
+        } else {
+            return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed));
+        }
+    } else if constexpr (std::is_same_v<T, int32_t>) {
+        return _mm256_cvtepi32_ps(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)));
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        // Only signed conversion exists, see load_sse41
+        __m256i value =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        __m256 high = _mm256_cvtepi32_ps(_mm256_srli_epi32(value, 16));
+        __m256 low = _mm256_cvtepi32_ps(
+            _mm256_and_si256(value, _mm256_set1_epi32(0xFFFF)));
+        return _mm256_add_ps(
+            _mm256_mul_ps(high, _mm256_set1_ps(65536.0f)), low);
+    } else if constexpr (std::is_same_v<T, float>) {
+        return _mm256_loadu_ps(reinterpret_cast<const float *>(src));
+    } else {
+        const double *values = reinterpret_cast<const double *>(src);
+        __m128 low = _mm256_cvtpd_ps(_mm256_loadu_pd(values));
+        __m128 high = _mm256_cvtpd_ps(_mm256_loadu_pd(values + 4));
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+    }
+}
+
+template <typename T>
+VOL_TARGET("sse4.1")
+std::pair<float, float> find_range_sse41(const std::byte *src, size_t count)
+{
+    constexpr size_t lanes = sizeof(__m128i) / sizeof(T);
+    size_t i = 0;
+    std::pair<float, float> range = empty_range;
+
+    if constexpr (std::is_same_v<T, float>) {
+        // With NaN in the first operand the second one is returned, which
+        // keeps NaNs out of the bounds
+        __m128 min = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 max = _mm_set1_ps(std::numeric_limits<float>::lowest());
+        for (; i + lanes <= count; i += lanes) {
+            __m128 value = load_sse41<T>(src + i * sizeof(T));
+            min = _mm_min_ps(value, min);
+            max = _mm_max_ps(value, max);
+        }
+
+        float min_lanes[lanes], max_lanes[lanes];
+        _mm_storeu_ps(min_lanes, min);
+        _mm_storeu_ps(max_lanes, max);
+        range = reduce_lanes(min_lanes, max_lanes);
+    } else if (count >= lanes) {
+        __m128i min = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i max = min;
+        for (i = lanes; i + lanes <= count; i += lanes) {
+            __m128i value = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(src + i * sizeof(T)));
+            min = min_sse41<T>(min, value);
+            max = max_sse41<T>(max, value);
+        }
+
+        T min_lanes[lanes], max_lanes[lanes];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(min_lanes), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(max_lanes), max);
+        range = reduce_lanes(min_lanes, max_lanes);
+    }
+
+    // Remaining voxels
+    return Vol::Data::merge_ranges(
+        range, find_range_scalar<T>(src + i * sizeof(T), count - i));
+}
+
+template <typename T>
+VOL_TARGET("avx2")
+std::pair<float, float> find_range_avx2(const std::byte *src, size_t count)
+{
+    constexpr size_t lanes = sizeof(__m256i) / sizeof(T);
+    size_t i = 0;
+    std::pair<float, float> range = empty_range;
+
+    if constexpr (std::is_same_v<T, float>) {
+        // NaNs are kept out of the bounds, see find_range_sse41
+        __m256 min = _mm256_set1_ps(std::numeric_limits<float>::max());
+        __m256 max = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+        for (; i + lanes <= count; i += lanes) {
+            __m256 value = load_avx2<T>(src + i * sizeof(T));
+            min = _mm256_min_ps(value, min);
+            max = _mm256_max_ps(value, max);
+        }
+
+        float min_lanes[lanes], max_lanes[lanes];
+        _mm256_storeu_ps(min_lanes, min);
+        _mm256_storeu_ps(max_lanes, max);
+        range = reduce_lanes(min_lanes, max_lanes);
+    } else if (count >= lanes) {
+        __m256i min =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        __m256i max = min;
+        for (i = lanes; i + lanes <= count; i += lanes) {
+            __m256i value = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(src + i * sizeof(T)));
+            min = min_avx2<T>(min, value);
+            max = max_avx2<T>(max, value);
+        }
+
+        T min_lanes[lanes], max_lanes[lanes];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(min_lanes), min);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(max_lanes), max);
+        range = reduce_lanes(min_lanes, max_lanes);
+    }
+
+    // Remaining voxels
+    return Vol::Data::merge_ranges(
+        range, find_range_scalar<T>(src + i * sizeof(T), count - i));
+}
+
+template <typename T>
+VOL_TARGET("sse4.1")
+std::pair<float, float> convert_sse41(
+    const std::byte *src,
+    float *dst,
+    size_t count)
+{
+    constexpr size_t lanes = 4;
+
+    // Bounds are found on the converted values, conversion keeps the order
+    __m128 min = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128 max = _mm_set1_ps(std::numeric_limits<float>::lowest());
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        __m128 value = load_sse41<T>(src + i * sizeof(T));
+        _mm_storeu_ps(dst + i, value);
+        min = _mm_min_ps(value, min);
+        max = _mm_max_ps(value, max);
+    }
+
+    float min_lanes[lanes], max_lanes[lanes];
+    _mm_storeu_ps(min_lanes, min);
+    _mm_storeu_ps(max_lanes, max);
+
+    // Remaining voxels
+    return Vol::Data::merge_ranges(
+        reduce_lanes(min_lanes, max_lanes),
+        convert_scalar<T>(src + i * sizeof(T), dst + i, count - i));
+}
+
+template <typename T>
+VOL_TARGET("avx2")
+std::pair<float, float> convert_avx2(
+    const std::byte *src,
+    float *dst,
+    size_t count)
+{
+    constexpr size_t lanes = 8;
+
+    // Bounds are found on the converted values, conversion keeps the order
+    __m256 min = _mm256_set1_ps(std::numeric_limits<float>::max());
+    __m256 max = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        __m256 value = load_avx2<T>(src + i * sizeof(T));
+        _mm256_storeu_ps(dst + i, value);
+        min = _mm256_min_ps(value, min);
+        max = _mm256_max_ps(value, max);
+    }
+
+    float min_lanes[lanes], max_lanes[lanes];
+    _mm256_storeu_ps(min_lanes, min);
+    _mm256_storeu_ps(max_lanes, max);
+
+    // Remaining voxels
+    return Vol::Data::merge_ranges(
+        reduce_lanes(min_lanes, max_lanes),
+        convert_scalar<T>(src + i * sizeof(T), dst + i, count - i));
+}
+#endif  // VOL_X86
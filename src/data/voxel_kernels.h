@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+namespace Vol::Data
+{
+// Scalar types voxels may be stored as in a file, a superset of the types
+// a volume can be sampled as
+enum class ScalarType {
+    UInt8,
+    Int8,
+    UInt16,
+    Int16,
+    UInt32,
+    Int32,
+    UInt64,
+    Int64,
+    Float32,
+    Float64,
+};
+
+size_t get_scalar_size(ScalarType type);
+
+// The kernels below read voxels without alignment requirements and run on the
+// widest of AVX2, SSE4.1 or plain scalar code the CPU supports. NaNs are left
+// out of ranges, and an empty range is returned as {max, lowest}.
+
+// Finds the range of count voxels
+std::pair<float, float> find_range(
+    const std::byte *src,
+    size_t count,
+    ScalarType type);
+
+// Converts count voxels to float and finds their range in the same pass
+std::pair<float, float> convert_to_float(
+    const std::byte *src,
+    float *dst,
+    size_t count,
+    ScalarType type);
+
+// Merges ranges found over parts of a volume
+std::pair<float, float> merge_ranges(
+    std::pair<float, float> a,
+    std::pair<float, float> b);
+}  // namespace Vol::Data
\ No newline at end of file
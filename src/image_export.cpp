@@ -0,0 +1,100 @@
+#include "image_export.h"
+
+#include "application.h"
+#include "data/image_writer.h"
+#include "data/importer.h"
+#include "rendering/offscreen_pass.h"
+#include "rendering/vulkan_context.h"
+#include "ui/components/gradient.h"
+
+#include <exception>
+#include <iostream>
+
+// Texels the transfer function is discretized to, as the editor does
+const size_t transfer_function_texels = 256;
+
+// Most frames rendered for pages to stream in, the image is written as it is
+// after them
+const uint32_t max_export_frames = 256;
+
+Vol::ImageExport::ImageExport(const ExportOptions &options) : options(options)
+{
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+
+    // Without a transfer function the editor's default is rendered
+    try {
+        UI::Components::Gradient gradient =
+            options.transfer_function
+                ? UI::Components::Gradient::load(*options.transfer_function)
+                : UI::Components::Gradient();
+        offscreen_pass->transfer_function_changed(
+            gradient.discretize(transfer_function_texels));
+    } catch (std::exception &e) {
+        fail(e.what());
+        return;
+    }
+    offscreen_pass->adaptive_quality_changed(false);
+
+    Data::Importer &importer = Application::main().get_importer();
+    importer.import(options.dataset);
+    if (!importer.get_error().empty()) {
+        fail(importer.get_error());
+    }
+}
+
+bool Vol::ImageExport::end_frame()
+{
+    if (done) {
+        return false;
+    }
+
+    // The volume is rendered once the renderer has swapped it in
+    if (importing) {
+        Data::Importer &importer = Application::main().get_importer();
+        if (importer.is_importing()) {
+            return true;
+        }
+        if (!importer.get_error().empty()) {
+            fail("Failed to import dataset: " + importer.get_error());
+            return false;
+        }
+        importing = false;
+        return true;
+    }
+
+    // Pages a frame samples are only requested once its slot comes around
+    // again, so the image is final after as many frames without streaming
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+    settled_frames = offscreen_pass->is_streaming() ? 0 : settled_frames + 1;
+    frame++;
+    if (settled_frames <= Rendering::MAX_FRAMES_IN_FLIGHT &&
+        frame < max_export_frames) {
+        return true;
+    }
+
+    write();
+    done = true;
+    return false;
+}
+
+void Vol::ImageExport::write()
+{
+    Rendering::OffscreenPass *offscreen_pass =
+        Application::main().get_vulkan_context().get_offscreen_pass();
+    try {
+        glm::u32vec2 size = offscreen_pass->get_size();
+        Data::write_image(
+            options.output, size.x, size.y, offscreen_pass->read_image());
+    } catch (std::exception &e) {
+        fail(e.what());
+    }
+}
+
+void Vol::ImageExport::fail(const std::string &message)
+{
+    std::cerr << "Export failed: " << message << std::endl;
+    failed = true;
+    done = true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "options.h"
+
+#include <cstdint>
+#include <string>
+
+namespace Vol
+{
+// Renders a dataset once it has been imported, at full quality, and writes
+// the image to a file. Paged volumes are rendered until no more pages are
+// streamed in for them.
+class ImageExport {
+  public:
+    explicit ImageExport(const ExportOptions &options);
+
+    // Returns whether the export wants another frame
+    bool end_frame();
+
+    inline bool has_failed() const { return failed; }
+
+  private:
+    void write();
+    void fail(const std::string &message);
+
+  private:
+    ExportOptions options;
+    bool importing = true;
+    bool done = false;
+    bool failed = false;
+    uint32_t frame = 0;
+    uint32_t settled_frames = 0;
+};
+}  // namespace Vol
\ No newline at end of file
@@ -1,9 +1,21 @@
 #include "application.h"
+#include "options.h"
 
 #include <SDL3/SDL_main.h>
 
+#include <exception>
+#include <iostream>
+
 int SDL_main(int argc, char *argv[])
 {
-    Vol::Application application{};
+    Vol::Options options;
+    try {
+        options = Vol::parse_options(argc, argv);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << "\n\n" << Vol::usage;
+        return 1;
+    }
+
+    Vol::Application application(options);
     return application.run();
 }
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "options.h"
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+const char *Vol::usage =
+    "Usage: volumetric-renderer [options]\n"
+    "       volumetric-renderer --benchmark <dataset>... [options]\n"
+    "       volumetric-renderer --output <image> <dataset>... [options]\n"
+    "       volumetric-renderer --batch <manifest> [options]\n"
+    "\n"
+    "Options:\n"
+    "  --size <width>x<height>      Size of the window, or of the image\n"
+    "  --headless                   Render without a window, which needs\n"
+    "                               --benchmark, --output or --batch\n"
+    "  --cpu                        Render the benchmark or image on the CPU,\n"
+    "                               which needs no device\n"
+    "  --record-path <file>         Record the camera path to the file\n"
+    "  --transfer-function <file>   Lines of location, red, green, blue and\n"
+    "                               alpha, all between 0 and 1\n"
+    "  --output <image>             Render the datasets once and write the\n"
+    "                               image as PNG or PPM\n"
+    "  --batch <manifest>           Render the image sequences of every\n"
+    "                               dataset, transfer function and camera\n"
+    "                               path in the manifest\n"
+    "\n"
+    "Benchmark options:\n"
+    "  --benchmark                  Render the datasets unattended and report\n"
+    "                               the time every frame took, or on the CPU\n"
+    "                               the rays traced per second on ever more\n"
+    "                               cores. CSV slices also report how fast\n"
+    "                               each core parsed them.\n"
+    "  --camera-path <path>         orbit, zoom, slicing or a recorded file\n"
+    "  --frames <count>             Frames measured, 300 by default\n"
+    "  --warmup <count>             Frames rendered first, 30 by default\n"
+    "  --report <file>              Write the time of every frame as CSV\n";
+
+uint32_t parse_count(
+    std::string_view name,
+    std::string_view value,
+    uint32_t minimum = 1);
+
+Vol::Options Vol::parse_options(int argc, char *argv[])
+{
+    Options options;
+    BenchmarkOptions benchmark;
+    bool benchmarking = false;
+    std::optional<std::filesystem::path> transfer_function;
+    std::optional<std::filesystem::path> output;
+    std::vector<std::filesystem::path> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+
+        // Flags
+        if (argument == "--benchmark") {
+            benchmarking = true;
+            continue;
+        }
+        if (argument == "--headless") {
+            options.headless = true;
+            continue;
+        }
+        if (argument == "--cpu") {
+            options.cpu = true;
+            continue;
+        }
+        if (!argument.starts_with("--")) {
+            positional.emplace_back(argument);
+            continue;
+        }
+
+        // Options taking a value
+        if (i + 1 >= argc) {
+            throw std::runtime_error(
+                "Missing value for " + std::string(argument));
+        }
+        std::string_view value = argv[++i];
+        if (argument == "--size") {
+            size_t separator = value.find('x');
+            if (separator == std::string_view::npos) {
+                throw std::runtime_error("Size must be <width>x<height>");
+            }
+            options.window_width =
+                parse_count(argument, value.substr(0, separator));
+            options.window_height =
+                parse_count(argument, value.substr(separator + 1));
+        } else if (argument == "--record-path") {
+            options.record_path = value;
+        } else if (argument == "--transfer-function") {
+            transfer_function = value;
+        } else if (argument == "--output") {
+            output = value;
+        } else if (argument == "--batch") {
+            options.batch = value;
+        } else if (argument == "--camera-path") {
+            benchmark.camera_path = value;
+        } else if (argument == "--frames") {
+            benchmark.frame_count = parse_count(argument, value);
+        } else if (argument == "--warmup") {
+            benchmark.warmup_frames = parse_count(argument, value, 0);
+        } else if (argument == "--report") {
+            benchmark.report = value;
+        } else {
+            throw std::runtime_error("Unknown option " + std::string(argument));
+        }
+    }
+
+    // Datasets are only given to the benchmark or export, one at a time,
+    // batches list theirs in the manifest
+    if (benchmarking + output.has_value() + options.batch.has_value() > 1) {
+        throw std::runtime_error(
+            "Only one of --benchmark, --output and --batch can be given");
+    }
+    if (benchmarking || output) {
+        if (positional.empty()) {
+            throw std::runtime_error("No dataset given");
+        }
+    } else if (!positional.empty()) {
+        throw std::runtime_error(
+            "Unexpected argument " + positional.front().string());
+    }
+    if (options.headless && !benchmarking && !output && !options.batch) {
+        throw std::runtime_error(
+            "Headless mode needs --benchmark, --output or --batch");
+    }
+
+    // The CPU renders without a window either
+    if (options.cpu && !benchmarking && !output) {
+        throw std::runtime_error("--cpu needs --benchmark or --output");
+    }
+    options.headless |= options.cpu;
+
+    if (benchmarking) {
+        benchmark.dataset = std::move(positional);
+        benchmark.transfer_function = transfer_function;
+        options.benchmark = std::move(benchmark);
+    } else if (output) {
+        options.image_export = ExportOptions{
+            .dataset = std::move(positional),
+            .transfer_function = transfer_function,
+            .output = *output,
+        };
+    }
+
+    return options;
+}
+
+uint32_t parse_count(
+    std::string_view name,
+    std::string_view value,
+    uint32_t minimum)
+{
+    uint32_t count = 0;
+    auto [end, error] =
+        std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc() || end != value.data() + value.size() ||
+        count < minimum) {
+        throw std::runtime_error(
+            "Expected a number of at least " + std::to_string(minimum) +
+            " for " + std::string(name));
+    }
+    return count;
+}
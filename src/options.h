@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Vol
+{
+struct BenchmarkOptions {
+    std::vector<std::filesystem::path> dataset;
+    std::optional<std::filesystem::path> transfer_function;
+
+    // A scripted camera path, or the file of a recorded one
+    std::string camera_path = "orbit";
+
+    uint32_t frame_count = 300;
+    uint32_t warmup_frames = 30;
+    std::optional<std::filesystem::path> report;
+};
+
+// A dataset rendered once and written to an image
+struct ExportOptions {
+    std::vector<std::filesystem::path> dataset;
+    std::optional<std::filesystem::path> transfer_function;
+    std::filesystem::path output;
+};
+
+struct Options {
+    // Size of the window, or of the image when headless
+    uint32_t window_width = 1280;
+    uint32_t window_height = 720;
+
+    // Without a window nothing is presented, only rendered offscreen
+    bool headless = false;
+
+    // Benchmarks and exports are rendered on the CPU, without a device
+    bool cpu = false;
+
+    // The camera of every frame is recorded to the file on exit
+    std::optional<std::filesystem::path> record_path;
+
+    std::optional<BenchmarkOptions> benchmark;
+    std::optional<ExportOptions> image_export;
+
+    // Manifest of the jobs a batch renders
+    std::optional<std::filesystem::path> batch;
+};
+
+extern const char *usage;
+
+// Throws if the arguments can't be made sense of
+Options parse_options(int argc, char *argv[]);
+}  // namespace Vol
\ No newline at end of file
@@ -0,0 +1,675 @@
+#include "cpu_raymarcher.h"
+
+#include "core/simd.h"
+#include "core/thread_pool.h"
+#include "data/dataset.h"
+#include "data/histogram.h"
+#include "rendering/preintegration.h"
+#include "rendering/util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+// Side of the square tiles frames are split into, small enough for the pool
+// to even out tiles whose rays take longer
+const uint32_t tile_size = 16;
+
+// Rays traced together, one per lane of an AVX2 register
+const uint32_t packet_size = 8;
+
+// Everything rays are set up and marched with that stays the same over a
+// frame, in the shader's terms
+struct MarchParams {
+    glm::mat4 inverse_view_proj;
+    glm::vec3 camera_position;
+    glm::vec3 box_min, box_max;
+    glm::vec2 frame_size;
+
+    const float *voxels;
+    glm::ivec3 dimensions;
+    float min_density;
+    float density_scale;
+
+    const float *transfer[4];
+    int transfer_size;
+
+    float step_size;
+    float opacity_correction;
+    float min_transmittance;
+};
+
+// Lanes of a packet, each a ray's origin in texture space, its direction and
+// the part of it that is marched. Lanes without a ray end before they start.
+struct RayPacket {
+    float origin[3][packet_size];
+    float dir[3][packet_size];
+    float start[packet_size];
+    float end[packet_size];
+    float color[4][packet_size];
+};
+
+void render_tile(
+    const MarchParams &params,
+    bool packed,
+    glm::u32vec2 begin,
+    glm::u32vec2 end,
+    uint8_t *pixels);
+
+void setup_ray(
+    const MarchParams &params,
+    uint32_t x,
+    uint32_t y,
+    RayPacket &packet,
+    uint32_t lane);
+
+glm::vec2 intersect_box(
+    glm::vec3 origin,
+    glm::vec3 dir,
+    glm::vec3 box_min,
+    glm::vec3 box_max);
+
+void march_packet(const MarchParams &params, RayPacket &packet);
+
+float sample_density(const MarchParams &params, glm::vec3 pos);
+
+glm::vec4 sample_transfer(const MarchParams &params, float front, float back);
+
+#ifdef VOL_X86
+VOL_TARGET("avx2")
+void march_packet_avx2(const MarchParams &params, RayPacket &packet);
+
+VOL_TARGET("avx2")
+__m256 sample_density_avx2(
+    const MarchParams &params,
+    const __m256 (&pos)[3],
+    __m256 active);
+
+VOL_TARGET("avx2")
+void sample_transfer_avx2(
+    const MarchParams &params,
+    __m256 front,
+    __m256 back,
+    __m256 active,
+    __m256 (&segment)[4]);
+
+VOL_TARGET("avx2")
+__m256 exp_avx2(__m256 x);
+
+VOL_TARGET("avx2")
+__m256 lerp_avx2(__m256 a, __m256 b, __m256 t);
+#endif  // VOL_X86
+
+Vol::Rendering::CpuRaymarcher::CpuRaymarcher(
+    std::shared_ptr<const Data::Dataset> dataset,
+    const std::vector<uint32_t> &transfer_function,
+    Core::ThreadPool *thread_pool)
+    : dimensions(dataset->dimensions),
+      transfer_size(transfer_function.size())
+{
+    if (transfer_size < 2) {
+        throw std::invalid_argument("Transfer function needs two texels");
+    }
+
+    // Voxels are widened to float once, whatever they are stored as.
+    // Datasets loaded from the cache decode theirs first.
+    size_t count = dataset->get_voxel_count();
+    voxels.resize(count);
+    std::vector<std::byte> decoded;
+    std::span<const std::byte> resident;
+    if (dataset->cache) {
+        decoded.resize(dataset->get_size());
+        dataset->read_voxels(decoded.data());
+        resident = decoded;
+    } else {
+        resident = dataset->get_voxels();
+    }
+    Data::widen_to_float(resident.data(), voxels.data(), count, dataset->type);
+
+    // The density window clips the tails of the histogram like the device's
+    std::pair<float, float> window = {dataset->min, dataset->max};
+    if (dataset->histogram) {
+        window = dataset->histogram->get_window();
+    }
+    min_density = window.first;
+    max_density = window.second;
+
+    // Segments are looked up in the same half floats the device filters
+    std::vector<uint16_t> table =
+        preintegrate_transfer_function(transfer_function, thread_pool);
+    for (size_t channel = 0; channel < 4; channel++) {
+        transfer[channel].resize(transfer_size * transfer_size);
+        for (size_t i = 0; i < transfer[channel].size(); i++) {
+            transfer[channel][i] = Data::half_to_float(table[i * 4 + channel]);
+        }
+    }
+
+    packed = Core::get_simd_level() == Core::SimdLevel::Avx2 &&
+             count <= static_cast<size_t>(std::numeric_limits<int32_t>::max());
+}
+
+void Vol::Rendering::CpuRaymarcher::sampling_rate_changed(
+    float samples_per_voxel)
+{
+    this->samples_per_voxel = samples_per_voxel;
+}
+
+void Vol::Rendering::CpuRaymarcher::ray_termination_changed(
+    float min_transmittance)
+{
+    this->min_transmittance = min_transmittance;
+}
+
+std::vector<uint8_t> Vol::Rendering::CpuRaymarcher::render(
+    const CpuView &view,
+    uint32_t width,
+    uint32_t height,
+    Core::ThreadPool *thread_pool) const
+{
+    // Rays step a fraction of a voxel of the volume's largest side, with
+    // opacities corrected for the step taken
+    float voxel_count = static_cast<float>(
+        std::max({dimensions.x, dimensions.y, dimensions.z}));
+    MarchParams params{
+        .inverse_view_proj = glm::inverse(view.proj * view.view),
+        .camera_position = view.camera_position,
+        .box_min = glm::max(view.min_slice, glm::vec3(0.0f)),
+        .box_max = glm::min(view.max_slice, glm::vec3(1.0f)),
+        .frame_size = glm::vec2(width, height),
+        .voxels = voxels.data(),
+        .dimensions = glm::ivec3(dimensions),
+        .min_density = min_density,
+        .density_scale = 1.0f / (max_density - min_density),
+        .transfer =
+            {
+                transfer[0].data(),
+                transfer[1].data(),
+                transfer[2].data(),
+                transfer[3].data(),
+            },
+        .transfer_size = static_cast<int>(transfer_size),
+        .step_size = 1.0f / (voxel_count * samples_per_voxel),
+        .opacity_correction = 1.0f / samples_per_voxel,
+        .min_transmittance = min_transmittance,
+    };
+
+    // Tiles are taken one at a time, so threads that finish theirs early
+    // take on more of the rest
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    glm::u32vec2 tiles(
+        (width + tile_size - 1) / tile_size,
+        (height + tile_size - 1) / tile_size);
+    auto render_tiles = [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            glm::u32vec2 origin(
+                tile % tiles.x * tile_size, tile / tiles.x * tile_size);
+            glm::u32vec2 extent =
+                glm::min(origin + tile_size, glm::u32vec2(width, height));
+            render_tile(params, packed, origin, extent, pixels.data());
+        }
+    };
+    size_t tile_count = static_cast<size_t>(tiles.x) * tiles.y;
+    if (thread_pool) {
+        thread_pool->parallel_for(tile_count, 1, render_tiles);
+    } else {
+        render_tiles(0, tile_count);
+    }
+
+    return pixels;
+}
+
+const char *Vol::Rendering::CpuRaymarcher::get_simd_name() const
+{
+    return packed ? "AVX2" : "scalar";
+}
+
+void render_tile(
+    const MarchParams &params,
+    bool packed,
+    glm::u32vec2 begin,
+    glm::u32vec2 end,
+    uint8_t *pixels)
+{
+    uint32_t width = static_cast<uint32_t>(params.frame_size.x);
+    for (uint32_t y = begin.y; y < end.y; y++) {
+        for (uint32_t x = begin.x; x < end.x; x += packet_size) {
+            // Packets run along rows, lanes past the tile's edge stay empty
+            RayPacket packet;
+            uint32_t lane_count = std::min(packet_size, end.x - x);
+            for (uint32_t lane = 0; lane < packet_size; lane++) {
+                setup_ray(params, x + lane, y, packet, lane);
+                if (lane >= lane_count) {
+                    packet.end[lane] = -1.0f;
+                }
+            }
+
+#ifdef VOL_X86
+            if (packed) {
+                march_packet_avx2(params, packet);
+            } else {
+                march_packet(params, packet);
+            }
+#else
+            march_packet(params, packet);
+#endif  // VOL_X86
+
+            // Blended over the background with the source's alpha, as the
+            // device blends into its UNORM attachment
+            for (uint32_t lane = 0; lane < lane_count; lane++) {
+                uint8_t *pixel =
+                    pixels + (static_cast<size_t>(y) * width + x + lane) * 4;
+                float alpha = std::clamp(packet.color[3][lane], 0.0f, 1.0f);
+                for (uint32_t channel = 0; channel < 4; channel++) {
+                    float source =
+                        std::clamp(packet.color[channel][lane], 0.0f, 1.0f);
+                    float background =
+                        Vol::Rendering::background_color[channel];
+                    float value = source * alpha + background * (1.0f - alpha);
+                    pixel[channel] =
+                        static_cast<uint8_t>(value * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+void setup_ray(
+    const MarchParams &params,
+    uint32_t x,
+    uint32_t y,
+    RayPacket &packet,
+    uint32_t lane)
+{
+    // Rays run from the camera through the pixel's center, in the frame the
+    // device rasterizes the volume's faces in
+    glm::vec2 ndc =
+        (glm::vec2(x, y) + 0.5f) / params.frame_size * 2.0f - 1.0f;
+    glm::vec4 point =
+        params.inverse_view_proj * glm::vec4(ndc.x, ndc.y, 0.5f, 1.0f);
+    glm::vec3 dir = glm::normalize(
+        glm::vec3(point) / point.w - params.camera_position);
+
+    // Rays start where they enter the volume's front faces. The device culls
+    // its back faces, so cameras inside the volume see nothing of it.
+    glm::vec2 cube_range = intersect_box(
+        params.camera_position, dir, glm::vec3(-0.5f), glm::vec3(0.5f));
+    glm::vec3 origin =
+        params.camera_position + dir * cube_range.x + glm::vec3(0.5f);
+    glm::vec2 ray_range =
+        intersect_box(origin, dir, params.box_min, params.box_max);
+    float start =
+        std::ceil(std::max(ray_range.x, 0.0f) / params.step_size) *
+        params.step_size;
+    bool hit = cube_range.x >= 0.0f && cube_range.x <= cube_range.y;
+
+    for (int axis = 0; axis < 3; axis++) {
+        packet.origin[axis][lane] = hit ? origin[axis] : 0.0f;
+        packet.dir[axis][lane] = hit ? dir[axis] : 0.0f;
+    }
+    packet.start[lane] = hit ? start : 0.0f;
+    packet.end[lane] = hit ? ray_range.y : -1.0f;
+}
+
+glm::vec2 intersect_box(
+    glm::vec3 origin,
+    glm::vec3 dir,
+    glm::vec3 box_min,
+    glm::vec3 box_max)
+{
+    // Axes the ray runs parallel to are nudged off zero like the shader's
+    glm::vec3 inv_dir = 1.0f / glm::mix(
+                                   dir, glm::vec3(1e-8f),
+                                   glm::lessThan(
+                                       glm::abs(dir), glm::vec3(1e-8f)));
+    glm::vec3 t0 = (box_min - origin) * inv_dir;
+    glm::vec3 t1 = (box_max - origin) * inv_dir;
+    glm::vec3 t_near = glm::min(t0, t1);
+    glm::vec3 t_far = glm::max(t0, t1);
+    return glm::vec2(
+        std::max({t_near.x, t_near.y, t_near.z}),
+        std::min({t_far.x, t_far.y, t_far.z}));
+}
+
+void march_packet(const MarchParams &params, RayPacket &packet)
+{
+    for (uint32_t lane = 0; lane < packet_size; lane++) {
+        glm::vec3 origin(
+            packet.origin[0][lane], packet.origin[1][lane],
+            packet.origin[2][lane]);
+        glm::vec3 dir(
+            packet.dir[0][lane], packet.dir[1][lane], packet.dir[2][lane]);
+        glm::vec3 color(0.0f);
+        float transmittance = 1.0f;
+
+        // Density of the sample before, which starts the segment to the next
+        float front = 0.0f;
+        bool has_front = false;
+
+        float ray_dist = packet.start[lane];
+        while (ray_dist < packet.end[lane] &&
+               transmittance >= params.min_transmittance) {
+            float density = sample_density(params, origin + dir * ray_dist);
+            float t = (density - params.min_density) * params.density_scale;
+            front = has_front ? front : t;
+            has_front = true;
+
+            glm::vec4 segment = sample_transfer(params, front, t);
+            float alpha =
+                1.0f - std::exp(-segment.w * params.opacity_correction);
+            color += transmittance * alpha * glm::vec3(segment);
+            transmittance *= 1.0f - alpha;
+            front = t;
+            ray_dist += params.step_size;
+        }
+
+        for (int channel = 0; channel < 3; channel++) {
+            packet.color[channel][lane] = color[channel];
+        }
+        packet.color[3][lane] = 1.0f - transmittance;
+    }
+}
+
+float sample_density(const MarchParams &params, glm::vec3 pos)
+{
+    // Trilinear between the eight nearest voxel centers, voxels outside the
+    // volume are zero like the device's border
+    glm::vec3 voxel = pos * glm::vec3(params.dimensions) - 0.5f;
+    glm::vec3 floored = glm::floor(voxel);
+    glm::vec3 fraction = voxel - floored;
+    glm::ivec3 base(floored);
+
+    float corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::ivec3 corner = base + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2);
+        bool inside = glm::all(glm::greaterThanEqual(corner, glm::ivec3(0))) &&
+                      glm::all(glm::lessThan(corner, params.dimensions));
+        size_t index = (static_cast<size_t>(corner.z) * params.dimensions.y +
+                        corner.y) *
+                           params.dimensions.x +
+                       corner.x;
+        corners[i] = inside ? params.voxels[index] : 0.0f;
+    }
+
+    float x00 = corners[0] + (corners[1] - corners[0]) * fraction.x;
+    float x10 = corners[2] + (corners[3] - corners[2]) * fraction.x;
+    float x01 = corners[4] + (corners[5] - corners[4]) * fraction.x;
+    float x11 = corners[6] + (corners[7] - corners[6]) * fraction.x;
+    float y0 = x00 + (x10 - x00) * fraction.y;
+    float y1 = x01 + (x11 - x01) * fraction.y;
+    return y0 + (y1 - y0) * fraction.z;
+}
+
+glm::vec4 sample_transfer(const MarchParams &params, float front, float back)
+{
+    // Bilinear between texel centers, clamped to the edge texels. Densities
+    // that aren't numbers clamp to the first.
+    float last = static_cast<float>(params.transfer_size - 1);
+    glm::vec2 texel(
+        std::clamp(front * params.transfer_size - 0.5f, 0.0f, last),
+        std::clamp(back * params.transfer_size - 0.5f, 0.0f, last));
+    if (std::isnan(texel.x)) {
+        texel.x = 0.0f;
+    }
+    if (std::isnan(texel.y)) {
+        texel.y = 0.0f;
+    }
+    glm::ivec2 base =
+        glm::min(glm::ivec2(texel), glm::ivec2(params.transfer_size - 2));
+    glm::vec2 fraction = texel - glm::vec2(base);
+
+    size_t row = static_cast<size_t>(base.y) * params.transfer_size + base.x;
+    size_t next_row = row + params.transfer_size;
+    glm::vec4 segment;
+    for (int channel = 0; channel < 4; channel++) {
+        const float *plane = params.transfer[channel];
+        float top = plane[row] + (plane[row + 1] - plane[row]) * fraction.x;
+        float bottom = plane[next_row] +
+                       (plane[next_row + 1] - plane[next_row]) * fraction.x;
+        segment[channel] = top + (bottom - top) * fraction.y;
+    }
+    return segment;
+}
+
+#ifdef VOL_X86
+VOL_TARGET("avx2")
+void march_packet_avx2(const MarchParams &params, RayPacket &packet)
+{
+    __m256 origin[3], dir[3];
+    for (int axis = 0; axis < 3; axis++) {
+        origin[axis] = _mm256_loadu_ps(packet.origin[axis]);
+        dir[axis] = _mm256_loadu_ps(packet.dir[axis]);
+    }
+    __m256 ray_dist = _mm256_loadu_ps(packet.start);
+    __m256 end = _mm256_loadu_ps(packet.end);
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 step_size = _mm256_set1_ps(params.step_size);
+    const __m256 min_transmittance = _mm256_set1_ps(params.min_transmittance);
+    const __m256 min_density = _mm256_set1_ps(params.min_density);
+    const __m256 density_scale = _mm256_set1_ps(params.density_scale);
+    const __m256 opacity_correction =
+        _mm256_set1_ps(params.opacity_correction);
+
+    __m256 color[3] = {zero, zero, zero};
+    __m256 transmittance = one;
+    __m256 front = zero;
+    __m256 has_front = zero;
+
+    // Lanes drop out as their rays end or turn opaque and never come back,
+    // the packet is done once none are left
+    while (true) {
+        __m256 active = _mm256_and_ps(
+            _mm256_cmp_ps(ray_dist, end, _CMP_LT_OQ),
+            _mm256_cmp_ps(transmittance, min_transmittance, _CMP_GE_OQ));
+        if (_mm256_movemask_ps(active) == 0) {
+            break;
+        }
+
+        __m256 pos[3];
+        for (int axis = 0; axis < 3; axis++) {
+            pos[axis] =
+                _mm256_add_ps(origin[axis], _mm256_mul_ps(dir[axis], ray_dist));
+        }
+        __m256 density = sample_density_avx2(params, pos, active);
+        __m256 t = _mm256_mul_ps(
+            _mm256_sub_ps(density, min_density), density_scale);
+        front = _mm256_blendv_ps(t, front, has_front);
+        has_front = _mm256_or_ps(has_front, active);
+
+        __m256 segment[4];
+        sample_transfer_avx2(params, front, t, active, segment);
+        __m256 alpha = _mm256_sub_ps(
+            one, exp_avx2(_mm256_mul_ps(
+                     _mm256_sub_ps(zero, segment[3]), opacity_correction)));
+
+        // Only lanes still marching take on the sample
+        __m256 weight = _mm256_mul_ps(transmittance, alpha);
+        for (int channel = 0; channel < 3; channel++) {
+            color[channel] = _mm256_blendv_ps(
+                color[channel],
+                _mm256_add_ps(
+                    color[channel], _mm256_mul_ps(weight, segment[channel])),
+                active);
+        }
+        transmittance = _mm256_blendv_ps(
+            transmittance,
+            _mm256_mul_ps(transmittance, _mm256_sub_ps(one, alpha)), active);
+        front = t;
+        ray_dist = _mm256_add_ps(ray_dist, step_size);
+    }
+
+    for (int channel = 0; channel < 3; channel++) {
+        _mm256_storeu_ps(packet.color[channel], color[channel]);
+    }
+    _mm256_storeu_ps(packet.color[3], _mm256_sub_ps(one, transmittance));
+}
+
+VOL_TARGET("avx2")
+__m256 sample_density_avx2(
+    const MarchParams &params,
+    const __m256 (&pos)[3],
+    __m256 active)
+{
+    // Corners outside the volume are left out of the gathers and stay zero
+    const __m256i dimensions[3] = {
+        _mm256_set1_epi32(params.dimensions.x),
+        _mm256_set1_epi32(params.dimensions.y),
+        _mm256_set1_epi32(params.dimensions.z),
+    };
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    __m256 fraction[3];
+    __m256i lower[3], upper[3];
+    __m256i lower_inside[3], upper_inside[3];
+    for (int axis = 0; axis < 3; axis++) {
+        __m256 voxel = _mm256_sub_ps(
+            _mm256_mul_ps(
+                pos[axis], _mm256_cvtepi32_ps(dimensions[axis])),
+            _mm256_set1_ps(0.5f));
+        __m256 floored = _mm256_floor_ps(voxel);
+        fraction[axis] = _mm256_sub_ps(voxel, floored);
+        lower[axis] = _mm256_cvttps_epi32(floored);
+        upper[axis] = _mm256_add_epi32(lower[axis], one);
+        lower_inside[axis] = _mm256_and_si256(
+            _mm256_cmpgt_epi32(lower[axis], minus_one),
+            _mm256_cmpgt_epi32(dimensions[axis], lower[axis]));
+        upper_inside[axis] = _mm256_and_si256(
+            _mm256_cmpgt_epi32(upper[axis], minus_one),
+            _mm256_cmpgt_epi32(dimensions[axis], upper[axis]));
+    }
+
+    __m256 corners[8];
+    for (int i = 0; i < 8; i++) {
+        __m256i x = i & 1 ? upper[0] : lower[0];
+        __m256i y = i & 2 ? upper[1] : lower[1];
+        __m256i z = i & 4 ? upper[2] : lower[2];
+        __m256i inside = _mm256_and_si256(
+            _mm256_and_si256(
+                i & 1 ? upper_inside[0] : lower_inside[0],
+                i & 2 ? upper_inside[1] : lower_inside[1]),
+            _mm256_and_si256(
+                i & 4 ? upper_inside[2] : lower_inside[2],
+                _mm256_castps_si256(active)));
+        __m256i index = _mm256_add_epi32(
+            _mm256_mullo_epi32(
+                _mm256_add_epi32(
+                    _mm256_mullo_epi32(z, dimensions[1]), y),
+                dimensions[0]),
+            x);
+        corners[i] = _mm256_mask_i32gather_ps(
+            _mm256_setzero_ps(), params.voxels, index,
+            _mm256_castsi256_ps(inside), sizeof(float));
+    }
+
+    __m256 x00 = lerp_avx2(corners[0], corners[1], fraction[0]);
+    __m256 x10 = lerp_avx2(corners[2], corners[3], fraction[0]);
+    __m256 x01 = lerp_avx2(corners[4], corners[5], fraction[0]);
+    __m256 x11 = lerp_avx2(corners[6], corners[7], fraction[0]);
+    __m256 y0 = lerp_avx2(x00, x10, fraction[1]);
+    __m256 y1 = lerp_avx2(x01, x11, fraction[1]);
+    return lerp_avx2(y0, y1, fraction[2]);
+}
+
+VOL_TARGET("avx2")
+void sample_transfer_avx2(
+    const MarchParams &params,
+    __m256 front,
+    __m256 back,
+    __m256 active,
+    __m256 (&segment)[4])
+{
+    // Max returns its second operand for NaNs, which clamps them to the
+    // first texel like the scalar lookup
+    const __m256 size =
+        _mm256_set1_ps(static_cast<float>(params.transfer_size));
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 last =
+        _mm256_set1_ps(static_cast<float>(params.transfer_size - 1));
+    const __m256i last_base = _mm256_set1_epi32(params.transfer_size - 2);
+    __m256 u = _mm256_min_ps(
+        _mm256_max_ps(
+            _mm256_sub_ps(_mm256_mul_ps(front, size), half),
+            _mm256_setzero_ps()),
+        last);
+    __m256 v = _mm256_min_ps(
+        _mm256_max_ps(
+            _mm256_sub_ps(_mm256_mul_ps(back, size), half),
+            _mm256_setzero_ps()),
+        last);
+    __m256i column =
+        _mm256_min_epi32(_mm256_cvttps_epi32(u), last_base);
+    __m256i row = _mm256_min_epi32(_mm256_cvttps_epi32(v), last_base);
+    __m256 fraction_u = _mm256_sub_ps(u, _mm256_cvtepi32_ps(column));
+    __m256 fraction_v = _mm256_sub_ps(v, _mm256_cvtepi32_ps(row));
+
+    __m256i stride = _mm256_set1_epi32(params.transfer_size);
+    __m256i top = _mm256_add_epi32(_mm256_mullo_epi32(row, stride), column);
+    __m256i bottom = _mm256_add_epi32(top, stride);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i taps[4] = {
+        top,
+        _mm256_add_epi32(top, one),
+        bottom,
+        _mm256_add_epi32(bottom, one),
+    };
+
+    for (int channel = 0; channel < 4; channel++) {
+        __m256 texels[4];
+        for (int tap = 0; tap < 4; tap++) {
+            texels[tap] = _mm256_mask_i32gather_ps(
+                _mm256_setzero_ps(), params.transfer[channel], taps[tap],
+                active, sizeof(float));
+        }
+        __m256 upper = lerp_avx2(texels[0], texels[1], fraction_u);
+        __m256 lower = lerp_avx2(texels[2], texels[3], fraction_u);
+        segment[channel] = lerp_avx2(upper, lower, fraction_v);
+    }
+}
+
+VOL_TARGET("avx2")
+__m256 exp_avx2(__m256 x)
+{
+    // Cephes' expf: split off a power of two, then a polynomial for the rest
+    x = _mm256_min_ps(
+        _mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+    __m256 exponent = _mm256_round_ps(
+        _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_sub_ps(
+        x, _mm256_mul_ps(exponent, _mm256_set1_ps(0.693359375f)));
+    x = _mm256_sub_ps(
+        x, _mm256_mul_ps(exponent, _mm256_set1_ps(-2.12194440e-4f)));
+
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_add_ps(
+        _mm256_mul_ps(y, x), _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_add_ps(
+        _mm256_mul_ps(y, x), _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_add_ps(
+        _mm256_mul_ps(y, x), _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_add_ps(
+        _mm256_mul_ps(y, x), _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_add_ps(
+        _mm256_mul_ps(y, x), _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(x, x)), x),
+        _mm256_set1_ps(1.0f));
+
+    __m256i power = _mm256_slli_epi32(
+        _mm256_add_epi32(
+            _mm256_cvtps_epi32(exponent), _mm256_set1_epi32(127)),
+        23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(power));
+}
+
+VOL_TARGET("avx2")
+__m256 lerp_avx2(__m256 a, __m256 b, __m256 t)
+{
+    return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+}
+#endif  // VOL_X86
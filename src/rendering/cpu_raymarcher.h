@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Vol::Core
+{
+class ThreadPool;
+}  // namespace Vol::Core
+
+namespace Vol::Data
+{
+struct Dataset;
+}  // namespace Vol::Data
+
+namespace Vol::Rendering
+{
+// Camera and slicing a frame is rendered with, as the offscreen pass sets
+// them in its uniform buffer
+struct CpuView {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::vec3 camera_position;
+    glm::vec3 min_slice = glm::vec3(0.0f);
+    glm::vec3 max_slice = glm::vec3(1.0f);
+};
+
+// Raymarches a volume on the CPU the way volume.frag does on the device, for
+// machines without one and to check shader changes against. Rays are traced
+// in packets, one per SIMD lane, that sample the volume and the preintegrated
+// transfer function with gathers. The finest level is sampled throughout and
+// every sample is taken, so images match the device's where it renders the
+// finest level, up to rounding and the segments rays start after empty
+// space it leapt over. Rays are blended over the background as the device
+// blends them over its cleared attachment.
+class CpuRaymarcher {
+  public:
+    // The transfer function is preintegrated across the pool, or on the
+    // calling thread without one
+    CpuRaymarcher(
+        std::shared_ptr<const Data::Dataset> dataset,
+        const std::vector<uint32_t> &transfer_function,
+        Core::ThreadPool *thread_pool = nullptr);
+
+    void sampling_rate_changed(float samples_per_voxel);
+    void ray_termination_changed(float min_transmittance);
+
+    // Renders rows of RGBA pixels from the top, as the offscreen pass's image
+    // is read back. Tiles are spread across the pool and the calling thread,
+    // without a pool the calling thread renders them all.
+    std::vector<uint8_t> render(
+        const CpuView &view,
+        uint32_t width,
+        uint32_t height,
+        Core::ThreadPool *thread_pool = nullptr) const;
+
+    // Instruction set rays are traced with
+    const char *get_simd_name() const;
+
+  private:
+    glm::u32vec3 dimensions;
+    std::vector<float> voxels;
+
+    // Densities the transfer function spans
+    float min_density, max_density;
+
+    // Planes of red, green, blue and extinction of the preintegrated
+    // transfer function, front densities along rows
+    size_t transfer_size;
+    std::vector<float> transfer[4];
+
+    // Packets are traced with AVX2 where the CPU has it and the volume can
+    // be gathered from with 32-bit indices
+    bool packed = false;
+
+    float samples_per_voxel = 1.0f;
+    float min_transmittance = 0.01f;
+};
+}  // namespace Vol::Rendering
\ No newline at end of file
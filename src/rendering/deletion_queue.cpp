@@ -0,0 +1,81 @@
+#include "deletion_queue.h"
+
+#include "rendering/vulkan_context.h"
+
+Vol::Rendering::DeletionQueue::DeletionQueue(VulkanContext *context)
+    : context(context)
+{
+}
+
+Vol::Rendering::DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+void Vol::Rendering::DeletionQueue::retire(std::function<void()> destroy)
+{
+    retired.emplace_back(frame_count, std::move(destroy));
+}
+
+void Vol::Rendering::DeletionQueue::retire(
+    VkImage &image,
+    MemoryAllocation &memory)
+{
+    retire([this, image = std::exchange(image, VK_NULL_HANDLE),
+            memory = std::exchange(memory, {})]() mutable {
+        vkDestroyImage(context->get_device(), image, nullptr);
+        context->get_memory_allocator()->free(memory);
+    });
+}
+
+void Vol::Rendering::DeletionQueue::retire(
+    VkBuffer &buffer,
+    MemoryAllocation &memory)
+{
+    retire([this, buffer = std::exchange(buffer, VK_NULL_HANDLE),
+            memory = std::exchange(memory, {})]() mutable {
+        vkDestroyBuffer(context->get_device(), buffer, nullptr);
+        context->get_memory_allocator()->free(memory);
+    });
+}
+
+void Vol::Rendering::DeletionQueue::retire(VkImageView &image_view)
+{
+    retire([this, image_view = std::exchange(image_view, VK_NULL_HANDLE)]() {
+        vkDestroyImageView(context->get_device(), image_view, nullptr);
+    });
+}
+
+void Vol::Rendering::DeletionQueue::retire(VkSampler &sampler)
+{
+    retire([this, sampler = std::exchange(sampler, VK_NULL_HANDLE)]() {
+        vkDestroySampler(context->get_device(), sampler, nullptr);
+    });
+}
+
+void Vol::Rendering::DeletionQueue::retire(VkFramebuffer &framebuffer)
+{
+    retire([this, framebuffer = std::exchange(framebuffer, VK_NULL_HANDLE)]() {
+        vkDestroyFramebuffer(context->get_device(), framebuffer, nullptr);
+    });
+}
+
+void Vol::Rendering::DeletionQueue::begin_frame()
+{
+    // Frames up to MAX_FRAMES_IN_FLIGHT before this one have completed, and
+    // with them everything retired before they began
+    while (!retired.empty() &&
+           retired.front().first + MAX_FRAMES_IN_FLIGHT <= frame_count) {
+        retired.front().second();
+        retired.pop_front();
+    }
+    frame_count++;
+}
+
+void Vol::Rendering::DeletionQueue::flush()
+{
+    for (auto &[frame, destroy] : retired) {
+        destroy();
+    }
+    retired.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "rendering/memory_allocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace Vol::Rendering
+{
+class VulkanContext;
+}
+
+namespace Vol::Rendering
+{
+// Destroys resources frames in flight may still use once those frames have
+// completed, so replacing them never waits for the device. A resource
+// retired after frame N began is used at the latest by frame N + 1, which
+// submits the uploads staged before it, and is destroyed once the fence of
+// that frame has been waited on.
+class DeletionQueue {
+  public:
+    explicit DeletionQueue(VulkanContext *context);
+    ~DeletionQueue();
+
+    // Queues a resource for destruction, resetting handles and allocations
+    // so the caller can tell they were handed over
+    void retire(std::function<void()> destroy);
+    void retire(VkImage &image, MemoryAllocation &memory);
+    void retire(VkBuffer &buffer, MemoryAllocation &memory);
+    void retire(VkImageView &image_view);
+    void retire(VkSampler &sampler);
+    void retire(VkFramebuffer &framebuffer);
+
+    // Destroys what frames completed by now last used, called once the
+    // fence of the frame about to be recorded has been waited on
+    void begin_frame();
+
+    // Destroys everything retired, once the device is idle
+    void flush();
+
+  private:
+    VulkanContext *context;
+    uint64_t frame_count = 0;
+    std::deque<std::pair<uint64_t, std::function<void()>>> retired;
+};
+}  // namespace Vol::Rendering
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "gpu_profiler.h"
+
+#include "rendering/vulkan_context.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+// Frames a scope's statistics are taken over
+const size_t gpu_history_size = 240;
+
+// Batches timed outside of frames that can be in flight at once
+const uint32_t gpu_batch_count = 16;
+
+Vol::Rendering::GpuProfiler::GpuProfiler(VulkanContext *context)
+    : context(context)
+{
+    // Devices that can't time their graphics queue leave every scope untimed
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->get_physical_device(), &properties);
+    if (!properties.limits.timestampComputeAndGraphics) {
+        return;
+    }
+    timestamp_period = properties.limits.timestampPeriod;
+
+    // Every scope takes a timestamp at its start and end
+    VkQueryPoolCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = gpu_scope_count * 2,
+    };
+
+    query_pools.resize(MAX_FRAMES_IN_FLIGHT);
+    for (VkQueryPool &query_pool : query_pools) {
+        if (vkCreateQueryPool(
+                context->get_device(), &create_info, nullptr, &query_pool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create query pool");
+        }
+    }
+    scopes_written.resize(MAX_FRAMES_IN_FLIGHT);
+
+    create_info.queryCount = gpu_batch_count * 2;
+    if (vkCreateQueryPool(
+            context->get_device(), &create_info, nullptr,
+            &batch_query_pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create query pool");
+    }
+    batch_scopes.resize(gpu_batch_count);
+    for (uint32_t i = gpu_batch_count; i > 0; i--) {
+        free_batches.push_back(i - 1);
+    }
+}
+
+Vol::Rendering::GpuProfiler::~GpuProfiler()
+{
+    for (VkQueryPool query_pool : query_pools) {
+        vkDestroyQueryPool(context->get_device(), query_pool, nullptr);
+    }
+    vkDestroyQueryPool(context->get_device(), batch_query_pool, nullptr);
+}
+
+void Vol::Rendering::GpuProfiler::begin_frame(
+    VkCommandBuffer command_buffer,
+    uint32_t frame_index)
+{
+    this->frame_index = frame_index;
+    if (!is_supported()) {
+        return;
+    }
+
+    read_back(frame_index);
+
+    vkCmdResetQueryPool(
+        command_buffer, query_pools[frame_index], 0, gpu_scope_count * 2);
+    scopes_written[frame_index].fill(false);
+}
+
+void Vol::Rendering::GpuProfiler::begin_scope(
+    VkCommandBuffer command_buffer,
+    GpuScope scope)
+{
+    if (!is_supported()) {
+        return;
+    }
+
+    uint32_t query = static_cast<uint32_t>(scope) * 2;
+    vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        query_pools[frame_index], query);
+}
+
+void Vol::Rendering::GpuProfiler::end_scope(
+    VkCommandBuffer command_buffer,
+    GpuScope scope)
+{
+    if (!is_supported()) {
+        return;
+    }
+
+    uint32_t query = static_cast<uint32_t>(scope) * 2 + 1;
+    vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        query_pools[frame_index], query);
+    scopes_written[frame_index][static_cast<size_t>(scope)] = true;
+}
+
+std::optional<uint32_t> Vol::Rendering::GpuProfiler::begin_batch(
+    VkCommandBuffer command_buffer,
+    GpuScope scope)
+{
+    if (!is_supported() || free_batches.empty()) {
+        return std::nullopt;
+    }
+    uint32_t batch = free_batches.back();
+    free_batches.pop_back();
+    batch_scopes[batch] = scope;
+
+    // The batch resets its queries itself, it runs ahead of any frame
+    vkCmdResetQueryPool(command_buffer, batch_query_pool, batch * 2, 2);
+    vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch_query_pool,
+        batch * 2);
+    return batch;
+}
+
+void Vol::Rendering::GpuProfiler::end_batch(
+    VkCommandBuffer command_buffer,
+    uint32_t batch)
+{
+    vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, batch_query_pool,
+        batch * 2 + 1);
+}
+
+void Vol::Rendering::GpuProfiler::read_batch(uint32_t batch)
+{
+    std::array<uint64_t, 2> timestamps;
+    if (vkGetQueryPoolResults(
+            context->get_device(), batch_query_pool, batch * 2, 2,
+            sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        size_t scope = static_cast<size_t>(batch_scopes[batch]);
+        batch_times[scope] =
+            batch_times[scope].value_or(0.0f) +
+            static_cast<float>(timestamps[1] - timestamps[0]) *
+                timestamp_period / 1e6f;
+    }
+    free_batches.push_back(batch);
+}
+
+std::optional<float> Vol::Rendering::GpuProfiler::get_frame_time(
+    GpuScope scope) const
+{
+    return frame_times[static_cast<size_t>(scope)];
+}
+
+Vol::Rendering::GpuScopeStats Vol::Rendering::GpuProfiler::get_stats(
+    GpuScope scope) const
+{
+    std::vector<float> times = history[static_cast<size_t>(scope)];
+    if (times.empty()) {
+        return {};
+    }
+
+    // Sort far enough to find the 95th percentile
+    auto p95 = times.begin() +
+               static_cast<size_t>(std::ceil(times.size() * 0.95f)) - 1;
+    std::nth_element(times.begin(), p95, times.end());
+
+    return GpuScopeStats{
+        .min = *std::min_element(times.begin(), times.end()),
+        .average = std::accumulate(times.begin(), times.end(), 0.0f) /
+                   times.size(),
+        .p95 = *p95,
+        .max = *std::max_element(times.begin(), times.end()),
+        .count = times.size(),
+    };
+}
+
+void Vol::Rendering::GpuProfiler::start_log(const std::filesystem::path &path)
+{
+    log = std::ofstream(path, std::ios::trunc);
+    if (!log) {
+        throw std::runtime_error("Failed to open profiler log");
+    }
+
+    // Header, one column per scope
+    log << "frame";
+    for (size_t i = 0; i < gpu_scope_count; i++) {
+        log << "," << get_gpu_scope_name(static_cast<GpuScope>(i)) << "_ms";
+    }
+    log << "\n";
+}
+
+void Vol::Rendering::GpuProfiler::stop_log()
+{
+    log.close();
+}
+
+void Vol::Rendering::GpuProfiler::read_back(uint32_t frame_index)
+{
+    // Scopes the frame didn't record stay untimed, as do those whose
+    // timestamps aren't available, unless batches read since the last frame
+    // timed them
+    for (size_t i = 0; i < gpu_scope_count; i++) {
+        frame_times[i] = std::exchange(batch_times[i], std::nullopt);
+
+        std::array<uint64_t, 2> timestamps;
+        if (scopes_written[frame_index][i] &&
+            vkGetQueryPoolResults(
+                context->get_device(), query_pools[frame_index],
+                static_cast<uint32_t>(i) * 2, 2, sizeof(timestamps),
+                timestamps.data(), sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            frame_times[i] =
+                frame_times[i].value_or(0.0f) +
+                static_cast<float>(timestamps[1] - timestamps[0]) *
+                    timestamp_period / 1e6f;
+        }
+        if (!frame_times[i]) {
+            continue;
+        }
+        float milliseconds = *frame_times[i];
+
+        // Keep the last frames of the scope in a ring
+        if (history[i].size() < gpu_history_size) {
+            history[i].push_back(milliseconds);
+        } else {
+            history[i][history_next[i]] = milliseconds;
+        }
+        history_next[i] = (history_next[i] + 1) % gpu_history_size;
+    }
+
+    // Only frames that timed anything are logged
+    bool timed = std::any_of(
+        frame_times.begin(), frame_times.end(),
+        [](const std::optional<float> &time) { return time.has_value(); });
+    if (log.is_open() && timed) {
+        log << frames_read;
+        for (const std::optional<float> &time : frame_times) {
+            log << ",";
+            if (time) {
+                log << *time;
+            }
+        }
+        log << "\n";
+    }
+    frames_read++;
+}
+
+const char *Vol::Rendering::get_gpu_scope_name(GpuScope scope)
+{
+    switch (scope) {
+        case GpuScope::Uploads:
+            return "uploads";
+        case GpuScope::Raymarch:
+            return "raymarch";
+        case GpuScope::Interface:
+            return "interface";
+    }
+    return "unknown";
+}
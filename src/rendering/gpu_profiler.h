@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+namespace Vol::Rendering
+{
+class VulkanContext;
+}
+
+namespace Vol::Rendering
+{
+// Parts of a frame timed on the device. Uploads covers the batch of the
+// upload ring submitted ahead of the frame and the pages copied into the
+// atlas. Volumes are copied on the transfer queue, which isn't timed.
+enum class GpuScope {
+    Uploads,
+    Raymarch,
+    Interface,
+};
+const size_t gpu_scope_count = 3;
+
+const char *get_gpu_scope_name(GpuScope scope);
+
+// Time a scope took over the last frames it was timed in, in milliseconds
+struct GpuScopeStats {
+    float min = 0.0f;
+    float average = 0.0f;
+    float p95 = 0.0f;
+    float max = 0.0f;
+    size_t count = 0;
+};
+
+// Brackets the scopes of every frame in flight with timestamps, in a query
+// pool of its own. They are read back once the frame's fence has been waited
+// on, so reading them never stalls.
+class GpuProfiler {
+  public:
+    explicit GpuProfiler(VulkanContext *context);
+    ~GpuProfiler();
+
+    // Reads back the timestamps the frame wrote when it was last recorded
+    // and resets its queries, once its fence has been waited on
+    void begin_frame(VkCommandBuffer command_buffer, uint32_t frame_index);
+
+    void begin_scope(VkCommandBuffer command_buffer, GpuScope scope);
+    void end_scope(VkCommandBuffer command_buffer, GpuScope scope);
+
+    // Times a command buffer submitted ahead of the frames, such as a batch
+    // of uploads, with queries of its own. Its time is added to the scope of
+    // the next frame read back once the batch is read, after its fence has
+    // signalled. Returns nothing, leaving the batch untimed, if every query
+    // is taken by batches still in flight.
+    std::optional<uint32_t> begin_batch(
+        VkCommandBuffer command_buffer,
+        GpuScope scope);
+    void end_batch(VkCommandBuffer command_buffer, uint32_t batch);
+    void read_batch(uint32_t batch);
+
+    // Time the scope took in the frame read back last, if it was timed
+    std::optional<float> get_frame_time(GpuScope scope) const;
+    GpuScopeStats get_stats(GpuScope scope) const;
+
+    // Every frame read back is appended to the log as a row of CSV
+    void start_log(const std::filesystem::path &path);
+    void stop_log();
+
+    inline bool is_logging() const { return log.is_open(); }
+    inline bool is_supported() const { return !query_pools.empty(); }
+
+  private:
+    void read_back(uint32_t frame_index);
+
+  private:
+    VulkanContext *context;
+    float timestamp_period = 0.0f;
+    std::vector<VkQueryPool> query_pools;
+    std::vector<std::array<bool, gpu_scope_count>> scopes_written;
+    VkQueryPool batch_query_pool = VK_NULL_HANDLE;
+    std::vector<GpuScope> batch_scopes;
+    std::vector<uint32_t> free_batches;
+    std::array<std::optional<float>, gpu_scope_count> batch_times;
+    uint32_t frame_index = 0;
+    uint64_t frames_read = 0;
+
+    std::array<std::optional<float>, gpu_scope_count> frame_times;
+    std::array<std::vector<float>, gpu_scope_count> history;
+    std::array<size_t, gpu_scope_count> history_next{};
+
+    std::ofstream log;
+};
+}  // namespace Vol::Rendering
\ No newline at end of file
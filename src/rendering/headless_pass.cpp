@@ -0,0 +1,117 @@
+#include "headless_pass.h"
+
+#include "rendering/deletion_queue.h"
+#include "rendering/gpu_profiler.h"
+#include "rendering/offscreen_pass.h"
+#include "rendering/upload_manager.h"
+#include "rendering/vulkan_context.h"
+
+#include <stdexcept>
+
+Vol::Rendering::HeadlessPass::HeadlessPass(VulkanContext *context)
+    : context(context)
+{
+    create_sync_objects();
+    allocate_command_buffers();
+}
+
+Vol::Rendering::HeadlessPass::~HeadlessPass()
+{
+    for (VkFence fence : in_flight_fences) {
+        vkDestroyFence(context->get_device(), fence, nullptr);
+    }
+}
+
+void Vol::Rendering::HeadlessPass::render()
+{
+    // Wait to start frame
+    vkWaitForFences(
+        context->get_device(), 1, &in_flight_fences[frame_index], VK_TRUE,
+        UINT64_MAX);
+    vkResetFences(context->get_device(), 1, &in_flight_fences[frame_index]);
+
+    // Destroy what only frames that have completed by now still used
+    context->get_deletion_queue()->begin_frame();
+
+    // Reset command buffer
+    VkCommandBuffer command_buffer = command_buffers[frame_index];
+    vkResetCommandBuffer(command_buffer, 0);
+
+    // Begin command buffer
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    };
+
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin command buffer");
+    }
+
+    // Read back what the frame timed when it was last recorded
+    context->get_profiler()->begin_frame(command_buffer, frame_index);
+
+    // Record offscreen pass
+    context->get_offscreen_pass()->record(command_buffer, frame_index);
+
+    // End command buffer
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to end command buffer");
+    }
+
+    // Uploads recorded since the last frame are submitted ahead of it
+    context->get_upload_manager()->flush();
+
+    // Submit command buffer, nothing waits on it but the fence
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &command_buffer,
+    };
+
+    if (vkQueueSubmit(
+            context->get_graphics_queue(), 1, &submit_info,
+            in_flight_fences[frame_index]) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit draw command buffer");
+    }
+
+    // Update frame index
+    frame_index = (frame_index + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void Vol::Rendering::HeadlessPass::create_sync_objects()
+{
+    in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
+
+    // Fences start signaled, as no frame is in flight yet
+    VkFenceCreateInfo fence_create_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+    };
+
+    for (VkFence &fence : in_flight_fences) {
+        if (vkCreateFence(
+                context->get_device(), &fence_create_info, nullptr, &fence) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create fence");
+        }
+    }
+}
+
+void Vol::Rendering::HeadlessPass::allocate_command_buffers()
+{
+    command_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+    // Define command buffer allocation information
+    VkCommandBufferAllocateInfo allocation_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = context->get_command_pool(),
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
+    };
+
+    // Allocate command buffer
+    if (vkAllocateCommandBuffers(
+            context->get_device(), &allocation_info, command_buffers.data()) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffer");
+    }
+}
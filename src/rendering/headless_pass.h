@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace Vol::Rendering
+{
+class VulkanContext;
+}
+
+namespace Vol::Rendering
+{
+// Drives the offscreen pass in place of the main pass when there is no swap
+// chain to present to, every frame in flight with a command buffer and fence
+// of its own
+class HeadlessPass {
+  public:
+    explicit HeadlessPass(VulkanContext *context);
+    ~HeadlessPass();
+
+    void render();
+
+    inline uint32_t get_frame_index() const { return frame_index; }
+
+  private:
+    void create_sync_objects();
+    void allocate_command_buffers();
+
+  private:
+    VulkanContext *context;
+    std::vector<VkCommandBuffer> command_buffers;
+    std::vector<VkFence> in_flight_fences;
+    uint32_t frame_index = 0;
+};
+}  // namespace Vol::Rendering
\ No newline at end of file
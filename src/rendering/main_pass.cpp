@@ -1,6 +1,9 @@
 #include "main_pass.h"
 
+#include "rendering/deletion_queue.h"
+#include "rendering/gpu_profiler.h"
 #include "rendering/offscreen_pass.h"
+#include "rendering/upload_manager.h"
 #include "rendering/util.h"
 #include "rendering/vulkan_context.h"
 
@@ -19,7 +22,8 @@ VkSurfaceFormatKHR select_swap_surface_format(
     const std::vector<VkSurfaceFormatKHR> &available_formats);
 
 VkPresentModeKHR select_swap_present_mode(
-    const std::vector<VkPresentModeKHR> &available_present_modes);
+    const std::vector<VkPresentModeKHR> &available_present_modes,
+    bool vsync);
 
 VkExtent2D select_swap_extent(
     SDL_Window *window,
@@ -71,6 +75,9 @@ void Vol::Rendering::MainPass::render()
     // Image successfully accquired, reset fence and begin frame
     vkResetFences(context->get_device(), 1, &in_flight_fences[frame_index]);
 
+    // Destroy what only frames that have completed by now still used
+    context->get_deletion_queue()->begin_frame();
+
     // Reset command buffer
     VkCommandBuffer command_buffer = command_buffers[frame_index];
     vkResetCommandBuffer(command_buffer, 0);
@@ -87,6 +94,9 @@ void Vol::Rendering::MainPass::render()
         throw std::runtime_error("Failed to begin command buffer");
     }
 
+    // Read back what the frame timed when it was last recorded
+    context->get_profiler()->begin_frame(command_buffer, frame_index);
+
     // Record offscreen pass
     context->get_offscreen_pass()->record(command_buffer, frame_index);
     // Record main pass
@@ -97,6 +107,9 @@ void Vol::Rendering::MainPass::render()
         throw std::runtime_error("Failed to end command buffer");
     }
 
+    // Uploads recorded since the last frame are submitted ahead of it
+    context->get_upload_manager()->flush();
+
     // Submit command buffer
     VkPipelineStageFlags wait_stages[] = {
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -148,6 +161,13 @@ void Vol::Rendering::MainPass::framebuffer_size_changed()
     framebuffer_size_dirty = true;
 }
 
+void Vol::Rendering::MainPass::vsync_changed(bool enabled)
+{
+    // The present mode is chosen with the swap chain
+    vsync = enabled;
+    framebuffer_size_dirty = true;
+}
+
 void Vol::Rendering::MainPass::create_swap_chain()
 {
     SwapChainSupportDetails swap_chain_support = get_swap_chain_support(
@@ -157,7 +177,7 @@ void Vol::Rendering::MainPass::create_swap_chain()
     VkSurfaceFormatKHR surface_format =
         select_swap_surface_format(swap_chain_support.formats);
     VkPresentModeKHR present_mode =
-        select_swap_present_mode(swap_chain_support.present_modes);
+        select_swap_present_mode(swap_chain_support.present_modes, vsync);
     VkExtent2D extent = select_swap_extent(
         context->get_window(), swap_chain_support.capabilities);
 
@@ -415,6 +435,9 @@ void Vol::Rendering::MainPass::destroy_swap_chain()
 
 void Vol::Rendering::MainPass::record(VkCommandBuffer command_buffer)
 {
+    GpuProfiler *profiler = context->get_profiler();
+    profiler->begin_scope(command_buffer, GpuScope::Interface);
+
     // Define render pass begin info
     VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
 
@@ -455,6 +478,8 @@ void Vol::Rendering::MainPass::record(VkCommandBuffer command_buffer)
 
     // End render pass
     vkCmdEndRenderPass(command_buffer);
+
+    profiler->end_scope(command_buffer, GpuScope::Interface);
 }
 
 VkSurfaceFormatKHR select_swap_surface_format(
@@ -470,10 +495,22 @@ VkSurfaceFormatKHR select_swap_surface_format(
 }
 
 VkPresentModeKHR select_swap_present_mode(
-    const std::vector<VkPresentModeKHR> &available_present_modes)
+    const std::vector<VkPresentModeKHR> &available_present_modes,
+    bool vsync)
 {
+    // Without vsync prefer tearing over waiting, FIFO is always available
+    if (!vsync) {
+        for (VkPresentModeKHR present_mode :
+             {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR}) {
+            if (std::find(
+                    available_present_modes.begin(),
+                    available_present_modes.end(),
+                    present_mode) != available_present_modes.end()) {
+                return present_mode;
+            }
+        }
+    }
     return VK_PRESENT_MODE_FIFO_KHR;
-    // return VK_PRESENT_MODE_MAILBOX_KHR;
 }
 
 VkExtent2D select_swap_extent(
@@ -30,6 +30,9 @@ class MainPass {
 
     void framebuffer_size_changed();
 
+    // Without vsync frames are presented as soon as they are rendered
+    void vsync_changed(bool enabled);
+
     inline const SwapChain &get_swap_chain() const { return swap_chain; }
     inline VkRenderPass get_render_pass() const { return render_pass; }
     inline uint32_t get_frame_index() const { return frame_index; }
@@ -59,5 +62,6 @@ class MainPass {
     uint32_t frame_index = 0;
     uint32_t image_index = 0;
     bool framebuffer_size_dirty = false;
+    bool vsync = true;
 };
 }  // namespace Vol::Rendering
\ No newline at end of file
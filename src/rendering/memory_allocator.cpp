@@ -0,0 +1,388 @@
+#include "memory_allocator.h"
+
+#include "rendering/util.h"
+#include "rendering/vulkan_context.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+// A single allocation of the device that resources are bound within. Free
+// ranges are kept by offset to coalesce them with their neighbours, and by
+// size to find the best fit.
+struct Vol::Rendering::MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint32_t type_index = 0;
+    bool linear = false;
+    void *mapped = nullptr;
+    VkDeviceSize used = 0;
+    std::map<VkDeviceSize, VkDeviceSize> free_by_offset;
+    std::multimap<VkDeviceSize, VkDeviceSize> free_by_size;
+};
+
+std::optional<VkDeviceSize> take_range(
+    Vol::Rendering::MemoryBlock &block,
+    VkDeviceSize size,
+    VkDeviceSize alignment);
+
+void insert_range(
+    Vol::Rendering::MemoryBlock &block,
+    VkDeviceSize offset,
+    VkDeviceSize size);
+
+void erase_range(
+    Vol::Rendering::MemoryBlock &block,
+    VkDeviceSize offset,
+    VkDeviceSize size);
+
+const char *Vol::Rendering::get_memory_category_name(MemoryCategory category)
+{
+    switch (category) {
+        case MemoryCategory::Volume: return "Volumes";
+        case MemoryCategory::Attachment: return "Attachments";
+        case MemoryCategory::Table: return "Tables";
+        case MemoryCategory::Buffer: return "Buffers";
+        case MemoryCategory::Staging: return "Staging";
+    }
+    return "";
+}
+
+Vol::Rendering::MemoryAllocator::MemoryAllocator(VulkanContext *context)
+    : context(context)
+{
+    vkGetPhysicalDeviceMemoryProperties(
+        context->get_physical_device(), &memory_properties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->get_physical_device(), &properties);
+    max_allocation_count = properties.limits.maxMemoryAllocationCount;
+}
+
+Vol::Rendering::MemoryAllocator::~MemoryAllocator()
+{
+    for (const std::unique_ptr<MemoryBlock> &block : blocks) {
+        vkFreeMemory(context->get_device(), block->memory, nullptr);
+    }
+}
+
+Vol::Rendering::MemoryAllocation
+Vol::Rendering::MemoryAllocator::allocate_buffer(
+    VkBuffer buffer,
+    VkMemoryPropertyFlags properties,
+    MemoryCategory category)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(
+        context->get_device(), buffer, &requirements);
+
+    MemoryAllocation allocation =
+        allocate(requirements, properties, true, category);
+    if (vkBindBufferMemory(
+            context->get_device(), buffer, allocation.memory,
+            allocation.offset) != VK_SUCCESS) {
+        free(allocation);
+        throw std::runtime_error("Failed to bind buffer memory");
+    }
+    return allocation;
+}
+
+Vol::Rendering::MemoryAllocation
+Vol::Rendering::MemoryAllocator::allocate_image(
+    VkImage image,
+    VkImageTiling tiling,
+    VkMemoryPropertyFlags properties,
+    MemoryCategory category)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(context->get_device(), image, &requirements);
+
+    MemoryAllocation allocation = allocate(
+        requirements, properties, tiling == VK_IMAGE_TILING_LINEAR, category);
+    if (vkBindImageMemory(
+            context->get_device(), image, allocation.memory,
+            allocation.offset) != VK_SUCCESS) {
+        free(allocation);
+        throw std::runtime_error("Failed to bind image memory");
+    }
+    return allocation;
+}
+
+void Vol::Rendering::MemoryAllocator::free(MemoryAllocation &allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t category = static_cast<size_t>(allocation.category);
+    category_counts[category]--;
+    category_bytes[category] -= allocation.size;
+
+    // Dedicated allocations are unmapped along with being freed
+    MemoryBlock *block = allocation.block;
+    if (!block) {
+        vkFreeMemory(context->get_device(), allocation.memory, nullptr);
+        dedicated_count--;
+        dedicated_bytes -= allocation.size;
+        allocation = MemoryAllocation{};
+        return;
+    }
+
+    insert_range(*block, allocation.offset, allocation.size);
+    block->used -= allocation.size;
+    allocation = MemoryAllocation{};
+
+    if (block->used != 0) {
+        return;
+    }
+
+    // Blocks nothing is bound to any more are given back to the device, but
+    // for one kept per memory type and tiling, so replacing a resource doesn't
+    // free a block only to allocate it again right after
+    bool spare = std::any_of(
+        blocks.begin(), blocks.end(),
+        [&](const std::unique_ptr<MemoryBlock> &other) {
+            return other.get() != block && other->used == 0 &&
+                   other->type_index == block->type_index &&
+                   other->linear == block->linear;
+        });
+    if (spare) {
+        vkFreeMemory(context->get_device(), block->memory, nullptr);
+        std::erase_if(blocks, [&](const std::unique_ptr<MemoryBlock> &other) {
+            return other.get() == block;
+        });
+    }
+}
+
+Vol::Rendering::MemoryStats Vol::Rendering::MemoryAllocator::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    MemoryStats stats{
+        .block_count = blocks.size(),
+        .dedicated_count = dedicated_count,
+        .dedicated_bytes = dedicated_bytes,
+        .category_counts = category_counts,
+        .category_bytes = category_bytes,
+        .allocation_count =
+            static_cast<uint32_t>(blocks.size() + dedicated_count),
+        .max_allocation_count = max_allocation_count,
+    };
+
+    VkDeviceSize free_bytes = 0, unusable_bytes = 0;
+    for (const std::unique_ptr<MemoryBlock> &block : blocks) {
+        VkDeviceSize free = memory_block_size - block->used;
+        VkDeviceSize largest =
+            block->free_by_size.empty() ? 0
+                                        : block->free_by_size.rbegin()->first;
+        stats.block_bytes += memory_block_size;
+        stats.used_bytes += block->used;
+        free_bytes += free;
+        unusable_bytes += free - largest;
+    }
+    if (free_bytes > 0) {
+        stats.fragmentation = static_cast<float>(unusable_bytes) /
+                              static_cast<float>(free_bytes);
+    }
+
+    return stats;
+}
+
+Vol::Rendering::MemoryAllocation Vol::Rendering::MemoryAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    VkMemoryPropertyFlags properties,
+    bool linear,
+    MemoryCategory category)
+{
+    uint32_t type_index = find_memory_type(
+        context->get_physical_device(), requirements.memoryTypeBits,
+        properties);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (requirements.size > memory_block_size / 2) {
+        MemoryAllocation allocation =
+            allocate_dedicated(requirements.size, type_index, category);
+        category_counts[static_cast<size_t>(category)]++;
+        category_bytes[static_cast<size_t>(category)] += requirements.size;
+        return allocation;
+    }
+
+    // Take the best fit of the first block of the type and tiling with room,
+    // or of a new block
+    std::optional<VkDeviceSize> offset;
+    MemoryBlock *block = nullptr;
+    for (const std::unique_ptr<MemoryBlock> &candidate : blocks) {
+        if (candidate->type_index != type_index ||
+            candidate->linear != linear) {
+            continue;
+        }
+        offset = take_range(
+            *candidate, requirements.size, requirements.alignment);
+        if (offset) {
+            block = candidate.get();
+            break;
+        }
+    }
+    if (!block) {
+        block = create_block(type_index, linear);
+        offset = take_range(*block, requirements.size, requirements.alignment);
+    }
+    block->used += requirements.size;
+    category_counts[static_cast<size_t>(category)]++;
+    category_bytes[static_cast<size_t>(category)] += requirements.size;
+
+    return MemoryAllocation{
+        .memory = block->memory,
+        .offset = *offset,
+        .size = requirements.size,
+        .mapped = block->mapped
+                      ? static_cast<std::byte *>(block->mapped) + *offset
+                      : nullptr,
+        .category = category,
+        .block = block,
+    };
+}
+
+Vol::Rendering::MemoryAllocation
+Vol::Rendering::MemoryAllocator::allocate_dedicated(
+    VkDeviceSize size,
+    uint32_t type_index,
+    MemoryCategory category)
+{
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = type_index,
+    };
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(
+            context->get_device(), &alloc_info, nullptr, &memory) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate memory");
+    }
+    dedicated_count++;
+    dedicated_bytes += size;
+
+    return MemoryAllocation{
+        .memory = memory,
+        .offset = 0,
+        .size = size,
+        .mapped = map(memory, type_index),
+        .category = category,
+    };
+}
+
+Vol::Rendering::MemoryBlock *Vol::Rendering::MemoryAllocator::create_block(
+    uint32_t type_index,
+    bool linear)
+{
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memory_block_size,
+        .memoryTypeIndex = type_index,
+    };
+
+    auto block = std::make_unique<MemoryBlock>();
+    if (vkAllocateMemory(
+            context->get_device(), &alloc_info, nullptr, &block->memory) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate memory");
+    }
+    block->type_index = type_index;
+    block->linear = linear;
+    block->mapped = map(block->memory, type_index);
+    insert_range(*block, 0, memory_block_size);
+
+    blocks.push_back(std::move(block));
+    return blocks.back().get();
+}
+
+void *Vol::Rendering::MemoryAllocator::map(
+    VkDeviceMemory memory,
+    uint32_t type_index)
+{
+    if (!(memory_properties.memoryTypes[type_index].propertyFlags &
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        return nullptr;
+    }
+
+    void *mapped;
+    if (vkMapMemory(
+            context->get_device(), memory, 0, VK_WHOLE_SIZE, 0, &mapped) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to map memory");
+    }
+    return mapped;
+}
+
+std::optional<VkDeviceSize> take_range(
+    Vol::Rendering::MemoryBlock &block,
+    VkDeviceSize size,
+    VkDeviceSize alignment)
+{
+    // Ranges are tried smallest first, aligning may leave one too small
+    for (auto it = block.free_by_size.lower_bound(size);
+         it != block.free_by_size.end(); it++) {
+        auto [range_size, range_offset] = *it;
+        VkDeviceSize offset =
+            (range_offset + alignment - 1) / alignment * alignment;
+        if (offset + size > range_offset + range_size) {
+            continue;
+        }
+
+        // What is left on either side stays free
+        erase_range(block, range_offset, range_size);
+        if (offset > range_offset) {
+            insert_range(block, range_offset, offset - range_offset);
+        }
+        if (offset + size < range_offset + range_size) {
+            insert_range(
+                block, offset + size,
+                range_offset + range_size - offset - size);
+        }
+        return offset;
+    }
+    return std::nullopt;
+}
+
+void insert_range(
+    Vol::Rendering::MemoryBlock &block,
+    VkDeviceSize offset,
+    VkDeviceSize size)
+{
+    // Merge with the free ranges right before and after
+    auto next = block.free_by_offset.lower_bound(offset);
+    if (next != block.free_by_offset.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            erase_range(block, previous->first, previous->second);
+        }
+    }
+    next = block.free_by_offset.lower_bound(offset);
+    if (next != block.free_by_offset.end() && offset + size == next->first) {
+        size += next->second;
+        erase_range(block, next->first, next->second);
+    }
+
+    block.free_by_offset.emplace(offset, size);
+    block.free_by_size.emplace(size, offset);
+}
+
+void erase_range(
+    Vol::Rendering::MemoryBlock &block,
+    VkDeviceSize offset,
+    VkDeviceSize size)
+{
+    block.free_by_offset.erase(offset);
+    auto [begin, end] = block.free_by_size.equal_range(size);
+    for (auto it = begin; it != end; it++) {
+        if (it->second == offset) {
+            block.free_by_size.erase(it);
+            return;
+        }
+    }
+}
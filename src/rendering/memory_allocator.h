@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Vol::Rendering
+{
+class VulkanContext;
+struct MemoryBlock;
+}  // namespace Vol::Rendering
+
+namespace Vol::Rendering
+{
+// What memory is bound to, which stats are kept per
+enum class MemoryCategory {
+    Volume,
+    Attachment,
+    Table,
+    Buffer,
+    Staging,
+};
+const size_t memory_category_count = 5;
+
+const char *get_memory_category_name(MemoryCategory category);
+
+// Size of the blocks resources are sub-allocated from, resources larger
+// than half of it get an allocation of their own
+const VkDeviceSize memory_block_size = 64ull << 20;
+
+// Range of device memory a resource is bound to. Host visible memory is
+// mapped for as long as it is allocated.
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+    MemoryCategory category = MemoryCategory::Buffer;
+    MemoryBlock *block = nullptr;
+};
+
+struct MemoryStats {
+    // Memory of the device allocated in blocks and bound within them
+    size_t block_count = 0;
+    VkDeviceSize block_bytes = 0;
+    VkDeviceSize used_bytes = 0;
+
+    // Share of the free memory in blocks outside of the largest free range
+    // of its block, which no resource larger than that range can use
+    float fragmentation = 0.0f;
+
+    // Resources with an allocation of their own
+    size_t dedicated_count = 0;
+    VkDeviceSize dedicated_bytes = 0;
+
+    std::array<size_t, memory_category_count> category_counts{};
+    std::array<VkDeviceSize, memory_category_count> category_bytes{};
+
+    // Allocations made of the device, and the most it allows
+    uint32_t allocation_count = 0;
+    uint32_t max_allocation_count = 0;
+};
+
+// Sub-allocates buffers and images from large blocks per memory type, best
+// fit from free ranges that coalesce with their neighbours once freed.
+// Linear and optimally tiled resources never share a block, so neither has
+// to keep to the buffer image granularity. Emptied blocks are freed, except
+// for one kept per memory type and tiling. Resources may be allocated and
+// freed from any thread.
+class MemoryAllocator {
+  public:
+    explicit MemoryAllocator(VulkanContext *context);
+    ~MemoryAllocator();
+
+    // Allocates memory with the properties and binds the resource to it
+    MemoryAllocation allocate_buffer(
+        VkBuffer buffer,
+        VkMemoryPropertyFlags properties,
+        MemoryCategory category);
+    MemoryAllocation allocate_image(
+        VkImage image,
+        VkImageTiling tiling,
+        VkMemoryPropertyFlags properties,
+        MemoryCategory category);
+
+    // Returns the allocation's range to its block, resetting it
+    void free(MemoryAllocation &allocation);
+
+    MemoryStats get_stats() const;
+
+  private:
+    MemoryAllocation allocate(
+        const VkMemoryRequirements &requirements,
+        VkMemoryPropertyFlags properties,
+        bool linear,
+        MemoryCategory category);
+    MemoryAllocation allocate_dedicated(
+        VkDeviceSize size,
+        uint32_t type_index,
+        MemoryCategory category);
+    MemoryBlock *create_block(uint32_t type_index, bool linear);
+    void *map(VkDeviceMemory memory, uint32_t type_index);
+
+  private:
+    VulkanContext *context;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    uint32_t max_allocation_count;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+    size_t dedicated_count = 0;
+    VkDeviceSize dedicated_bytes = 0;
+    std::array<size_t, memory_category_count> category_counts{};
+    std::array<VkDeviceSize, memory_category_count> category_bytes{};
+};
+}  // namespace Vol::Rendering
\ No newline at end of file
@@ -4,7 +4,13 @@
 
 #include "application.h"
 #include "data/dataset.h"
-#include "rendering/main_pass.h"
+#include "data/histogram.h"
+#include "data/range_grid.h"
+#include "rendering/deletion_queue.h"
+#include "rendering/gpu_profiler.h"
+#include "rendering/page_streamer.h"
+#include "rendering/preintegration.h"
+#include "rendering/upload_manager.h"
 #include "rendering/util.h"
 #include "rendering/vulkan_context.h"
 #include "scene/scene.h"
@@ -13,12 +19,53 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <numeric>
 #include <stdexcept>
+#include <utility>
 
 #define RES(path) RES_PATH path
 
+// Coarser levels of detail are sampled while the camera moves, until it has
+// rested for this long
+const std::chrono::milliseconds motion_settle_time(250);
+
+// Rays take this many times fewer samples while the camera moves
+const float motion_sampling_divisor = 2.0f;
+
+// Smallest scale frames are rendered at while the camera moves
+const float min_render_scale = 0.25f;
+
+// The render scale is left as is while frames take between these fractions
+// of the target time, and is set to meet the middle of them otherwise
+const float frame_time_lower_bound = 0.7f;
+const float frame_time_upper_bound = 1.0f;
+
+// Weight of a frame's time in the running average of their cost
+const float frame_cost_smoothing = 0.25f;
+
+// Jittered frames averaged into the history once the camera rests
+const uint32_t refinement_samples = 16;
+
+// Share of device local memory a volume's image may take up. Volumes that
+// don't fit are paged, with an atlas taking up half as much again.
+const VkDeviceSize volume_memory_divisor = 2;
+const VkDeviceSize atlas_memory_divisor = 4;
+
+// Bytes of pages streamed into the atlas of a paged volume every frame
+const VkDeviceSize page_stream_budget = 32 * 1024 * 1024;
+
+// Bytes of a volume every chunk of its upload copies, and chunks submitted
+// to the transfer queue at once. Without a transfer family the chunks share
+// the graphics queue, so frames get their turn in between.
+const VkDeviceSize volume_transfer_chunk_size = 32 * 1024 * 1024;
+const size_t volume_transfer_chunks_in_flight = 2;
+
 struct Vertex {
     glm::vec3 position;
     glm::vec3 tex_coord;
@@ -89,11 +136,6 @@ const std::vector<uint16_t> indices = {
     0,  1,  2,  0,  2,  3,  4,  5,  6,  4,  6,  7,  8,  9,  10, 8,  10, 11,
     12, 13, 14, 12, 14, 15, 16, 17, 18, 16, 18, 19, 20, 21, 22, 20, 22, 23};
 
-uint32_t get_memory_type_index(
-    Vol::Rendering::VulkanContext *context,
-    uint32_t type_bits,
-    VkMemoryPropertyFlags properties);
-
 VkBool32 get_supported_depth_format(
     VkPhysicalDevice physical_device,
     VkFormat *depth_format);
@@ -104,50 +146,89 @@ VkShaderModule create_shader_module(
     VkDevice device,
     const std::vector<char> &code);
 
-uint32_t find_memory_type(
-    VkPhysicalDevice physical_device,
-    uint32_t type_filter,
-    VkMemoryPropertyFlags properties);
+VkFormat get_volume_format(Vol::Data::VoxelType type);
+
+bool is_format_filterable(VkPhysicalDevice physical_device, VkFormat format);
+
+float normalize_density(VkFormat format, float value);
+
+size_t get_texel_size(VkFormat format);
+
+// Element of the Halton sequence of a base, within [0, 1)
+float get_halton(uint32_t index, uint32_t base);
+
+VkDeviceSize get_device_local_memory(VkPhysicalDevice physical_device);
 
 Vol::Rendering::OffscreenPass::OffscreenPass(
     VulkanContext *context,
     uint32_t width,
     uint32_t height)
-    : context(context), width(width), height(height)
+    : context(context),
+      width(width),
+      height(height),
+      image_width(width),
+      image_height(height)
 {
-    Vol::Data::Dataset temp_volume{{1, 1, 1}, 0.0f, 1.0f, {0.0f}};
+    Vol::Data::Dataset temp_volume{
+        {1, 1, 1},
+        Vol::Data::VoxelType::Float32,
+        0.0f,
+        1.0f,
+        std::vector<std::byte>(sizeof(float)),
+    };
     std::vector<glm::uint32_t> temp_transfer{0xFFFFFFFF};
 
     create_color_attachment();
     create_depth_attachment();
+    create_history_attachment();
     create_render_pass();
+    create_history_render_pass();
     create_framebuffer();
+    create_history_framebuffer();
     create_descriptor_set_layout();
+    create_history_descriptor_set_layout();
     create_pipeline();
+    create_history_pipeline();
     create_vertex_buffer();
     create_index_buffer();
     create_uniform_buffers();
-    create_volume(temp_volume);
+    create_empty_buffer();
+    create_macrocell_sampler();
+    volume_dataset_changed(temp_volume);
     create_transfer(temp_transfer);
     create_descriptor_pool();
     create_descriptor_sets();
+    create_history_descriptor_sets();
+    capture_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+    timed_scales.resize(MAX_FRAMES_IN_FLIGHT, 0.0f);
 }
 
 Vol::Rendering::OffscreenPass::~OffscreenPass()
 {
     vkDestroyBuffer(context->get_device(), vertex_buffer, nullptr);
-    vkFreeMemory(context->get_device(), vertex_buffer_memory, nullptr);
+    context->get_memory_allocator()->free(vertex_buffer_memory);
 
     vkDestroyBuffer(context->get_device(), index_buffer, nullptr);
-    vkFreeMemory(context->get_device(), index_buffer_memory, nullptr);
+    context->get_memory_allocator()->free(index_buffer_memory);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroyBuffer(context->get_device(), uniform_buffers[i], nullptr);
-        vkFreeMemory(context->get_device(), uniform_buffers_memory[i], nullptr);
+        context->get_memory_allocator()->free(uniform_buffers_memory[i]);
+    }
+
+    vkDestroyBuffer(context->get_device(), empty_buffer, nullptr);
+    context->get_memory_allocator()->free(empty_buffer_memory);
+
+    for (CaptureBuffer &capture_buffer : capture_buffers) {
+        vkDestroyBuffer(context->get_device(), capture_buffer.buffer, nullptr);
+        context->get_memory_allocator()->free(capture_buffer.memory);
     }
 
-    destroy_volume();
-    destroy_transfer();
+    finish_volume_upload(true);
+    retire_volume(volume);
+    retire_transfer();
+    vkDestroySampler(context->get_device(), macrocell_sampler, nullptr);
 
     vkDestroyDescriptorPool(context->get_device(), descriptor_pool, nullptr);
     vkDestroyDescriptorSetLayout(
@@ -156,19 +237,83 @@ Vol::Rendering::OffscreenPass::~OffscreenPass()
     vkDestroyPipelineLayout(context->get_device(), pipeline_layout, nullptr);
     vkDestroyPipeline(context->get_device(), graphics_pipeline, nullptr);
 
-    destroy_image();
+    vkDestroyDescriptorPool(
+        context->get_device(), history_descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(
+        context->get_device(), history_descriptor_set_layout, nullptr);
+    vkDestroyPipelineLayout(
+        context->get_device(), history_pipeline_layout, nullptr);
+    vkDestroyPipeline(context->get_device(), history_pipeline, nullptr);
+
+    retire_image();
+
+    // The device is idle, so what was retired can go before the render passes
+    context->get_deletion_queue()->flush();
     vkDestroyRenderPass(context->get_device(), render_pass, nullptr);
+    vkDestroyRenderPass(context->get_device(), history_render_pass, nullptr);
 }
 
 void Vol::Rendering::OffscreenPass::record(
     VkCommandBuffer command_buffer,
     uint32_t frame_index)
 {
-    update_uniform_buffer(context->get_main_pass()->get_frame_index());
+    // Swap in a finished upload
+    finish_volume_upload(false);
+
+    // The fence of this frame has been waited on, so its sets can be
+    // rewritten
+    if (descriptor_sets_dirty[frame_index]) {
+        update_descriptor_set(frame_index);
+        update_history_descriptor_set(frame_index);
+    }
+
+    // Its time was read back too, as was the image it captured
+    update_render_scale(frame_index);
+    read_capture(frame_index);
+
+    update_uniform_buffer(frame_index);
+
+    // Pages are copied into the atlas before the frame samples it
+    bool pages_streamed =
+        volume.paging && stream_pages(command_buffer, frame_index);
+    streaming = pages_streamed ||
+                (volume.paging && volume.paging->streamer->is_reading());
+
+    // Anything that goes into the image starts its history over, otherwise
+    // the image is kept once the history has converged. Streamed pages only
+    // sharpen it, but are worth starting over for. Without adaptive quality
+    // every frame is rendered on its own.
+    bool changed =
+        !adaptive_quality || redraw || pages_streamed || rendered_ubo != ubo;
+    if (changed) {
+        accumulated_samples = 0;
+    }
+    auto now = std::chrono::steady_clock::now();
+    bool moving =
+        adaptive_quality && now - last_camera_motion < motion_settle_time;
+    if (!changed && (moving || accumulated_samples >= refinement_samples)) {
+        record_capture(command_buffer, frame_index);
+        return;
+    }
+    redraw = false;
+    rendered_ubo = ubo;
+    float scale = moving ? render_scale : 1.0f;
+
+    GpuProfiler *profiler = context->get_profiler();
+    profiler->begin_scope(command_buffer, GpuScope::Raymarch);
+
+    // Frames only cover a corner of the attachments
+    VkExtent2D extent = {
+        std::max(static_cast<uint32_t>(width * scale), 1u),
+        std::max(static_cast<uint32_t>(height * scale), 1u),
+    };
 
     // Define clear colors
     std::array<VkClearValue, 2> clear_values = {
-        VkClearValue{.color = {0.11f, 0.11f, 0.11f, 1.0f}},
+        VkClearValue{
+            .color =
+                {background_color.x, background_color.y, background_color.z,
+                 background_color.w}},
         VkClearValue{.depthStencil = {1.0f, 0}},
     };
 
@@ -177,8 +322,7 @@ void Vol::Rendering::OffscreenPass::record(
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
         .renderPass = render_pass,
         .framebuffer = framebuffer,
-        .renderArea =
-            VkRect2D{.extent = VkExtent2D{.width = width, .height = height}},
+        .renderArea = VkRect2D{.extent = extent},
         .clearValueCount = static_cast<uint32_t>(clear_values.size()),
         .pClearValues = clear_values.data(),
     };
@@ -190,8 +334,8 @@ void Vol::Rendering::OffscreenPass::record(
     VkViewport viewport = {
         .x = 0,
         .y = 0,
-        .width = static_cast<float>(width),
-        .height = static_cast<float>(height),
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
         .minDepth = 0.0f,
         .maxDepth = 1.0f,
     };
@@ -200,7 +344,7 @@ void Vol::Rendering::OffscreenPass::record(
     // Set scissor
     VkRect2D scissor = {
         .offset = VkOffset2D{0, 0},
-        .extent = VkExtent2D{width, height},
+        .extent = extent,
     };
     vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
@@ -221,51 +365,136 @@ void Vol::Rendering::OffscreenPass::record(
         command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1,
         &descriptor_sets[frame_index], 0, nullptr);
 
+    // Every refining frame but the first samples elsewhere within its pixels
+    glm::vec2 jitter(0.0f);
+    if (scale == 1.0f && accumulated_samples > 0) {
+        glm::vec2 offset(
+            get_halton(accumulated_samples, 2),
+            get_halton(accumulated_samples, 3));
+        jitter =
+            (offset * 2.0f - 1.0f) / glm::vec2(extent.width, extent.height);
+    }
+    vkCmdPushConstants(
+        command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+        sizeof(jitter), &jitter);
+
     // Draw
     vkCmdDrawIndexed(
         command_buffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
 
     // End render pass
     vkCmdEndRenderPass(command_buffer);
+
+    // Only the frames whose scale is controlled set it
+    profiler->end_scope(command_buffer, GpuScope::Raymarch);
+    if (moving) {
+        timed_scales[frame_index] = scale;
+    }
+
+    // Make the pages the frame sampled visible to the host once it completes
+    if (volume.paging) {
+        VkMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        };
+        vkCmdPipelineBarrier(
+            command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0,
+            nullptr);
+    }
+
+    // Blend the frame into the history, scaling it up to the full image. The
+    // history is replaced by frames while the camera moves, and is the average
+    // of the refining frames after.
+    VkRenderPassBeginInfo history_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = history_render_pass,
+        .framebuffer = history_framebuffer,
+        .renderArea =
+            VkRect2D{.extent = VkExtent2D{.width = width, .height = height}},
+    };
+
+    vkCmdBeginRenderPass(
+        command_buffer, &history_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+    viewport.width = static_cast<float>(width);
+    viewport.height = static_cast<float>(height);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    scissor.extent = VkExtent2D{width, height};
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+    vkCmdBindPipeline(
+        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, history_pipeline);
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        history_pipeline_layout, 0, 1, &history_descriptor_sets[frame_index],
+        0, nullptr);
+
+    float weight = 1.0f / (accumulated_samples + 1);
+    float blend_constants[4] = {weight, weight, weight, weight};
+    vkCmdSetBlendConstants(command_buffer, blend_constants);
+
+    glm::vec2 region(
+        static_cast<float>(extent.width) / image_width,
+        static_cast<float>(extent.height) / image_height);
+    vkCmdPushConstants(
+        command_buffer, history_pipeline_layout,
+        VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(region), &region);
+
+    vkCmdDraw(command_buffer, 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(command_buffer);
+
+    // Frames at a lower resolution don't count towards the history
+    accumulated_samples = scale == 1.0f ? accumulated_samples + 1 : 0;
+
+    record_capture(command_buffer, frame_index);
 }
 
-void Vol::Rendering::OffscreenPass::framebuffer_size_changed(
+bool Vol::Rendering::OffscreenPass::framebuffer_size_changed(
     uint32_t width,
     uint32_t height)
 {
     // Ignore if size is zero
     if (width == 0 || height == 0) {
-        return;
+        return false;
     }
 
-    // Wait till device is available
-    context->wait_till_idle();
-
     // Update size
     this->width = width;
     this->height = height;
+    redraw = true;
+
+    // Sizes the attachments already fit render into a corner of them
+    if (width <= image_width && height <= image_height) {
+        return false;
+    }
+    image_width = std::max(width, image_width);
+    image_height = std::max(height, image_height);
 
-    // Destroy old image information
-    destroy_image();
+    // Frames in flight keep rendering into the old attachments
+    retire_image();
 
-    // Create new image information
+    // Create new image information, bound to each frame's sets once the
+    // frame is next recorded
     create_color_attachment();
     create_depth_attachment();
+    create_history_attachment();
     create_framebuffer();
+    create_history_framebuffer();
+    update_descriptor_sets();
+
+    return true;
 }
 
 void Vol::Rendering::OffscreenPass::volume_dataset_changed(
-    Vol::Data::Dataset &dataset)
+    const Vol::Data::Dataset &dataset)
 {
-    context->wait_till_idle();
-
-    destroy_volume();
-    create_volume(dataset);
-
-    this->ubo.min_density = dataset.min;
-    this->ubo.max_density = dataset.max;
-
-    update_descriptor_sets();
+    submit_volume(
+        stage_volume(std::make_shared<const Vol::Data::Dataset>(dataset)));
+    finish_volume_upload(true);
 }
 
 void Vol::Rendering::OffscreenPass::slicing_changed(
@@ -276,17 +505,379 @@ void Vol::Rendering::OffscreenPass::slicing_changed(
     this->ubo.max_slice = max;
 }
 
-void Vol::Rendering::OffscreenPass::transfer_function_changed(
-    const std::vector<glm::uint32_t> &data)
+void Vol::Rendering::OffscreenPass::ray_termination_changed(
+    float min_transmittance)
+{
+    this->ubo.min_transmittance = min_transmittance;
+}
+
+void Vol::Rendering::OffscreenPass::sampling_rate_changed(
+    float samples_per_voxel)
 {
+    this->samples_per_voxel = samples_per_voxel;
+}
+
+void Vol::Rendering::OffscreenPass::frame_time_target_changed(
+    float milliseconds)
+{
+    frame_time_target = milliseconds;
+}
+
+void Vol::Rendering::OffscreenPass::adaptive_quality_changed(bool enabled)
+{
+    adaptive_quality = enabled;
+    redraw = true;
+}
+
+std::vector<uint8_t> Vol::Rendering::OffscreenPass::read_image()
+{
+    // The last frame has completed once the device is idle
     context->wait_till_idle();
 
-    destroy_transfer();
+    VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+    VkBuffer buffer;
+    MemoryAllocation buffer_memory;
+    create_buffer(
+        size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        MemoryCategory::Staging, buffer, buffer_memory);
+
+    VkCommandBuffer command_buffer = context->begin_single_command();
+    record_image_copy(command_buffer, buffer);
+    context->end_single_command(command_buffer);
+
+    std::vector<uint8_t> pixels(size);
+    memcpy(pixels.data(), buffer_memory.mapped, size);
+
+    vkDestroyBuffer(context->get_device(), buffer, nullptr);
+    context->get_memory_allocator()->free(buffer_memory);
+
+    return pixels;
+}
+
+void Vol::Rendering::OffscreenPass::capture_next_frame(uint64_t id)
+{
+    next_capture = id;
+}
+
+std::vector<Vol::Rendering::FrameCapture> Vol::Rendering::OffscreenPass::
+    take_captures(bool wait)
+{
+    if (wait) {
+        context->wait_till_idle();
+        for (uint32_t i = 0; i < capture_buffers.size(); i++) {
+            read_capture(i);
+        }
+    }
+    return std::exchange(captures, {});
+}
+
+void Vol::Rendering::OffscreenPass::record_image_copy(
+    VkCommandBuffer command_buffer,
+    VkBuffer buffer)
+{
+    // Copy the corner of the attachment the frame covers
+    transition_image_layout(
+        command_buffer, color.image, 1,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+    VkBufferImageCopy region = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            VkImageSubresourceLayers{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {width, height, 1},
+    };
+    vkCmdCopyImageToBuffer(
+        command_buffer, color.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        buffer, 1, &region);
+
+    transition_image_layout(
+        command_buffer, color.image, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Make the copy visible to the host
+    VkMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void Vol::Rendering::OffscreenPass::record_capture(
+    VkCommandBuffer command_buffer,
+    uint32_t frame_index)
+{
+    if (!next_capture) {
+        return;
+    }
+
+    // The slot's buffer was last read by the frame before, so it may be
+    // replaced by a larger one
+    CaptureBuffer &capture_buffer = capture_buffers[frame_index];
+    VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+    if (capture_buffer.size < size) {
+        vkDestroyBuffer(context->get_device(), capture_buffer.buffer, nullptr);
+        context->get_memory_allocator()->free(capture_buffer.memory);
+        create_buffer(
+            size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            MemoryCategory::Staging, capture_buffer.buffer,
+            capture_buffer.memory);
+        capture_buffer.size = size;
+    }
+
+    record_image_copy(command_buffer, capture_buffer.buffer);
+    capture_buffer.capture = FrameCapture{
+        .id = *next_capture,
+        .width = width,
+        .height = height,
+    };
+    next_capture.reset();
+}
+
+void Vol::Rendering::OffscreenPass::read_capture(uint32_t frame_index)
+{
+    CaptureBuffer &capture_buffer = capture_buffers[frame_index];
+    if (!capture_buffer.capture) {
+        return;
+    }
+
+    FrameCapture &capture = *capture_buffer.capture;
+    const uint8_t *src =
+        static_cast<const uint8_t *>(capture_buffer.memory.mapped);
+    capture.pixels.assign(
+        src, src + static_cast<size_t>(capture.width) * capture.height * 4);
+    captures.push_back(std::move(capture));
+    capture_buffer.capture.reset();
+}
+
+void Vol::Rendering::OffscreenPass::transfer_function_changed(
+    const std::vector<glm::uint32_t> &data)
+{
+    // Frames in flight keep sampling the old tables
+    retire_transfer();
     create_transfer(data);
 
     update_descriptor_sets();
 }
 
+Vol::Rendering::VolumeUpload Vol::Rendering::OffscreenPass::stage_volume(
+    std::shared_ptr<const Vol::Data::Dataset> dataset,
+    std::atomic<float> *progress)
+{
+    VolumeUpload upload{};
+    Volume &volume = upload.volume;
+
+    // Select format, widening to float if the native format can't be filtered
+    volume.format = get_sampled_format(dataset->type);
+    bool widen = volume.format == VK_FORMAT_R32_SFLOAT &&
+                 dataset->type != Vol::Data::VoxelType::Float32;
+
+    // Levels of detail become mip levels. The image starts at the first level
+    // that fits on the device, the finer ones are paged in as they are needed.
+    std::vector<const Vol::Data::Dataset *> levels = {dataset.get()};
+    for (const Vol::Data::Dataset &level : dataset->levels) {
+        levels.push_back(&level);
+    }
+    while (volume.fallback_level < levels.size() &&
+           !fits_on_device(*levels[volume.fallback_level])) {
+        volume.fallback_level++;
+    }
+    if (volume.fallback_level == levels.size()) {
+        throw std::runtime_error("Volume is too large for the device");
+    }
+    levels.erase(levels.begin(), levels.begin() + volume.fallback_level);
+    if (volume.fallback_level > 0) {
+        upload.paged_dataset = dataset;
+    }
+    volume.mip_levels = static_cast<uint32_t>(levels.size());
+
+    volume.extent = {
+        .width = levels[0]->dimensions.x,
+        .height = levels[0]->dimensions.y,
+        .depth = levels[0]->dimensions.z,
+    };
+
+    // The density window clips the tails of the histogram if there is one.
+    // Sampling a normalized format returns normalized values, so the window
+    // has to be remapped to match.
+    std::pair<float, float> window = {dataset->min, dataset->max};
+    if (dataset->histogram) {
+        window = dataset->histogram->get_window();
+        volume.histogram = dataset->histogram;
+    }
+    volume.min_density = normalize_density(volume.format, window.first);
+    volume.max_density = normalize_density(volume.format, window.second);
+
+    // Datasets without macrocells get a single one spanning the volume
+    Vol::Data::RangeGrid macrocells = {
+        .dimensions = glm::u32vec3(1),
+        .ranges = {{dataset->min, dataset->max}},
+    };
+    if (dataset->macrocells) {
+        macrocells = *dataset->macrocells;
+        volume.macrocell_extent = glm::vec3(Vol::Data::macrocell_size) /
+                                  glm::vec3(dataset->dimensions);
+    }
+    volume.macrocell_grid = macrocells.dimensions;
+
+    // Levels are packed one after another in the staging buffer with offsets
+    // aligned for any texel size, followed by the macrocells
+    size_t texel_size = get_texel_size(volume.format);
+    VkDeviceSize size = 0;
+    for (const Vol::Data::Dataset *level : levels) {
+        size = (size + 15) & ~VkDeviceSize(15);
+        upload.level_offsets.push_back(size);
+        size += level->get_voxel_count() * texel_size;
+    }
+    size = (size + 15) & ~VkDeviceSize(15);
+    upload.macrocell_offset = size;
+    size += macrocells.ranges.size() * sizeof(glm::vec2);
+
+    // Create staging buffer
+    create_buffer(
+        size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        MemoryCategory::Staging, upload.staging_buffer,
+        upload.staging_buffer_memory);
+
+    // Read voxels into the staging buffer, straight from the file if they
+    // are mapped or the cache if they are compressed. The finest level makes
+    // up most of the data, so it alone reports progress.
+    auto read_level = [&](const Vol::Data::Dataset &level, std::byte *dst,
+                          std::atomic<float> *level_progress) {
+        if (!widen) {
+            level.read_voxels(dst, level_progress);
+            return;
+        }
+        std::vector<std::byte> voxels(level.get_size());
+        level.read_voxels(voxels.data(), level_progress);
+        Vol::Data::widen_to_float(
+            voxels.data(), reinterpret_cast<float *>(dst),
+            level.get_voxel_count(), level.type);
+    };
+
+    try {
+        // Macrocell ranges are normalized like the density window
+        std::byte *dst =
+            static_cast<std::byte *>(upload.staging_buffer_memory.mapped);
+        glm::vec2 *ranges =
+            reinterpret_cast<glm::vec2 *>(dst + upload.macrocell_offset);
+        for (size_t i = 0; i < macrocells.ranges.size(); i++) {
+            ranges[i] = glm::vec2(
+                normalize_density(volume.format, macrocells.ranges[i].first),
+                normalize_density(volume.format, macrocells.ranges[i].second));
+        }
+
+        for (size_t i = levels.size() - 1; i > 0; i--) {
+            read_level(*levels[i], dst + upload.level_offsets[i], nullptr);
+        }
+        read_level(*levels[0], dst, progress);
+    } catch (...) {
+        discard_volume(upload);
+        throw;
+    }
+
+    return upload;
+}
+
+void Vol::Rendering::OffscreenPass::submit_volume(VolumeUpload upload)
+{
+    // Only one upload is in flight at a time, the next is queued until it
+    // has been swapped in. A queued upload that never started is superseded.
+    if (pending_upload) {
+        if (queued_upload) {
+            discard_volume(*queued_upload);
+        }
+        queued_upload = std::move(upload);
+        return;
+    }
+    start_volume_upload(std::move(upload));
+}
+
+void Vol::Rendering::OffscreenPass::start_volume_upload(VolumeUpload upload)
+{
+    Volume &volume = upload.volume;
+
+    // Create image
+    create_image(
+        VK_IMAGE_TYPE_3D, volume.format, volume.extent, volume.mip_levels,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Volume,
+        volume.image, volume.memory);
+    create_volume_image_view(volume);
+    create_volume_sampler(volume);
+
+    VkExtent3D grid_extent = {
+        .width = volume.macrocell_grid.x,
+        .height = volume.macrocell_grid.y,
+        .depth = volume.macrocell_grid.z,
+    };
+    create_image(
+        VK_IMAGE_TYPE_3D, VK_FORMAT_R32G32_SFLOAT, grid_extent, 1,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Volume,
+        volume.macrocell_image, volume.macrocell_memory);
+    create_macrocell_image_view(volume);
+
+    // Record the copies, then feed the first chunks to the transfer queue
+    record_volume_transfer(upload);
+    pending_upload = upload;
+    submit_volume_transfers(*pending_upload, false);
+}
+
+void Vol::Rendering::OffscreenPass::discard_volume(VolumeUpload &upload)
+{
+    vkDestroyBuffer(context->get_device(), upload.staging_buffer, nullptr);
+    context->get_memory_allocator()->free(upload.staging_buffer_memory);
+    upload.staging_buffer = VK_NULL_HANDLE;
+}
+
+float Vol::Rendering::OffscreenPass::get_upload_progress() const
+{
+    if (!pending_upload || pending_upload->transfer_command_buffers.empty()) {
+        return 0.0f;
+    }
+    return static_cast<float>(pending_upload->transfers_completed) /
+           static_cast<float>(pending_upload->transfer_command_buffers.size());
+}
+
+bool Vol::Rendering::OffscreenPass::fits_on_device(
+    const Vol::Data::Dataset &dataset) const
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->get_physical_device(), &properties);
+    if (std::max({dataset.dimensions.x, dataset.dimensions.y,
+                  dataset.dimensions.z}) >
+        properties.limits.maxImageDimension3D) {
+        return false;
+    }
+
+    // Coarser mip levels add at most a seventh to the size of the finest
+    VkDeviceSize size = dataset.get_voxel_count() *
+                        get_texel_size(get_sampled_format(dataset.type));
+    return size + size / 7 <=
+           get_device_local_memory(context->get_physical_device()) /
+               volume_memory_divisor;
+}
+
 void Vol::Rendering::OffscreenPass::create_color_attachment()
 {
     // Define format
@@ -297,13 +888,15 @@ void Vol::Rendering::OffscreenPass::create_color_attachment()
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = VK_IMAGE_TYPE_2D,
         .format = color.format,
-        .extent = VkExtent3D{.width = width, .height = height, .depth = 1},
+        .extent =
+            VkExtent3D{
+                .width = image_width, .height = image_height, .depth = 1},
         .mipLevels = 1,
         .arrayLayers = 1,
         .samples = VK_SAMPLE_COUNT_1_BIT,
         .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .usage =
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
     };
 
     if (vkCreateImage(
@@ -313,29 +906,9 @@ void Vol::Rendering::OffscreenPass::create_color_attachment()
     }
 
     // Allocate memory
-    VkMemoryRequirements memory_requirements;
-    vkGetImageMemoryRequirements(
-        context->get_device(), color.image, &memory_requirements);
-
-    VkMemoryAllocateInfo memory_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memory_requirements.size,
-        .memoryTypeIndex = get_memory_type_index(
-            context, memory_requirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
-    };
-
-    if (vkAllocateMemory(
-            context->get_device(), &memory_alloc_info, nullptr,
-            &color.memory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate memory");
-    }
-
-    if (vkBindImageMemory(
-            context->get_device(), color.image, color.memory, 0) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to bind image memory");
-    }
+    color.memory = context->get_memory_allocator()->allocate_image(
+        color.image, VK_IMAGE_TILING_OPTIMAL,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Attachment);
 
     // Create image view
     VkImageViewCreateInfo image_view_create_info = {
@@ -394,7 +967,9 @@ void Vol::Rendering::OffscreenPass::create_depth_attachment()
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = VK_IMAGE_TYPE_2D,
         .format = depth.format,
-        .extent = VkExtent3D{.width = width, .height = height, .depth = 1},
+        .extent =
+            VkExtent3D{
+                .width = image_width, .height = image_height, .depth = 1},
         .mipLevels = 1,
         .arrayLayers = 1,
         .samples = VK_SAMPLE_COUNT_1_BIT,
@@ -409,29 +984,9 @@ void Vol::Rendering::OffscreenPass::create_depth_attachment()
     }
 
     // Allocate memory
-    VkMemoryRequirements memory_requirements;
-    vkGetImageMemoryRequirements(
-        context->get_device(), depth.image, &memory_requirements);
-
-    VkMemoryAllocateInfo memory_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memory_requirements.size,
-        .memoryTypeIndex = get_memory_type_index(
-            context, memory_requirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
-    };
-
-    if (vkAllocateMemory(
-            context->get_device(), &memory_alloc_info, nullptr,
-            &depth.memory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate memory");
-    }
-
-    if (vkBindImageMemory(
-            context->get_device(), depth.image, depth.memory, 0) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to bind image memory");
-    }
+    depth.memory = context->get_memory_allocator()->allocate_image(
+        depth.image, VK_IMAGE_TILING_OPTIMAL,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Attachment);
 
     // Create image view
     VkImageViewCreateInfo image_view_create_info = {
@@ -461,31 +1016,88 @@ void Vol::Rendering::OffscreenPass::create_depth_attachment()
     }
 }
 
-void Vol::Rendering::OffscreenPass::create_render_pass()
+void Vol::Rendering::OffscreenPass::create_history_attachment()
 {
-    // Define attachment descriptions
-    std::array<VkAttachmentDescription, 2> attachment_descriptions = {
-        VkAttachmentDescription{
-            .format = color.format,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        },
-        VkAttachmentDescription{
-            .format = depth.format,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-        },
-    };
+    create_image(
+        VK_IMAGE_TYPE_2D, history.format,
+        VkExtent3D{.width = image_width, .height = image_height, .depth = 1},
+        1,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Attachment,
+        history.image, history.memory);
+
+    // Create image view
+    VkImageViewCreateInfo image_view_create_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = history.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = history.format,
+        .subresourceRange =
+            VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    if (vkCreateImageView(
+            context->get_device(), &image_view_create_info, nullptr,
+            &history.image_view) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create image view");
+    }
+
+    // The history is blended into and shown before anything is rendered, so
+    // it is cleared to the background along with the next uploads
+    VkCommandBuffer command_buffer =
+        context->get_upload_manager()->get_command_buffer();
+
+    transition_image_layout(
+        command_buffer, history.image, 1, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    VkClearColorValue clear_color = {
+        {background_color.x, background_color.y, background_color.z,
+         background_color.w}};
+    VkImageSubresourceRange range = image_view_create_info.subresourceRange;
+    vkCmdClearColorImage(
+        command_buffer, history.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        &clear_color, 1, &range);
+
+    transition_image_layout(
+        command_buffer, history.image, 1,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void Vol::Rendering::OffscreenPass::create_render_pass()
+{
+    // Define attachment descriptions
+    std::array<VkAttachmentDescription, 2> attachment_descriptions = {
+        VkAttachmentDescription{
+            .format = color.format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        },
+        VkAttachmentDescription{
+            .format = depth.format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        },
+    };
 
     // Define attachment references
     VkAttachmentReference color_reference = {
@@ -547,6 +1159,74 @@ void Vol::Rendering::OffscreenPass::create_render_pass()
     }
 }
 
+void Vol::Rendering::OffscreenPass::create_history_render_pass()
+{
+    // The history is loaded to blend frames into, and is sampled in between
+    VkAttachmentDescription attachment_description = {
+        .format = history.format,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    // Define attachment reference
+    VkAttachmentReference color_reference = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
+    // Define subpass
+    VkSubpassDescription subpass_description = {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_reference,
+    };
+
+    // Define subpass dependancies
+    std::array<VkSubpassDependency, 2> dependancies = {
+        VkSubpassDependency{
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+        },
+        VkSubpassDependency{
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+        },
+    };
+
+    // Create render pass
+    VkRenderPassCreateInfo render_pass_create_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &attachment_description,
+        .subpassCount = 1,
+        .pSubpasses = &subpass_description,
+        .dependencyCount = static_cast<uint32_t>(dependancies.size()),
+        .pDependencies = dependancies.data(),
+    };
+
+    if (vkCreateRenderPass(
+            context->get_device(), &render_pass_create_info, nullptr,
+            &history_render_pass) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create render pass");
+    }
+}
+
 void Vol::Rendering::OffscreenPass::create_framebuffer()
 {
     // Create framebuffer
@@ -558,8 +1238,8 @@ void Vol::Rendering::OffscreenPass::create_framebuffer()
         .renderPass = render_pass,
         .attachmentCount = static_cast<uint32_t>(image_views.size()),
         .pAttachments = image_views.data(),
-        .width = width,
-        .height = height,
+        .width = image_width,
+        .height = image_height,
         .layers = 1,
     };
 
@@ -570,9 +1250,28 @@ void Vol::Rendering::OffscreenPass::create_framebuffer()
     }
 }
 
+void Vol::Rendering::OffscreenPass::create_history_framebuffer()
+{
+    VkFramebufferCreateInfo framebuffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass = history_render_pass,
+        .attachmentCount = 1,
+        .pAttachments = &history.image_view,
+        .width = image_width,
+        .height = image_height,
+        .layers = 1,
+    };
+
+    if (vkCreateFramebuffer(
+            context->get_device(), &framebuffer_create_info, nullptr,
+            &history_framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create framebuffer");
+    }
+}
+
 void Vol::Rendering::OffscreenPass::create_descriptor_set_layout()
 {
-    std::array<VkDescriptorSetLayoutBinding, 3> bindings = {
+    std::array<VkDescriptorSetLayoutBinding, 8> bindings = {
         // Uniform buffer
         VkDescriptorSetLayoutBinding{
             .binding = 0,
@@ -597,6 +1296,46 @@ void Vol::Rendering::OffscreenPass::create_descriptor_set_layout()
             .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
             .pImmutableSamplers = nullptr,
         },
+        // Page table
+        VkDescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+        // Page feedback
+        VkDescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+        // Page atlas
+        VkDescriptorSetLayoutBinding{
+            .binding = 5,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+        // Macrocells
+        VkDescriptorSetLayoutBinding{
+            .binding = 6,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+        // Transfer function visibility
+        VkDescriptorSetLayoutBinding{
+            .binding = 7,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = nullptr,
+        },
     };
 
     VkDescriptorSetLayoutCreateInfo layout_create_info = {
@@ -612,6 +1351,30 @@ void Vol::Rendering::OffscreenPass::create_descriptor_set_layout()
     }
 }
 
+void Vol::Rendering::OffscreenPass::create_history_descriptor_set_layout()
+{
+    // Frame raymarched into the color attachment
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = nullptr,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+
+    if (vkCreateDescriptorSetLayout(
+            context->get_device(), &layout_create_info, nullptr,
+            &history_descriptor_set_layout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout");
+    }
+}
+
 void Vol::Rendering::OffscreenPass::create_pipeline()
 {
     // Read SPIR-V files
@@ -746,13 +1509,20 @@ void Vol::Rendering::OffscreenPass::create_pipeline()
         .pDynamicStates = dynamic_states.data(),
     };
 
+    // Define the range of the jitter pushed every frame
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(glm::vec2),
+    };
+
     // Define pipeline layout creation information
     VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = 1,
         .pSetLayouts = &descriptor_set_layout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
     };
 
     if (vkCreatePipelineLayout(
@@ -790,78 +1560,185 @@ void Vol::Rendering::OffscreenPass::create_pipeline()
     vkDestroyShaderModule(context->get_device(), frag_module, nullptr);
 }
 
-void Vol::Rendering::OffscreenPass::create_vertex_buffer()
+void Vol::Rendering::OffscreenPass::create_history_pipeline()
 {
-    VkDeviceSize size = sizeof(Vertex) * vertices.size();
+    // Read SPIR-V files
+    auto vert_code = read_binary_file(RES("shaders/accumulate_vert.spv"));
+    auto frag_code = read_binary_file(RES("shaders/accumulate_frag.spv"));
 
-    // Create staging buffer
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    create_buffer(
-        size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory);
+    // Create shader modules
+    VkShaderModule vert_module =
+        create_shader_module(context->get_device(), vert_code);
+    VkShaderModule frag_module =
+        create_shader_module(context->get_device(), frag_code);
 
-    // Copy data to staging buffer
-    void *data;
-    vkMapMemory(
-        context->get_device(), staging_buffer_memory, 0, size, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(size));
-    vkUnmapMemory(context->get_device(), staging_buffer_memory);
+    // Define shader stage creation information
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vert_module,
+            .pName = "main",
+        },
+        VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = frag_module,
+            .pName = "main",
+        },
+    };
 
-    // Create vertex buffer
-    create_buffer(
-        size,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer,
-        vertex_buffer_memory);
+    // The triangle covering the image is made up in the vertex shader
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    };
 
-    // Copy buffer
-    copy_buffer(staging_buffer, vertex_buffer, size);
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
 
-    // Destroy staging buffer
-    vkDestroyBuffer(context->get_device(), staging_buffer, nullptr);
-    vkFreeMemory(context->get_device(), staging_buffer_memory, nullptr);
-}
+    VkPipelineViewportStateCreateInfo viewport_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
 
-void Vol::Rendering::OffscreenPass::create_index_buffer()
-{
-    VkDeviceSize size = sizeof(uint16_t) * indices.size();
+    VkPipelineRasterizationStateCreateInfo rasterizer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1.0f,
+    };
 
-    // Create staging buffer
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    create_buffer(
-        size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory);
+    VkPipelineMultisampleStateCreateInfo multisampling_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 1.0f,
+    };
 
-    // Copy data to staging buffer
-    void *data;
-    vkMapMemory(
-        context->get_device(), staging_buffer_memory, 0, size, 0, &data);
-    memcpy(data, indices.data(), static_cast<size_t>(size));
-    vkUnmapMemory(context->get_device(), staging_buffer_memory);
+    // Frames are weighed against the history by the blend constants
+    VkPipelineColorBlendAttachmentState color_blend_attachment = {
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_CONSTANT_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_CONSTANT_ALPHA,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    };
 
-    // Create index buffer
-    create_buffer(
-        size,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer, index_buffer_memory);
+    VkPipelineColorBlendStateCreateInfo color_blend_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = &color_blend_attachment,
+    };
 
-    // Copy buffer
-    copy_buffer(staging_buffer, index_buffer, size);
+    std::vector<VkDynamicState> dynamic_states = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+        VK_DYNAMIC_STATE_BLEND_CONSTANTS,
+    };
 
-    // Destroy staging buffer
-    vkDestroyBuffer(context->get_device(), staging_buffer, nullptr);
-    vkFreeMemory(context->get_device(), staging_buffer_memory, nullptr);
-}
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = static_cast<uint32_t>(dynamic_states.size()),
+        .pDynamicStates = dynamic_states.data(),
+    };
 
-void Vol::Rendering::OffscreenPass::create_uniform_buffers()
-{
-    VkDeviceSize size = sizeof(UniformBufferObject);
+    // Define the range of the frame's region pushed every frame
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(glm::vec2),
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &history_descriptor_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+
+    if (vkCreatePipelineLayout(
+            context->get_device(), &pipeline_layout_create_info, nullptr,
+            &history_pipeline_layout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout");
+    }
+
+    VkGraphicsPipelineCreateInfo pipeline_create_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &input_assembly_create_info,
+        .pViewportState = &viewport_create_info,
+        .pRasterizationState = &rasterizer_create_info,
+        .pMultisampleState = &multisampling_create_info,
+        .pColorBlendState = &color_blend_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = history_pipeline_layout,
+        .renderPass = history_render_pass,
+        .subpass = 0,
+    };
+
+    if (vkCreateGraphicsPipelines(
+            context->get_device(), VK_NULL_HANDLE, 1, &pipeline_create_info,
+            nullptr, &history_pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create graphics pipeline");
+    }
+
+    // Destoy shader modules
+    vkDestroyShaderModule(context->get_device(), vert_module, nullptr);
+    vkDestroyShaderModule(context->get_device(), frag_module, nullptr);
+}
+
+void Vol::Rendering::OffscreenPass::create_vertex_buffer()
+{
+    VkDeviceSize size = sizeof(Vertex) * vertices.size();
+
+    // Create vertex buffer
+    create_buffer(
+        size,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer,
+        vertex_buffer, vertex_buffer_memory);
+
+    // Stage data to copy into it
+    context->get_upload_manager()->upload_buffer(
+        vertex_buffer, 0, vertices.data(), size);
+}
+
+void Vol::Rendering::OffscreenPass::create_index_buffer()
+{
+    VkDeviceSize size = sizeof(uint16_t) * indices.size();
+
+    // Create index buffer
+    create_buffer(
+        size,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer,
+        index_buffer, index_buffer_memory);
+
+    // Stage data to copy into it
+    context->get_upload_manager()->upload_buffer(
+        index_buffer, 0, indices.data(), size);
+}
+
+void Vol::Rendering::OffscreenPass::create_uniform_buffers()
+{
+    VkDeviceSize size = sizeof(UniformBufferObject);
     uniform_buffers.resize(MAX_FRAMES_IN_FLIGHT);
     uniform_buffers_memory.resize(MAX_FRAMES_IN_FLIGHT);
     uniform_buffers_mapped.resize(MAX_FRAMES_IN_FLIGHT);
@@ -871,24 +1748,33 @@ void Vol::Rendering::OffscreenPass::create_uniform_buffers()
             size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            uniform_buffers[i], uniform_buffers_memory[i]);
-        if (vkMapMemory(
-                context->get_device(), uniform_buffers_memory[i], 0, size, 0,
-                &uniform_buffers_mapped[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to map memory");
-        }
+            MemoryCategory::Buffer, uniform_buffers[i],
+            uniform_buffers_memory[i]);
+        uniform_buffers_mapped[i] = uniform_buffers_memory[i].mapped;
     }
 }
 
+void Vol::Rendering::OffscreenPass::create_empty_buffer()
+{
+    create_buffer(
+        sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Buffer,
+        empty_buffer, empty_buffer_memory);
+}
+
 void Vol::Rendering::OffscreenPass::create_descriptor_pool()
 {
-    std::array<VkDescriptorPoolSize, 2> pool_sizes{
+    std::array<VkDescriptorPoolSize, 3> pool_sizes{
         VkDescriptorPoolSize{
             .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
             .descriptorCount = MAX_FRAMES_IN_FLIGHT,
         },
         VkDescriptorPoolSize{
             .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = MAX_FRAMES_IN_FLIGHT * 5,
+        },
+        VkDescriptorPoolSize{
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
             .descriptorCount = MAX_FRAMES_IN_FLIGHT * 2,
         },
     };
@@ -927,74 +1813,351 @@ void Vol::Rendering::OffscreenPass::create_descriptor_sets()
         throw std::runtime_error("Failed to allocate descriptor sets");
     }
 
+    descriptor_sets_dirty.resize(MAX_FRAMES_IN_FLIGHT);
     update_descriptor_sets();
 }
 
-void Vol::Rendering::OffscreenPass::create_volume(Vol::Data::Dataset &dataset)
+void Vol::Rendering::OffscreenPass::create_history_descriptor_sets()
 {
-    create_volume_image(dataset);
-    create_volume_image_view();
-    create_volume_sampler();
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = MAX_FRAMES_IN_FLIGHT,
+    };
+
+    VkDescriptorPoolCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = MAX_FRAMES_IN_FLIGHT,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size,
+    };
+
+    if (vkCreateDescriptorPool(
+            context->get_device(), &create_info, nullptr,
+            &history_descriptor_pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool");
+    }
+
+    // Every frame in flight has a set of its own, written along with its
+    // other sets
+    std::vector<VkDescriptorSetLayout> layouts(
+        MAX_FRAMES_IN_FLIGHT, history_descriptor_set_layout);
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = history_descriptor_pool,
+        .descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+        .pSetLayouts = layouts.data(),
+    };
+
+    history_descriptor_sets.resize(MAX_FRAMES_IN_FLIGHT);
+    if (vkAllocateDescriptorSets(
+            context->get_device(), &alloc_info,
+            history_descriptor_sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets");
+    }
 }
 
-void Vol::Rendering::OffscreenPass::create_volume_image(
-    Vol::Data::Dataset &dataset)
+void Vol::Rendering::OffscreenPass::create_volume_image_view(Volume &volume)
 {
-    VkDeviceSize size = sizeof(float) * dataset.data.size();
+    VkImageViewCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = volume.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_3D,
+        .format = volume.format,
+        .subresourceRange =
+            VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = volume.mip_levels,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
 
-    // Create staging buffer
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    create_buffer(
-        size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory);
+    if (vkCreateImageView(
+            context->get_device(), &create_info, nullptr,
+            &volume.image_view)) {
+        throw std::runtime_error("Failed to create image view");
+    }
+}
+
+void Vol::Rendering::OffscreenPass::create_volume_sampler(Volume &volume)
+{
+    VkSamplerCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 0.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = static_cast<float>(volume.mip_levels - 1),
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
 
-    // Copy data to staging buffer
-    void *data;
-    vkMapMemory(
-        context->get_device(), staging_buffer_memory, 0, size, 0, &data);
-    memcpy(data, dataset.data.data(), static_cast<size_t>(size));
-    vkUnmapMemory(context->get_device(), staging_buffer_memory);
+    if (vkCreateSampler(
+            context->get_device(), &create_info, nullptr, &volume.sampler) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create sampler");
+    }
+}
 
-    // Create image
+void Vol::Rendering::OffscreenPass::create_macrocell_image_view(Volume &volume)
+{
+    VkImageViewCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = volume.macrocell_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_3D,
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .subresourceRange =
+            VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    if (vkCreateImageView(
+            context->get_device(), &create_info, nullptr,
+            &volume.macrocell_image_view)) {
+        throw std::runtime_error("Failed to create image view");
+    }
+}
+
+void Vol::Rendering::OffscreenPass::create_macrocell_sampler()
+{
+    VkSamplerCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 0.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = 0.0f,
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    if (vkCreateSampler(
+            context->get_device(), &create_info, nullptr,
+            &macrocell_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create sampler");
+    }
+}
+
+void Vol::Rendering::OffscreenPass::create_volume_paging(
+    VkCommandBuffer command_buffer,
+    Volume &volume,
+    std::shared_ptr<const Vol::Data::Dataset> dataset)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->get_physical_device(), &properties);
+
+    // Size the atlas to its share of device memory, with no more slots than
+    // the volume has pages or a page table entry can address
+    glm::u32vec3 grid = get_page_grid_dimensions(dataset->dimensions);
+    VkDeviceSize page_count =
+        static_cast<VkDeviceSize>(grid.x) * grid.y * grid.z;
+    VkDeviceSize page_bytes = static_cast<VkDeviceSize>(page_size) * page_size *
+                              page_size * get_texel_size(volume.format);
+    uint32_t axis_slots =
+        std::min(properties.limits.maxImageDimension3D / page_size, 1024u);
+    VkDeviceSize slot_count = std::max(
+        std::min({
+            get_device_local_memory(context->get_physical_device()) /
+                atlas_memory_divisor / page_bytes,
+            page_count,
+            static_cast<VkDeviceSize>(axis_slots) * axis_slots * axis_slots,
+        }),
+        VkDeviceSize(1));
+
+    glm::u32vec3 slots(1);
+    slots.x = static_cast<uint32_t>(
+        std::min(slot_count, static_cast<VkDeviceSize>(axis_slots)));
+    slots.y = static_cast<uint32_t>(
+        std::min(slot_count / slots.x, static_cast<VkDeviceSize>(axis_slots)));
+    slots.z = static_cast<uint32_t>(slot_count / (slots.x * slots.y));
+
+    auto paging = std::make_shared<PagedVolume>();
+    paging->dimensions = dataset->dimensions;
+    bool widen = volume.format == VK_FORMAT_R32_SFLOAT &&
+                 dataset->type != Vol::Data::VoxelType::Float32;
+    paging->streamer = std::make_unique<PageStreamer>(
+        std::move(dataset), widen, slots, MAX_FRAMES_IN_FLIGHT);
+
+    // Create atlas, a slot is only sampled once a page has been copied in
     VkExtent3D extent = {
-        .width = dataset.dimensions.x,
-        .height = dataset.dimensions.y,
-        .depth = dataset.dimensions.z,
+        .width = slots.x * page_size,
+        .height = slots.y * page_size,
+        .depth = slots.z * page_size,
     };
     create_image(
-        VK_IMAGE_TYPE_3D, VK_FORMAT_R32_SFLOAT, extent, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_TYPE_3D, volume.format, extent, 1, VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, volume_image, volume_image_memory);
-
-    // Transition layout
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Volume,
+        paging->atlas_image, paging->atlas_memory);
     transition_image_layout(
-        volume_image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED,
+        command_buffer, paging->atlas_image, 1, VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    transition_image_layout(
+        command_buffer, paging->atlas_image, 1,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    VkImageViewCreateInfo view_create_info{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = paging->atlas_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_3D,
+        .format = volume.format,
+        .subresourceRange =
+            VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    if (vkCreateImageView(
+            context->get_device(), &view_create_info, nullptr,
+            &paging->atlas_image_view)) {
+        throw std::runtime_error("Failed to create image view");
+    }
+
+    // Pages carry their own border, so filtering never leaves a slot
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 0.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = 0.0f,
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+
+    if (vkCreateSampler(
+            context->get_device(), &sampler_create_info, nullptr,
+            &paging->atlas_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create sampler");
+    }
+
+    // Create the buffers of every frame in flight, mapped for as long as
+    // they live
+    auto create_mapped_buffer = [&](VkDeviceSize size,
+                                    VkBufferUsageFlags usage,
+                                    MemoryCategory category,
+                                    std::vector<VkBuffer> &buffers,
+                                    std::vector<MemoryAllocation> &memories,
+                                    std::vector<void *> &mapped) {
+        buffers.resize(MAX_FRAMES_IN_FLIGHT);
+        memories.resize(MAX_FRAMES_IN_FLIGHT);
+        mapped.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            create_buffer(
+                size, usage,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                category, buffers[i], memories[i]);
+            mapped[i] = memories[i].mapped;
+            std::memset(mapped[i], 0, size);
+        }
+    };
+
+    VkDeviceSize table_size = page_count * sizeof(uint32_t);
+    create_mapped_buffer(
+        table_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryCategory::Table,
+        paging->page_table_buffers, paging->page_table_buffers_memory,
+        paging->page_table_buffers_mapped);
+    create_mapped_buffer(
+        table_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryCategory::Table,
+        paging->feedback_buffers, paging->feedback_buffers_memory,
+        paging->feedback_buffers_mapped);
+    create_mapped_buffer(
+        std::max(page_stream_budget, page_bytes),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryCategory::Staging,
+        paging->staging_buffers, paging->staging_buffers_memory,
+        paging->staging_buffers_mapped);
+
+    volume.paging = std::move(paging);
+}
+
+void Vol::Rendering::OffscreenPass::create_transfer(
+    const std::vector<glm::uint32_t> &data)
+{
+    create_transfer_image(data);
+    create_transfer_image_view();
+    create_transfer_sampler();
+    create_visibility_image(data);
+    create_visibility_image_view();
+}
+
+void Vol::Rendering::OffscreenPass::create_transfer_image(
+    const std::vector<glm::uint32_t> &data)
+{
+    // Rays classify the segment between consecutive samples, so the image
+    // holds the transfer function integrated over every such segment
+    std::vector<uint16_t> table = preintegrate_transfer_function(
+        data, &Application::main().get_thread_pool());
 
-    // Copy buffer
-    copy_buffer_to_image(staging_buffer, volume_image, extent);
+    // Create image
+    VkExtent3D extent = {
+        .width = static_cast<uint32_t>(data.size()),
+        .height = static_cast<uint32_t>(data.size()),
+        .depth = 1,
+    };
+    create_image(
+        VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, extent, 1,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Table,
+        transfer_image, transfer_image_memory);
 
-    // Transition layout
+    // Stage the table, submitted with the next frame
+    UploadManager *uploads = context->get_upload_manager();
+    transition_image_layout(
+        uploads->get_command_buffer(), transfer_image, 1,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    uploads->upload_image(
+        transfer_image, extent, 4 * sizeof(uint16_t), table.data());
     transition_image_layout(
-        volume_image, VK_FORMAT_R32_SFLOAT,
+        uploads->get_command_buffer(), transfer_image, 1,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    // Destroy staging buffer
-    vkDestroyBuffer(context->get_device(), staging_buffer, nullptr);
-    vkFreeMemory(context->get_device(), staging_buffer_memory, nullptr);
 }
 
-void Vol::Rendering::OffscreenPass::create_volume_image_view()
+void Vol::Rendering::OffscreenPass::create_transfer_image_view()
 {
     VkImageViewCreateInfo create_info{
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .image = volume_image,
-        .viewType = VK_IMAGE_VIEW_TYPE_3D,
-        .format = VK_FORMAT_R32_SFLOAT,
+        .image = transfer_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = VK_FORMAT_R16G16B16A16_SFLOAT,
         .subresourceRange =
             VkImageSubresourceRange{
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -1006,20 +2169,21 @@ void Vol::Rendering::OffscreenPass::create_volume_image_view()
     };
 
     if (vkCreateImageView(
-            context->get_device(), &create_info, nullptr, &volume_image_view)) {
+            context->get_device(), &create_info, nullptr,
+            &transfer_image_view)) {
         throw std::runtime_error("Failed to create image view");
     }
 }
 
-void Vol::Rendering::OffscreenPass::create_volume_sampler()
+void Vol::Rendering::OffscreenPass::create_transfer_sampler()
 {
     VkSamplerCreateInfo create_info{
         .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
         .magFilter = VK_FILTER_LINEAR,
         .minFilter = VK_FILTER_LINEAR,
-        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
-        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
-        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
         .mipLodBias = 0.0f,
         .anisotropyEnable = VK_FALSE,
         .maxAnisotropy = 0.0f,
@@ -1031,243 +2195,763 @@ void Vol::Rendering::OffscreenPass::create_volume_sampler()
         .unnormalizedCoordinates = VK_FALSE,
     };
 
-    if (vkCreateSampler(
-            context->get_device(), &create_info, nullptr, &volume_sampler) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to create sampler");
-    }
+    if (vkCreateSampler(
+            context->get_device(), &create_info, nullptr, &transfer_sampler) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create sampler");
+    }
+}
+
+void Vol::Rendering::OffscreenPass::create_visibility_image(
+    const std::vector<glm::uint32_t> &data)
+{
+    size_t count = data.size();
+
+    // Fill in the highest opacity between every pair of texels, whichever
+    // way around the pair is given
+    std::vector<uint8_t> table(count * count);
+    for (size_t first = 0; first < count; first++) {
+        uint8_t alpha = 0;
+        for (size_t last = first; last < count; last++) {
+            alpha = std::max(alpha, static_cast<uint8_t>(data[last] >> 24));
+            table[last * count + first] = alpha;
+            table[first * count + last] = alpha;
+        }
+    }
+
+    // Create image
+    VkExtent3D extent = {
+        .width = static_cast<uint32_t>(count),
+        .height = static_cast<uint32_t>(count),
+        .depth = 1,
+    };
+    create_image(
+        VK_IMAGE_TYPE_2D, VK_FORMAT_R8_UNORM, extent, 1,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Table,
+        visibility_image, visibility_image_memory);
+
+    // Stage the table, submitted with the next frame
+    UploadManager *uploads = context->get_upload_manager();
+    transition_image_layout(
+        uploads->get_command_buffer(), visibility_image, 1,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    uploads->upload_image(
+        visibility_image, extent, sizeof(uint8_t), table.data());
+    transition_image_layout(
+        uploads->get_command_buffer(), visibility_image, 1,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void Vol::Rendering::OffscreenPass::create_visibility_image_view()
+{
+    VkImageViewCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = visibility_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = VK_FORMAT_R8_UNORM,
+        .subresourceRange =
+            VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    if (vkCreateImageView(
+            context->get_device(), &create_info, nullptr,
+            &visibility_image_view)) {
+        throw std::runtime_error("Failed to create image view");
+    }
+}
+
+bool Vol::Rendering::OffscreenPass::stream_pages(
+    VkCommandBuffer command_buffer,
+    uint32_t frame_index)
+{
+    PagedVolume &paging = *volume.paging;
+    const std::vector<uint32_t> &page_table = paging.streamer->get_page_table();
+    size_t table_size = page_table.size() * sizeof(uint32_t);
+
+    // The frame last recorded in this slot has completed, so the pages it
+    // sampled can be read back and its buffers reused
+    uint32_t *feedback =
+        static_cast<uint32_t *>(paging.feedback_buffers_mapped[frame_index]);
+    std::vector<PageUpload> uploads = paging.streamer->update(
+        {feedback, page_table.size()}, frame_index,
+        static_cast<std::byte *>(paging.staging_buffers_mapped[frame_index]),
+        std::max(page_stream_budget, paging.streamer->get_page_bytes()));
+    std::memset(feedback, 0, table_size);
+    std::memcpy(
+        paging.page_table_buffers_mapped[frame_index], page_table.data(),
+        table_size);
+
+    if (uploads.empty()) {
+        return false;
+    }
+
+    // Copy the new pages into their slots, once the frames still in flight
+    // are done sampling whatever was evicted from them
+    std::vector<VkBufferImageCopy> copy_regions;
+    for (const PageUpload &upload : uploads) {
+        copy_regions.push_back(VkBufferImageCopy{
+            .bufferOffset = upload.offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource =
+                VkImageSubresourceLayers{
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            .imageOffset =
+                {
+                    static_cast<int32_t>(upload.slot.x * page_size),
+                    static_cast<int32_t>(upload.slot.y * page_size),
+                    static_cast<int32_t>(upload.slot.z * page_size),
+                },
+            .imageExtent = {page_size, page_size, page_size},
+        });
+    }
+
+    GpuProfiler *profiler = context->get_profiler();
+    profiler->begin_scope(command_buffer, GpuScope::Uploads);
+    transition_image_layout(
+        command_buffer, paging.atlas_image, 1,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdCopyBufferToImage(
+        command_buffer, paging.staging_buffers[frame_index], paging.atlas_image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(copy_regions.size()), copy_regions.data());
+    transition_image_layout(
+        command_buffer, paging.atlas_image, 1,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    profiler->end_scope(command_buffer, GpuScope::Uploads);
+
+    return true;
+}
+
+void Vol::Rendering::OffscreenPass::update_uniform_buffer(uint32_t frame_index)
+{
+    float aspect = static_cast<float>(width) / static_cast<float>(height);
+    Vol::Scene::Camera &camera = Application::main().get_scene().get_camera();
+
+    // Update uniform buffer object
+    this->ubo.view = camera.get_view();
+    this->ubo.proj = camera.get_projection(aspect);
+    this->ubo.camera_position = camera.get_position();
+
+    // Sample the level whose voxels are about a pixel in size, the volume
+    // spans one unit around the origin. The image of a paged volume starts
+    // at a coarser level.
+    float distance = std::max(glm::length(this->ubo.camera_position), 0.1f);
+    float pixels =
+        static_cast<float>(height) /
+        (2.0f * std::tan(glm::radians(Scene::field_of_view) / 2.0f) *
+         distance);
+    float voxels = static_cast<float>(std::max(
+                       {volume.extent.width, volume.extent.height,
+                        volume.extent.depth})) *
+                   std::exp2(static_cast<float>(volume.fallback_level));
+    float lod = std::max(std::log2(voxels / pixels), 0.0f);
+
+    // Step one level coarser and take fewer samples while the camera moves
+    float sampling_rate = samples_per_voxel;
+    auto now = std::chrono::steady_clock::now();
+    if (this->ubo.view != last_view) {
+        last_view = this->ubo.view;
+        last_camera_motion = now;
+    }
+    if (adaptive_quality && now - last_camera_motion < motion_settle_time) {
+        lod += 1.0f;
+        sampling_rate /= motion_sampling_divisor;
+    }
+    this->ubo.lod = std::min(
+        lod, static_cast<float>(volume.fallback_level + volume.mip_levels - 1));
+
+    // Rays step a fraction of a voxel of the finest level. Transfer function
+    // opacities are per voxel, so they are corrected for the step taken.
+    this->ubo.step_size = 1.0f / (voxels * sampling_rate);
+    this->ubo.opacity_correction = 1.0f / sampling_rate;
+
+    memcpy(uniform_buffers_mapped[frame_index], &ubo, sizeof(ubo));
+}
+
+void Vol::Rendering::OffscreenPass::update_descriptor_sets()
+{
+    // Sets may still be in use by frames in flight, so each one is rewritten
+    // when its frame is next recorded
+    std::fill(descriptor_sets_dirty.begin(), descriptor_sets_dirty.end(), true);
+
+    // Whatever was rebound shows up in the image once it is redrawn
+    redraw = true;
+}
+
+void Vol::Rendering::OffscreenPass::update_descriptor_set(uint32_t frame_index)
+{
+    // Uniform buffer
+    VkDescriptorBufferInfo buffer_info{
+        .buffer = uniform_buffers[frame_index],
+        .offset = 0,
+        .range = sizeof(UniformBufferObject),
+    };
+
+    // Volume image
+    VkDescriptorImageInfo volume_image_info{
+        .sampler = volume.sampler,
+        .imageView = volume.image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    // Transfer image
+    VkDescriptorImageInfo transfer_image_info{
+        .sampler = transfer_sampler,
+        .imageView = transfer_image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    // Paging, volumes that aren't paged never read it but still need
+    // something bound
+    VkDescriptorBufferInfo page_table_info{
+        .buffer = empty_buffer,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+    VkDescriptorBufferInfo feedback_info = page_table_info;
+    VkDescriptorImageInfo atlas_image_info = volume_image_info;
+    if (volume.paging) {
+        page_table_info.buffer =
+            volume.paging->page_table_buffers[frame_index];
+        feedback_info.buffer = volume.paging->feedback_buffers[frame_index];
+        atlas_image_info.sampler = volume.paging->atlas_sampler;
+        atlas_image_info.imageView = volume.paging->atlas_image_view;
+    }
+
+    // Macrocells and transfer function visibility
+    VkDescriptorImageInfo macrocell_image_info{
+        .sampler = macrocell_sampler,
+        .imageView = volume.macrocell_image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    VkDescriptorImageInfo visibility_image_info{
+        .sampler = macrocell_sampler,
+        .imageView = visibility_image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    std::array<VkWriteDescriptorSet, 8> descriptor_writes{
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .pBufferInfo = &buffer_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &volume_image_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 2,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &transfer_image_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 3,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &page_table_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 4,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &feedback_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 5,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &atlas_image_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 6,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &macrocell_image_info,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_sets[frame_index],
+            .dstBinding = 7,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &visibility_image_info,
+        },
+    };
+
+    vkUpdateDescriptorSets(
+        context->get_device(),
+        static_cast<uint32_t>(descriptor_writes.size()),
+        descriptor_writes.data(), 0, nullptr);
+
+    descriptor_sets_dirty[frame_index] = false;
 }
 
-void Vol::Rendering::OffscreenPass::create_transfer(
-    const std::vector<glm::uint32_t> &data)
+void Vol::Rendering::OffscreenPass::update_history_descriptor_set(
+    uint32_t frame_index)
 {
-    create_transfer_image(data);
-    create_transfer_image_view();
-    create_transfer_sampler();
+    VkDescriptorImageInfo image_info{
+        .sampler = sampler,
+        .imageView = color.image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    VkWriteDescriptorSet descriptor_write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = history_descriptor_sets[frame_index],
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &image_info,
+    };
+
+    vkUpdateDescriptorSets(
+        context->get_device(), 1, &descriptor_write, 0, nullptr);
 }
 
-void Vol::Rendering::OffscreenPass::create_transfer_image(
-    const std::vector<glm::uint32_t> &data)
+void Vol::Rendering::OffscreenPass::update_render_scale(uint32_t frame_index)
 {
-    VkDeviceSize size = sizeof(glm::uint32_t) * data.size();
+    // Frames that weren't timed have nothing to read back
+    float scale = timed_scales[frame_index];
+    timed_scales[frame_index] = 0.0f;
+    if (scale == 0.0f) {
+        return;
+    }
 
-    // Create staging buffer
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    create_buffer(
-        size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory);
+    std::optional<float> milliseconds =
+        context->get_profiler()->get_frame_time(GpuScope::Raymarch);
+    if (!milliseconds) {
+        return;
+    }
 
-    // Copy data to staging buffer
-    void *dst;
-    vkMapMemory(context->get_device(), staging_buffer_memory, 0, size, 0, &dst);
-    memcpy(dst, data.data(), static_cast<size_t>(size));
-    vkUnmapMemory(context->get_device(), staging_buffer_memory);
+    // Frames take about as long as their share of the image's pixels, so
+    // their time is scaled up to that of the full image
+    float cost = *milliseconds / (scale * scale);
+    frame_cost = frame_cost > 0.0f
+                     ? frame_cost + (cost - frame_cost) * frame_cost_smoothing
+                     : cost;
+
+    // Only change the scale once frames would leave the band around the
+    // target, so it doesn't oscillate
+    float frame_time = frame_cost * render_scale * render_scale;
+    if (frame_time < frame_time_target * frame_time_lower_bound ||
+        frame_time > frame_time_target * frame_time_upper_bound) {
+        float middle = frame_time_target *
+                       (frame_time_lower_bound + frame_time_upper_bound) /
+                       2.0f;
+        render_scale = std::clamp(
+            std::sqrt(middle / frame_cost), min_render_scale, 1.0f);
+    }
+}
 
-    // Create image
-    VkExtent3D extent = {
-        .width = static_cast<uint32_t>(data.size()),
-        .height = 1,
-        .depth = 1,
+void Vol::Rendering::OffscreenPass::finish_volume_upload(bool wait)
+{
+    if (!pending_upload) {
+        return;
+    }
+
+    // Feed the transfer queue, and have the graphics queue take the images
+    // over once every chunk has been copied
+    VolumeUpload &upload = *pending_upload;
+    submit_volume_transfers(upload, wait);
+    if (upload.transfers_completed < upload.transfer_command_buffers.size()) {
+        return;
+    }
+    if (upload.fence == VK_NULL_HANDLE) {
+        submit_volume_acquire(upload);
+    }
+
+    // Check if the upload has completed
+    if (wait) {
+        vkWaitForFences(
+            context->get_device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+    } else if (
+        vkGetFenceStatus(context->get_device(), upload.fence) != VK_SUCCESS) {
+        return;
+    }
+
+    release_volume_upload(upload);
+
+    // Swap volumes, frames in flight may still sample the old one
+    retire_volume(volume);
+    volume = upload.volume;
+    pending_upload.reset();
+
+    this->ubo.min_density = volume.min_density;
+    this->ubo.max_density = volume.max_density;
+    this->ubo.fallback_level = static_cast<float>(volume.fallback_level);
+    this->ubo.paged = volume.paging ? 1 : 0;
+    this->ubo.macrocell_grid = volume.macrocell_grid;
+    this->ubo.macrocell_extent = volume.macrocell_extent;
+    if (volume.paging) {
+        this->ubo.volume_size = glm::vec3(volume.paging->dimensions);
+        this->ubo.atlas_size = glm::vec3(
+            volume.paging->streamer->get_atlas_slots() * page_size);
+        this->ubo.page_grid = volume.paging->streamer->get_grid_dimensions();
+    }
+
+    update_descriptor_sets();
+
+    // Start the upload queued behind this one, and finish it too if waiting
+    if (queued_upload) {
+        VolumeUpload next = std::move(*queued_upload);
+        queued_upload.reset();
+        start_volume_upload(std::move(next));
+        if (wait) {
+            finish_volume_upload(true);
+        }
+    }
+}
+
+void Vol::Rendering::OffscreenPass::record_volume_transfer(
+    VolumeUpload &upload)
+{
+    Volume &volume = upload.volume;
+    VkExtent3D granularity = context->get_transfer_granularity();
+
+    // The last chunk signals the semaphore the graphics queue waits on
+    VkSemaphoreCreateInfo semaphore_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
     };
-    create_image(
-        VK_IMAGE_TYPE_1D, VK_FORMAT_R8G8B8A8_SRGB, extent,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, transfer_image,
-        transfer_image_memory);
+    if (vkCreateSemaphore(
+            context->get_device(), &semaphore_create_info, nullptr,
+            &upload.transferred) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create semaphore");
+    }
 
-    // Transition layout
+    // The first chunk prepares both images for copying
+    VkCommandBuffer command_buffer = context->begin_transfer_command();
+    VkDeviceSize chunk_size = 0;
+    transition_image_layout(
+        command_buffer, volume.image, volume.mip_levels,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
     transition_image_layout(
-        transfer_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED,
+        command_buffer, volume.macrocell_image, 1, VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-    // Copy buffer
-    copy_buffer_to_image(staging_buffer, transfer_image, extent);
+    auto end_chunk = [&]() {
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to end command buffer");
+        }
+        upload.transfer_command_buffers.push_back(command_buffer);
+        command_buffer = VK_NULL_HANDLE;
+        chunk_size = 0;
+    };
 
-    // Transition layout
-    transition_image_layout(
-        transfer_image, VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Images are copied in runs of whole slices, as many as fit into what is
+    // left of the chunk but at least one, in multiples of the granularity.
+    // Queues without one copy whole levels.
+    auto copy_slices = [&](VkImage image, uint32_t level, VkExtent3D extent,
+                           VkDeviceSize offset, size_t texel_size) {
+        VkDeviceSize slice_size =
+            static_cast<VkDeviceSize>(extent.width) * extent.height *
+            texel_size;
+
+        // Transfer queues only copy from buffer offsets that are multiples of
+        // 4, so runs of narrow texels also span enough slices to keep the
+        // next one aligned. Offsets of levels are aligned already.
+        uint32_t run_multiple = 1;
+        if (granularity.depth > 0) {
+            uint32_t aligned_slices = static_cast<uint32_t>(
+                4 / std::gcd(slice_size, VkDeviceSize(4)));
+            run_multiple = std::lcm(granularity.depth, aligned_slices);
+        }
+
+        for (uint32_t z = 0; z < extent.depth;) {
+            if (command_buffer == VK_NULL_HANDLE) {
+                command_buffer = context->begin_transfer_command();
+            }
+
+            uint32_t slices = extent.depth - z;
+            if (granularity.depth > 0) {
+                VkDeviceSize room =
+                    (volume_transfer_chunk_size -
+                     std::min(chunk_size, volume_transfer_chunk_size)) /
+                    slice_size;
+                VkDeviceSize fit =
+                    std::max<VkDeviceSize>(room / run_multiple, 1) *
+                    run_multiple;
+                slices = static_cast<uint32_t>(
+                    std::min<VkDeviceSize>(slices, fit));
+            }
+
+            copy_buffer_to_image(
+                command_buffer, upload.staging_buffer,
+                offset + z * slice_size, image, level,
+                VkExtent3D{extent.width, extent.height, slices}, z);
+            chunk_size += slices * slice_size;
+            z += slices;
+
+            if (chunk_size >= volume_transfer_chunk_size) {
+                end_chunk();
+            }
+        }
+    };
+
+    size_t texel_size = get_texel_size(volume.format);
+    for (uint32_t level = 0; level < volume.mip_levels; level++) {
+        VkExtent3D extent = {
+            .width = std::max(volume.extent.width >> level, 1u),
+            .height = std::max(volume.extent.height >> level, 1u),
+            .depth = std::max(volume.extent.depth >> level, 1u),
+        };
+        copy_slices(
+            volume.image, level, extent, upload.level_offsets[level],
+            texel_size);
+    }
+    copy_slices(
+        volume.macrocell_image, 0,
+        VkExtent3D{
+            .width = volume.macrocell_grid.x,
+            .height = volume.macrocell_grid.y,
+            .depth = volume.macrocell_grid.z,
+        },
+        upload.macrocell_offset, sizeof(glm::vec2));
 
-    // Destroy staging buffer
-    vkDestroyBuffer(context->get_device(), staging_buffer, nullptr);
-    vkFreeMemory(context->get_device(), staging_buffer_memory, nullptr);
+    // The last chunk releases both images to the graphics queue
+    if (command_buffer == VK_NULL_HANDLE) {
+        command_buffer = context->begin_transfer_command();
+    }
+    record_ownership_transfer(
+        command_buffer, volume.image, volume.mip_levels, false);
+    record_ownership_transfer(command_buffer, volume.macrocell_image, 1, false);
+    end_chunk();
 }
 
-void Vol::Rendering::OffscreenPass::create_transfer_image_view()
+void Vol::Rendering::OffscreenPass::submit_volume_transfers(
+    VolumeUpload &upload,
+    bool wait)
 {
-    VkImageViewCreateInfo create_info{
-        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .image = transfer_image,
-        .viewType = VK_IMAGE_VIEW_TYPE_1D,
-        .format = VK_FORMAT_R8G8B8A8_SRGB,
-        .subresourceRange =
-            VkImageSubresourceRange{
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            },
-    };
+    size_t count = upload.transfer_command_buffers.size();
+    while (true) {
+        // Keep a few chunks in flight, or all of them when waiting
+        while (upload.transfers_submitted < count &&
+               (wait || upload.transfers_submitted <
+                            upload.transfers_completed +
+                                volume_transfer_chunks_in_flight)) {
+            VkFenceCreateInfo fence_create_info = {
+                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            };
+            VkFence fence;
+            if (vkCreateFence(
+                    context->get_device(), &fence_create_info, nullptr,
+                    &fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create fence");
+            }
+            upload.transfer_fences.push_back(fence);
+
+            size_t index = upload.transfers_submitted;
+            VkSubmitInfo submit_info{
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                .commandBufferCount = 1,
+                .pCommandBuffers = &upload.transfer_command_buffers[index],
+                .signalSemaphoreCount = index + 1 == count ? 1u : 0u,
+                .pSignalSemaphores = &upload.transferred,
+            };
+            if (vkQueueSubmit(
+                    context->get_transfer_queue(), 1, &submit_info, fence) !=
+                VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to submit upload command buffer");
+            }
+            upload.transfers_submitted++;
+        }
+        if (upload.transfers_completed == count) {
+            return;
+        }
 
-    if (vkCreateImageView(
-            context->get_device(), &create_info, nullptr,
-            &transfer_image_view)) {
-        throw std::runtime_error("Failed to create image view");
+        // Chunks complete in the order they were submitted in
+        VkFence fence = upload.transfer_fences[upload.transfers_completed];
+        if (wait) {
+            vkWaitForFences(
+                context->get_device(), 1, &fence, VK_TRUE, UINT64_MAX);
+        } else if (
+            vkGetFenceStatus(context->get_device(), fence) != VK_SUCCESS) {
+            return;
+        }
+        upload.transfers_completed++;
     }
 }
 
-void Vol::Rendering::OffscreenPass::create_transfer_sampler()
+void Vol::Rendering::OffscreenPass::submit_volume_acquire(VolumeUpload &upload)
 {
-    VkSamplerCreateInfo create_info{
-        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-        .magFilter = VK_FILTER_LINEAR,
-        .minFilter = VK_FILTER_LINEAR,
-        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .mipLodBias = 0.0f,
-        .anisotropyEnable = VK_FALSE,
-        .maxAnisotropy = 0.0f,
-        .compareEnable = VK_FALSE,
-        .compareOp = VK_COMPARE_OP_ALWAYS,
-        .minLod = 0.0f,
-        .maxLod = 0.0f,
-        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
-        .unnormalizedCoordinates = VK_FALSE,
+    // The paging atlas is set up along with taking over the images
+    upload.command_buffer = context->begin_single_command();
+    if (upload.paged_dataset) {
+        create_volume_paging(
+            upload.command_buffer, upload.volume, upload.paged_dataset);
+    }
+    record_ownership_transfer(
+        upload.command_buffer, upload.volume.image, upload.volume.mip_levels,
+        true);
+    record_ownership_transfer(
+        upload.command_buffer, upload.volume.macrocell_image, 1, true);
+
+    if (vkEndCommandBuffer(upload.command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to end command buffer");
+    }
+
+    // Every chunk has completed, so the semaphore is signalled already and
+    // waiting on it never holds up the frames submitted after
+    VkFenceCreateInfo fence_create_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
     };
+    if (vkCreateFence(
+            context->get_device(), &fence_create_info, nullptr,
+            &upload.fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fence");
+    }
 
-    if (vkCreateSampler(
-            context->get_device(), &create_info, nullptr, &transfer_sampler) !=
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &upload.transferred,
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &upload.command_buffer,
+    };
+    if (vkQueueSubmit(
+            context->get_graphics_queue(), 1, &submit_info, upload.fence) !=
         VK_SUCCESS) {
-        throw std::runtime_error("Failed to create sampler");
+        throw std::runtime_error("Failed to submit upload command buffer");
     }
 }
 
-void Vol::Rendering::OffscreenPass::update_uniform_buffer(uint32_t frame_index)
+void Vol::Rendering::OffscreenPass::release_volume_upload(VolumeUpload &upload)
 {
-    float aspect = static_cast<float>(width) / static_cast<float>(height);
-    Vol::Scene::Camera &camera = Application::main().get_scene().get_camera();
-
-    // Convert to vulkan coordinate system
-    glm::mat4 coordinate_conversion =
-        glm::rotate(
-            glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
-        glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f));
+    for (VkFence fence : upload.transfer_fences) {
+        vkDestroyFence(context->get_device(), fence, nullptr);
+    }
+    vkFreeCommandBuffers(
+        context->get_device(), context->get_transfer_command_pool(),
+        static_cast<uint32_t>(upload.transfer_command_buffers.size()),
+        upload.transfer_command_buffers.data());
+    vkDestroySemaphore(context->get_device(), upload.transferred, nullptr);
+
+    vkDestroyFence(context->get_device(), upload.fence, nullptr);
+    vkFreeCommandBuffers(
+        context->get_device(), context->get_command_pool(), 1,
+        &upload.command_buffer);
+    discard_volume(upload);
+}
 
-    // Update uniform buffer object
-    this->ubo.view = camera.get_view();
-    this->ubo.proj =
-        glm::perspectiveRH(glm::radians(40.0f), aspect, 0.1f, 10.0f) *
-        coordinate_conversion;
-    this->ubo.camera_position = camera.get_position();
+void Vol::Rendering::OffscreenPass::retire_image()
+{
+    DeletionQueue *deletion_queue = context->get_deletion_queue();
+    for (FramebufferAttachment *attachment : {&color, &depth, &history}) {
+        deletion_queue->retire(attachment->image_view);
+        deletion_queue->retire(attachment->image, attachment->memory);
+    }
 
-    memcpy(uniform_buffers_mapped[frame_index], &ubo, sizeof(ubo));
+    deletion_queue->retire(framebuffer);
+    deletion_queue->retire(history_framebuffer);
+    deletion_queue->retire(sampler);
 }
 
-void Vol::Rendering::OffscreenPass::update_descriptor_sets()
+void Vol::Rendering::OffscreenPass::retire_volume(Volume &volume)
 {
-    // Write descriptor sets
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        // Uniform buffer
-        VkDescriptorBufferInfo buffer_info{
-            .buffer = uniform_buffers[i],
-            .offset = 0,
-            .range = sizeof(UniformBufferObject),
-        };
-
-        // Volume image
-        VkDescriptorImageInfo volume_image_info{
-            .sampler = volume_sampler,
-            .imageView = volume_image_view,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        };
+    DeletionQueue *deletion_queue = context->get_deletion_queue();
+    deletion_queue->retire(volume.sampler);
+    deletion_queue->retire(volume.image_view);
+    deletion_queue->retire(volume.image, volume.memory);
 
-        // Transfer image
-        VkDescriptorImageInfo transfer_image_info{
-            .sampler = transfer_sampler,
-            .imageView = transfer_image_view,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        };
+    deletion_queue->retire(volume.macrocell_image_view);
+    deletion_queue->retire(volume.macrocell_image, volume.macrocell_memory);
 
-        std::array<VkWriteDescriptorSet, 3> descriptor_writes{
-            VkWriteDescriptorSet{
-                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet = descriptor_sets[i],
-                .dstBinding = 0,
-                .dstArrayElement = 0,
-                .descriptorCount = 1,
-                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .pBufferInfo = &buffer_info,
-            },
-            VkWriteDescriptorSet{
-                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet = descriptor_sets[i],
-                .dstBinding = 1,
-                .dstArrayElement = 0,
-                .descriptorCount = 1,
-                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo = &volume_image_info,
-            },
-            VkWriteDescriptorSet{
-                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet = descriptor_sets[i],
-                .dstBinding = 2,
-                .dstArrayElement = 0,
-                .descriptorCount = 1,
-                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo = &transfer_image_info,
-            },
-        };
+    if (!volume.paging) {
+        return;
+    }
 
-        vkUpdateDescriptorSets(
-            context->get_device(),
-            static_cast<uint32_t>(descriptor_writes.size()),
-            descriptor_writes.data(), 0, nullptr);
+    // The streamer only reads pages on the host, so it goes right away once
+    // its reads into the staging buffers have stopped
+    PagedVolume &paging = *volume.paging;
+    deletion_queue->retire(paging.atlas_sampler);
+    deletion_queue->retire(paging.atlas_image_view);
+    deletion_queue->retire(paging.atlas_image, paging.atlas_memory);
+    for (size_t i = 0; i < paging.page_table_buffers.size(); i++) {
+        deletion_queue->retire(
+            paging.page_table_buffers[i], paging.page_table_buffers_memory[i]);
+        deletion_queue->retire(
+            paging.feedback_buffers[i], paging.feedback_buffers_memory[i]);
+        deletion_queue->retire(
+            paging.staging_buffers[i], paging.staging_buffers_memory[i]);
     }
+    volume.paging.reset();
 }
 
-void Vol::Rendering::OffscreenPass::destroy_image()
+void Vol::Rendering::OffscreenPass::retire_transfer()
 {
-    vkDestroyImageView(context->get_device(), color.image_view, nullptr);
-    vkDestroyImage(context->get_device(), color.image, nullptr);
-    vkFreeMemory(context->get_device(), color.memory, nullptr);
+    DeletionQueue *deletion_queue = context->get_deletion_queue();
+    deletion_queue->retire(transfer_sampler);
+    deletion_queue->retire(transfer_image_view);
+    deletion_queue->retire(transfer_image, transfer_image_memory);
 
-    vkDestroyImageView(context->get_device(), depth.image_view, nullptr);
-    vkDestroyImage(context->get_device(), depth.image, nullptr);
-    vkFreeMemory(context->get_device(), depth.memory, nullptr);
-
-    vkDestroyFramebuffer(context->get_device(), framebuffer, nullptr);
-    vkDestroySampler(context->get_device(), sampler, nullptr);
-}
-
-void Vol::Rendering::OffscreenPass::destroy_volume()
-{
-    vkDestroySampler(context->get_device(), volume_sampler, nullptr);
-    vkDestroyImageView(context->get_device(), volume_image_view, nullptr);
-    vkDestroyImage(context->get_device(), volume_image, nullptr);
-    vkFreeMemory(context->get_device(), volume_image_memory, nullptr);
+    deletion_queue->retire(visibility_image_view);
+    deletion_queue->retire(visibility_image, visibility_image_memory);
 }
 
-void Vol::Rendering::OffscreenPass::destroy_transfer()
+VkFormat Vol::Rendering::OffscreenPass::get_sampled_format(
+    Vol::Data::VoxelType type) const
 {
-    vkDestroySampler(context->get_device(), transfer_sampler, nullptr);
-    vkDestroyImageView(context->get_device(), transfer_image_view, nullptr);
-    vkDestroyImage(context->get_device(), transfer_image, nullptr);
-    vkFreeMemory(context->get_device(), transfer_image_memory, nullptr);
+    // Formats the device can't filter are widened to float
+    VkFormat format = get_volume_format(type);
+    if (!is_format_filterable(context->get_physical_device(), format)) {
+        return VK_FORMAT_R32_SFLOAT;
+    }
+    return format;
 }
 
 void Vol::Rendering::OffscreenPass::create_buffer(
     VkDeviceSize size,
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
+    MemoryCategory category,
     VkBuffer &buffer,
-    VkDeviceMemory &buffer_memory)
+    MemoryAllocation &buffer_memory)
 {
     // Define vertex buffer creation info
     VkBufferCreateInfo buffer_create_info = {
@@ -1284,47 +2968,29 @@ void Vol::Rendering::OffscreenPass::create_buffer(
         throw std::runtime_error("Failed to create buffer");
     }
 
-    // Get memory requirements
-    VkMemoryRequirements mem_requirements;
-    vkGetBufferMemoryRequirements(
-        context->get_device(), buffer, &mem_requirements);
-
-    // Define memory allocation information
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_requirements.size,
-        .memoryTypeIndex = find_memory_type(
-            context->get_physical_device(), mem_requirements.memoryTypeBits,
-            properties),
-    };
-
-    // Allocate memory
-    if (vkAllocateMemory(
-            context->get_device(), &alloc_info, nullptr, &buffer_memory) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory");
-    }
-
-    // Bind memory
-    vkBindBufferMemory(context->get_device(), buffer, buffer_memory, 0);
+    // Allocate and bind memory
+    buffer_memory = context->get_memory_allocator()->allocate_buffer(
+        buffer, properties, category);
 }
 
 void Vol::Rendering::OffscreenPass::create_image(
     VkImageType image_type,
     VkFormat format,
     VkExtent3D extent,
+    uint32_t mip_levels,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags properties,
+    MemoryCategory category,
     VkImage &image,
-    VkDeviceMemory &image_memory)
+    MemoryAllocation &image_memory)
 {
     VkImageCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = image_type,
         .format = format,
         .extent = extent,
-        .mipLevels = 1,
+        .mipLevels = mip_levels,
         .arrayLayers = 1,
         .samples = VK_SAMPLE_COUNT_1_BIT,
         .tiling = tiling,
@@ -1338,81 +3004,46 @@ void Vol::Rendering::OffscreenPass::create_image(
         throw std::runtime_error("Failed to create image");
     }
 
-    VkMemoryRequirements memory_requirements;
-    vkGetImageMemoryRequirements(
-        context->get_device(), image, &memory_requirements);
-
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memory_requirements.size,
-        .memoryTypeIndex = find_memory_type(
-            context->get_physical_device(), memory_requirements.memoryTypeBits,
-            properties),
-    };
-
-    if (vkAllocateMemory(
-            context->get_device(), &alloc_info, nullptr, &image_memory) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate memory");
-    }
-
-    vkBindImageMemory(context->get_device(), image, image_memory, 0);
-}
-
-void Vol::Rendering::OffscreenPass::copy_buffer(
-    VkBuffer src,
-    VkBuffer dst,
-    VkDeviceSize size)
-{
-    VkCommandBuffer command_buffer = context->begin_single_command();
-
-    VkBufferCopy copy_region = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = size,
-    };
-    vkCmdCopyBuffer(command_buffer, src, dst, 1, &copy_region);
-
-    context->end_single_command(command_buffer);
+    image_memory = context->get_memory_allocator()->allocate_image(
+        image, tiling, properties, category);
 }
 
 void Vol::Rendering::OffscreenPass::copy_buffer_to_image(
+    VkCommandBuffer command_buffer,
     VkBuffer src,
+    VkDeviceSize src_offset,
     VkImage dst,
-    VkExtent3D extent)
+    uint32_t mip_level,
+    VkExtent3D extent,
+    uint32_t first_slice)
 {
-    VkCommandBuffer command_buffer = context->begin_single_command();
-
     VkBufferImageCopy copy_region{
-        .bufferOffset = 0,
+        .bufferOffset = src_offset,
         .bufferRowLength = 0,
         .bufferImageHeight = 0,
         .imageSubresource =
             VkImageSubresourceLayers{
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .mipLevel = 0,
+                .mipLevel = mip_level,
                 .baseArrayLayer = 0,
                 .layerCount = 1,
             },
-        .imageOffset = {0, 0, 0},
+        .imageOffset = {0, 0, static_cast<int32_t>(first_slice)},
         .imageExtent = extent,
     };
 
     vkCmdCopyBufferToImage(
         command_buffer, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
         &copy_region);
-
-    context->end_single_command(command_buffer);
 }
 
 void Vol::Rendering::OffscreenPass::transition_image_layout(
+    VkCommandBuffer command_buffer,
     VkImage image,
-    VkFormat format,
+    uint32_t level_count,
     VkImageLayout old_layout,
     VkImageLayout new_layout)
 {
-    VkCommandBuffer command_buffer = context->begin_single_command();
-
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .srcAccessMask = 0,
@@ -1426,7 +3057,7 @@ void Vol::Rendering::OffscreenPass::transition_image_layout(
             VkImageSubresourceRange{
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
                 .baseMipLevel = 0,
-                .levelCount = 1,
+                .levelCount = level_count,
                 .baseArrayLayer = 0,
                 .layerCount = 1,
             },
@@ -1447,6 +3078,30 @@ void Vol::Rendering::OffscreenPass::transition_image_layout(
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
+        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else if (
+        old_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
+        new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        src_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (
+        old_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
+        new_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        src_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (
+        old_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL &&
+        new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
         src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     } else {
@@ -1456,29 +3111,57 @@ void Vol::Rendering::OffscreenPass::transition_image_layout(
     vkCmdPipelineBarrier(
         command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1,
         &barrier);
-
-    context->end_single_command(command_buffer);
 }
 
-uint32_t get_memory_type_index(
-    Vol::Rendering::VulkanContext *context,
-    uint32_t type_bits,
-    VkMemoryPropertyFlags properties)
+void Vol::Rendering::OffscreenPass::record_ownership_transfer(
+    VkCommandBuffer command_buffer,
+    VkImage image,
+    uint32_t level_count,
+    bool acquire)
 {
-    VkPhysicalDeviceMemoryProperties device_memory_properties;
-    vkGetPhysicalDeviceMemoryProperties(
-        context->get_physical_device(), &device_memory_properties);
-
-    for (uint32_t i = 0; i < device_memory_properties.memoryTypeCount; i++) {
-        if ((type_bits & 1) == 1) {
-            if ((device_memory_properties.memoryTypes[i].propertyFlags &
-                 properties) == properties) {
-                return i;
-            }
+    if (!context->has_transfer_queue()) {
+        if (!acquire) {
+            transition_image_layout(
+                command_buffer, image, level_count,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         }
-        type_bits >>= 1;
+        return;
+    }
+
+    // Both halves name the same layouts and families. The release makes the
+    // copies available, the acquire makes them visible to shaders, chained
+    // to the semaphore wait by its source stage.
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = 0,
+        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = context->get_transfer_family(),
+        .dstQueueFamilyIndex = context->get_graphics_family(),
+        .image = image,
+        .subresourceRange =
+            VkImageSubresourceRange{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = level_count,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    VkPipelineStageFlags src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    if (acquire) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        src_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
-    return 0;
+    vkCmdPipelineBarrier(
+        command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1,
+        &barrier);
 }
 
 VkBool32 get_supported_depth_format(
@@ -1546,21 +3229,81 @@ VkShaderModule create_shader_module(
     return shader_module;
 }
 
-uint32_t find_memory_type(
-    VkPhysicalDevice physical_device,
-    uint32_t type_filter,
-    VkMemoryPropertyFlags properties)
+VkFormat get_volume_format(Vol::Data::VoxelType type)
+{
+    switch (type) {
+        case Vol::Data::VoxelType::UInt8: return VK_FORMAT_R8_UNORM;
+        case Vol::Data::VoxelType::Int8: return VK_FORMAT_R8_SNORM;
+        case Vol::Data::VoxelType::UInt16: return VK_FORMAT_R16_UNORM;
+        case Vol::Data::VoxelType::Int16: return VK_FORMAT_R16_SNORM;
+        case Vol::Data::VoxelType::Float16: return VK_FORMAT_R16_SFLOAT;
+        case Vol::Data::VoxelType::Float32: return VK_FORMAT_R32_SFLOAT;
+    }
+    throw std::invalid_argument("Unsupported voxel type");
+}
+
+bool is_format_filterable(VkPhysicalDevice physical_device, VkFormat format)
+{
+    VkFormatProperties format_props;
+    vkGetPhysicalDeviceFormatProperties(
+        physical_device, format, &format_props);
+
+    VkFormatFeatureFlags required_features =
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (format_props.optimalTilingFeatures & required_features) ==
+           required_features;
+}
+
+float normalize_density(VkFormat format, float value)
+{
+    switch (format) {
+        case VK_FORMAT_R8_UNORM: return value / 255.0f;
+        case VK_FORMAT_R8_SNORM: return std::max(value / 127.0f, -1.0f);
+        case VK_FORMAT_R16_UNORM: return value / 65535.0f;
+        case VK_FORMAT_R16_SNORM: return std::max(value / 32767.0f, -1.0f);
+        default: return value;
+    }
+}
+
+size_t get_texel_size(VkFormat format)
 {
-    VkPhysicalDeviceMemoryProperties memory_props;
-    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_props);
+    switch (format) {
+        case VK_FORMAT_R8_UNORM: return 1;
+        case VK_FORMAT_R8_SNORM: return 1;
+        case VK_FORMAT_R16_UNORM: return 2;
+        case VK_FORMAT_R16_SNORM: return 2;
+        case VK_FORMAT_R16_SFLOAT: return 2;
+        case VK_FORMAT_R32_SFLOAT: return 4;
+        default: break;
+    }
+    throw std::invalid_argument("Unsupported volume format");
+}
 
-    for (uint32_t i = 0; i < memory_props.memoryTypeCount; i++) {
-        if (type_filter & (1 << i) &&
-            (memory_props.memoryTypes[i].propertyFlags & properties) ==
-                properties) {
-            return i;
+VkDeviceSize get_device_local_memory(VkPhysicalDevice physical_device)
+{
+    // Largest device local heap, which integrated devices share with the host
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+    VkDeviceSize size = 0;
+    for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++) {
+        const VkMemoryHeap &heap = memory_properties.memoryHeaps[i];
+        if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            size = std::max(size, heap.size);
         }
     }
+    return size;
+}
 
-    throw std::runtime_error("Failed to find suitable memory type");
+float get_halton(uint32_t index, uint32_t base)
+{
+    float result = 0.0f;
+    float fraction = 1.0f;
+    while (index > 0) {
+        fraction /= base;
+        result += fraction * (index % base);
+        index /= base;
+    }
+    return result;
 }
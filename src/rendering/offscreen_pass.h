@@ -1,17 +1,27 @@
 #pragma once
 
+#include "rendering/memory_allocator.h"
+
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 namespace Vol::Data
 {
 struct Dataset;
+class Histogram;
+enum class VoxelType;
 }
 
 namespace Vol::Rendering
 {
+class PageStreamer;
 class VulkanContext;
 }
 
@@ -20,20 +30,119 @@ namespace Vol::Rendering
 struct FramebufferAttachment {
     VkFormat format;
     VkImage image = VK_NULL_HANDLE;
-    VkDeviceMemory memory = VK_NULL_HANDLE;
+    MemoryAllocation memory;
+    VkImageView image_view = VK_NULL_HANDLE;
+};
+
+// The finest level of a volume too large for the device, streamed page by
+// page into an atlas. Every frame in flight has its own copy of the page table,
+// a buffer the shader marks the pages it samples in, and staging for pages.
+struct PagedVolume {
+    std::unique_ptr<PageStreamer> streamer;
+    glm::u32vec3 dimensions;
+    VkImage atlas_image = VK_NULL_HANDLE;
+    MemoryAllocation atlas_memory;
+    VkImageView atlas_image_view = VK_NULL_HANDLE;
+    VkSampler atlas_sampler = VK_NULL_HANDLE;
+    std::vector<VkBuffer> page_table_buffers;
+    std::vector<MemoryAllocation> page_table_buffers_memory;
+    std::vector<void *> page_table_buffers_mapped;
+    std::vector<VkBuffer> feedback_buffers;
+    std::vector<MemoryAllocation> feedback_buffers_memory;
+    std::vector<void *> feedback_buffers_mapped;
+    std::vector<VkBuffer> staging_buffers;
+    std::vector<MemoryAllocation> staging_buffers_memory;
+    std::vector<void *> staging_buffers_mapped;
+};
+
+struct Volume {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {};
+    uint32_t mip_levels = 1;
+    VkImage image = VK_NULL_HANDLE;
+    MemoryAllocation memory;
     VkImageView image_view = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    float min_density = 0.0f;
+    float max_density = 1.0f;
+    std::shared_ptr<const Vol::Data::Histogram> histogram;
+
+    // Level of detail the image starts at, finer levels are paged
+    uint32_t fallback_level = 0;
+    std::shared_ptr<PagedVolume> paging;
+
+    // Density range of every macrocell, which rays leap over wherever the
+    // transfer function leaves the whole range invisible. The extent is that
+    // of a cell in texture coordinates.
+    glm::u32vec3 macrocell_grid = glm::u32vec3(1);
+    glm::vec3 macrocell_extent = glm::vec3(1.0f);
+    VkImage macrocell_image = VK_NULL_HANDLE;
+    MemoryAllocation macrocell_memory;
+    VkImageView macrocell_image_view = VK_NULL_HANDLE;
+};
+
+// A volume on its way to the device. Staging only touches the device, so it
+// may run on any thread, submission happens on the render thread.
+// Submission copies the volume in chunks of slices on the transfer queue,
+// fed to it a few at a time, and the last hands the images over to the
+// graphics queue by signalling the semaphore.
+struct VolumeUpload {
+    Volume volume;
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    MemoryAllocation staging_buffer_memory;
+    std::vector<VkDeviceSize> level_offsets;
+    VkDeviceSize macrocell_offset = 0;
+    std::shared_ptr<const Vol::Data::Dataset> paged_dataset;
+    std::vector<VkCommandBuffer> transfer_command_buffers;
+    std::vector<VkFence> transfer_fences;
+    size_t transfers_submitted = 0;
+    size_t transfers_completed = 0;
+    VkSemaphore transferred = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+};
+
+// Image of a frame copied to the host, as rows of RGBA from the top
+struct FrameCapture {
+    uint64_t id;
+    uint32_t width, height;
+    std::vector<uint8_t> pixels;
 };
 
 class OffscreenPass {
   private:
+    // Host visible buffer a frame in flight copies its image into, along
+    // with the capture it is read into once the frame has completed
+    struct CaptureBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory;
+        VkDeviceSize size = 0;
+        std::optional<FrameCapture> capture;
+    };
+
     struct UniformBufferObject {
         alignas(16) glm::mat4 view;
         alignas(16) glm::mat4 proj;
         alignas(16) glm::vec3 camera_position;
         alignas(4) float min_density;
         alignas(4) float max_density;
+        alignas(4) float lod = 0.0f;
         alignas(16) glm::vec3 min_slice = glm::vec3(0.0f);
         alignas(16) glm::vec3 max_slice = glm::vec3(1.0f);
+        alignas(16) glm::vec3 volume_size = glm::vec3(1.0f);
+        alignas(4) float fallback_level = 0.0f;
+        alignas(16) glm::vec3 atlas_size = glm::vec3(1.0f);
+        alignas(4) uint32_t paged = 0;
+        alignas(16) glm::uvec3 page_grid = glm::uvec3(1);
+        alignas(4) float min_transmittance = 0.01f;
+        alignas(16) glm::uvec3 macrocell_grid = glm::uvec3(1);
+        alignas(16) glm::vec3 macrocell_extent = glm::vec3(1.0f);
+        alignas(4) float step_size = 0.005f;
+        alignas(4) float opacity_correction = 1.0f;
+
+        // Compares the fields, the alignment padding between them is never
+        // written and holds whatever the memory did before
+        bool operator==(const UniformBufferObject &) const = default;
     };
 
   public:
@@ -45,105 +154,283 @@ class OffscreenPass {
 
     void record(VkCommandBuffer command_buffer, uint32_t frame_index);
 
-    void framebuffer_size_changed(uint32_t width, uint32_t height);
-    void volume_dataset_changed(Vol::Data::Dataset &dataset);
+    // Returns whether the attachments were recreated, they only grow and
+    // smaller sizes render into a corner of them
+    bool framebuffer_size_changed(uint32_t width, uint32_t height);
+    void volume_dataset_changed(const Vol::Data::Dataset &dataset);
     void slicing_changed(const glm::vec3 &min, const glm::vec3 &max);
+    void ray_termination_changed(float min_transmittance);
+    void sampling_rate_changed(float samples_per_voxel);
+    void frame_time_target_changed(float milliseconds);
+
+    // Without adaptive quality every frame is rendered in full, at the full
+    // resolution and detail, which is what benchmarks compare
+    void adaptive_quality_changed(bool enabled);
     void transfer_function_changed(const std::vector<glm::uint32_t> &data);
 
+    // Volumes that don't fit on the device are paged, the dataset is kept
+    // to stream their finest level from
+    VolumeUpload stage_volume(
+        std::shared_ptr<const Vol::Data::Dataset> dataset,
+        std::atomic<float> *progress = nullptr);
+    void submit_volume(VolumeUpload upload);
+    void discard_volume(VolumeUpload &upload);
+
+    bool fits_on_device(const Vol::Data::Dataset &dataset) const;
+
+    inline bool is_uploading() const
+    {
+        return pending_upload.has_value() || queued_upload.has_value();
+    }
+
+    // Fraction of the pending upload's chunks copied on the device
+    float get_upload_progress() const;
+
+    // Whether the last frame recorded still copied pages into the atlas or
+    // had pages being read for it, so its image isn't final yet
+    inline bool is_streaming() const { return streaming; }
+
+    // Whether the volume is too large for the device and pages in its
+    // finest level
+    inline bool is_paged() const { return volume.paging != nullptr; }
+
+    // Pixels of the last frame rendered as rows of RGBA from the top, which
+    // waits for the device to finish it
+    std::vector<uint8_t> read_image();
+
+    inline glm::u32vec2 get_size() const { return {width, height}; }
+
+    // The next frame recorded copies its image into a buffer of its slot,
+    // which is read back once the slot's fence has been waited on again, so
+    // capturing never stalls the device
+    void capture_next_frame(uint64_t id);
+
+    // Frames read back since last asked, waiting reads back those still in
+    // flight as well
+    std::vector<FrameCapture> take_captures(bool wait = false);
+
+    // Histogram of the volume being rendered, if it has one
+    inline std::shared_ptr<const Vol::Data::Histogram> get_histogram() const
+    {
+        return volume.histogram;
+    }
+
+    inline std::pair<glm::vec3, glm::vec3> get_slicing() const
+    {
+        return {ubo.min_slice, ubo.max_slice};
+    }
+
     inline VkSampler get_sampler() const { return sampler; }
-    inline VkImageView get_image_view() const { return color.image_view; }
+    inline VkImageView get_image_view() const { return history.image_view; }
+
+    // Corner of the image the viewport is shown in, in texture coordinates
+    inline glm::vec2 get_image_region() const
+    {
+        return glm::vec2(width, height) /
+               glm::vec2(image_width, image_height);
+    }
 
   private:
     void create_color_attachment();
     void create_depth_attachment();
+    void create_history_attachment();
     void create_render_pass();
+    void create_history_render_pass();
     void create_framebuffer();
+    void create_history_framebuffer();
     void create_descriptor_set_layout();
+    void create_history_descriptor_set_layout();
     void create_pipeline();
+    void create_history_pipeline();
     void create_vertex_buffer();
     void create_index_buffer();
     void create_uniform_buffers();
+    void create_empty_buffer();
     void create_descriptor_pool();
     void create_descriptor_sets();
-    void create_volume(Vol::Data::Dataset &dataset);
-    void create_volume_image(Vol::Data::Dataset &dataset);
-    void create_volume_image_view();
-    void create_volume_sampler();
+    void create_history_descriptor_sets();
+    void create_volume_image_view(Volume &volume);
+    void create_volume_sampler(Volume &volume);
+    void create_macrocell_image_view(Volume &volume);
+    void create_macrocell_sampler();
+    void create_volume_paging(
+        VkCommandBuffer command_buffer,
+        Volume &volume,
+        std::shared_ptr<const Vol::Data::Dataset> dataset);
     void create_transfer(const std::vector<glm::uint32_t> &data);
     void create_transfer_image(const std::vector<glm::uint32_t> &data);
     void create_transfer_image_view();
     void create_transfer_sampler();
+    void create_visibility_image(const std::vector<glm::uint32_t> &data);
+    void create_visibility_image_view();
+
+    // Returns whether any page was copied into the atlas
+    bool stream_pages(VkCommandBuffer command_buffer, uint32_t frame_index);
 
     void update_uniform_buffer(uint32_t frame_index);
     void update_descriptor_sets();
+    void update_descriptor_set(uint32_t frame_index);
+    void update_history_descriptor_set(uint32_t frame_index);
+
+    void record_image_copy(VkCommandBuffer command_buffer, VkBuffer buffer);
+    void record_capture(VkCommandBuffer command_buffer, uint32_t frame_index);
+    void read_capture(uint32_t frame_index);
+
+    // Sets the render scale from the time the frame took when it was last
+    // recorded, as read back by the profiler
+    void update_render_scale(uint32_t frame_index);
+
+    void start_volume_upload(VolumeUpload upload);
+
+    // Swaps in the pending upload once it has completed, which frames check
+    // for without waiting, then starts the queued one
+    void finish_volume_upload(bool wait);
+    void record_volume_transfer(VolumeUpload &upload);
+    void submit_volume_transfers(VolumeUpload &upload, bool wait);
+    void submit_volume_acquire(VolumeUpload &upload);
+    void release_volume_upload(VolumeUpload &upload);
+
+    // Hand resources frames in flight may still use to the deletion queue
+    void retire_image();
+    void retire_volume(Volume &volume);
+    void retire_transfer();
 
-    void destroy_image();
-    void destroy_volume();
-    void destroy_transfer();
+    VkFormat get_sampled_format(Vol::Data::VoxelType type) const;
 
     void create_buffer(
         VkDeviceSize size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
+        MemoryCategory category,
         VkBuffer &buffer,
-        VkDeviceMemory &buffer_memory);
+        MemoryAllocation &buffer_memory);
 
     void create_image(
         VkImageType image_type,
         VkFormat format,
         VkExtent3D extent,
+        uint32_t mip_levels,
         VkImageTiling tiling,
         VkImageUsageFlags usage,
         VkMemoryPropertyFlags properties,
+        MemoryCategory category,
         VkImage &image,
-        VkDeviceMemory &image_memory);
+        MemoryAllocation &image_memory);
 
-    void copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
-    void copy_buffer_to_image(VkBuffer src, VkImage dst, VkExtent3D extent);
+    void copy_buffer_to_image(
+        VkCommandBuffer command_buffer,
+        VkBuffer src,
+        VkDeviceSize src_offset,
+        VkImage dst,
+        uint32_t mip_level,
+        VkExtent3D extent,
+        uint32_t first_slice = 0);
+
+    // Hands an image written on the transfer queue over to the graphics
+    // queue, in the shader read layout. Without a transfer family only the
+    // release is recorded, as a plain layout transition.
+    void record_ownership_transfer(
+        VkCommandBuffer command_buffer,
+        VkImage image,
+        uint32_t level_count,
+        bool acquire);
 
     void transition_image_layout(
+        VkCommandBuffer command_buffer,
         VkImage image,
-        VkFormat format,
+        uint32_t level_count,
         VkImageLayout old_layout,
         VkImageLayout new_layout);
 
   private:
     VulkanContext *context;
     uint32_t width, height;
+    uint32_t image_width, image_height;
     VkFramebuffer framebuffer = VK_NULL_HANDLE;
     FramebufferAttachment color{}, depth{};
     VkSampler sampler = VK_NULL_HANDLE;
     VkRenderPass render_pass = VK_NULL_HANDLE;
 
+    // Frames are raymarched into a corner of the color attachment, at a lower
+    // resolution while the camera moves, and blended into the history that is
+    // displayed. Once the camera rests, frames jittered within their pixels
+    // are averaged into the history until it has converged.
+    FramebufferAttachment history{.format = VK_FORMAT_R16G16B16A16_SFLOAT};
+    VkFramebuffer history_framebuffer = VK_NULL_HANDLE;
+    VkRenderPass history_render_pass = VK_NULL_HANDLE;
+    VkDescriptorSetLayout history_descriptor_set_layout = VK_NULL_HANDLE;
+    VkDescriptorPool history_descriptor_pool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> history_descriptor_sets;
+    VkPipelineLayout history_pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline history_pipeline = VK_NULL_HANDLE;
+    uint32_t accumulated_samples = 0;
+
+    // Frames while the camera moves are rendered at the scale that keeps their
+    // time on the GPU near the target. Every frame in flight keeps the scale
+    // it was rendered at until the profiler reads back its time.
+    std::vector<float> timed_scales;
+    bool adaptive_quality = true;
+    float frame_time_target = 16.6f;
+    float frame_cost = 0.0f;
+    float render_scale = 1.0f;
+
     VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
     VkPipeline graphics_pipeline = VK_NULL_HANDLE;
 
     VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
     VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
     std::vector<VkDescriptorSet> descriptor_sets;
+    std::vector<bool> descriptor_sets_dirty;
 
     VkBuffer vertex_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory vertex_buffer_memory = VK_NULL_HANDLE;
+    MemoryAllocation vertex_buffer_memory;
     VkBuffer index_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory index_buffer_memory = VK_NULL_HANDLE;
+    MemoryAllocation index_buffer_memory;
 
     std::vector<VkBuffer> uniform_buffers;
-    std::vector<VkDeviceMemory> uniform_buffers_memory;
+    std::vector<MemoryAllocation> uniform_buffers_memory;
     std::vector<void *> uniform_buffers_mapped;
 
+    // Bound in place of the page table and feedback of volumes not paged
+    VkBuffer empty_buffer = VK_NULL_HANDLE;
+    MemoryAllocation empty_buffer_memory;
+
     UniformBufferObject ubo;
 
-    VkImage volume_image = VK_NULL_HANDLE;
-    VkDeviceMemory volume_image_memory = VK_NULL_HANDLE;
-    VkImageView volume_image_view = VK_NULL_HANDLE;
-    VkSampler volume_sampler = VK_NULL_HANDLE;
+    // Frames only render the volume when something that goes into the image
+    // has changed since it was last rendered, otherwise they keep the image
+    bool redraw = true;
+    bool streaming = false;
+
+    std::vector<CaptureBuffer> capture_buffers;
+    std::optional<uint64_t> next_capture;
+    std::vector<FrameCapture> captures;
+    UniformBufferObject rendered_ubo;
+
+    glm::mat4 last_view = glm::mat4(1.0f);
+    std::chrono::steady_clock::time_point last_camera_motion;
+
+    Volume volume;
+    std::optional<VolumeUpload> pending_upload;
+    std::optional<VolumeUpload> queued_upload;
 
     VkImage transfer_image = VK_NULL_HANDLE;
-    VkDeviceMemory transfer_image_memory = VK_NULL_HANDLE;
+    MemoryAllocation transfer_image_memory;
     VkImageView transfer_image_view = VK_NULL_HANDLE;
     VkSampler transfer_sampler = VK_NULL_HANDLE;
 
+    // Highest opacity of the transfer function between every pair of its
+    // texels, which tells the shader whether a macrocell is visible
+    VkImage visibility_image = VK_NULL_HANDLE;
+    MemoryAllocation visibility_image_memory;
+    VkImageView visibility_image_view = VK_NULL_HANDLE;
+
+    // Macrocells and visibility are fetched texel by texel, never filtered
+    VkSampler macrocell_sampler = VK_NULL_HANDLE;
+
     float min_density = 0.0f;
     float max_density = 255.0f;
+
+    float samples_per_voxel = 1.0f;
 };
 }  // namespace Vol::Rendering
\ No newline at end of file
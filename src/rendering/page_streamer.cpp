@@ -0,0 +1,206 @@
+#include "page_streamer.h"
+
+#include "application.h"
+#include "core/thread_pool.h"
+#include "data/dataset.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+// Page of a slot no page has been streamed into yet
+const uint32_t no_page = std::numeric_limits<uint32_t>::max();
+
+Vol::Rendering::PageStreamer::PageStreamer(
+    std::shared_ptr<const Data::Dataset> dataset,
+    bool widen,
+    glm::u32vec3 atlas_slots,
+    uint32_t staging_count)
+    : dataset(std::move(dataset)), widen(widen), atlas_slots(atlas_slots),
+      reads(staging_count)
+{
+    grid_dimensions = get_page_grid_dimensions(this->dataset->dimensions);
+    page_table.resize(
+        static_cast<size_t>(grid_dimensions.x) * grid_dimensions.y *
+        grid_dimensions.z);
+    loading.resize(page_table.size());
+    slots.resize(
+        static_cast<size_t>(atlas_slots.x) * atlas_slots.y * atlas_slots.z,
+        Slot{.page = no_page, .last_used = 0});
+}
+
+Vol::Rendering::PageStreamer::~PageStreamer()
+{
+    cancelled = true;
+    for (Read &read : reads) {
+        if (read.done.valid()) {
+            read.done.wait();
+        }
+    }
+}
+
+std::vector<Vol::Rendering::PageUpload> Vol::Rendering::PageStreamer::update(
+    std::span<const uint32_t> feedback,
+    uint32_t staging_index,
+    std::byte *staging,
+    size_t budget)
+{
+    frame++;
+
+    // Pages the frame sampled stay resident, the missing ones are requested
+    // unless they are being read already
+    std::vector<uint32_t> requested;
+    for (uint32_t page = 0; page < feedback.size(); page++) {
+        if (!feedback[page]) {
+            continue;
+        }
+        uint32_t entry = page_table[page];
+        if (entry & page_resident) {
+            uint32_t x = entry & 0x3FF;
+            uint32_t y = (entry >> 10) & 0x3FF;
+            uint32_t z = (entry >> 20) & 0x3FF;
+            slots[(z * atlas_slots.y + y) * atlas_slots.x + x].last_used =
+                frame;
+        } else if (!loading[page]) {
+            requested.push_back(page);
+        }
+    }
+
+    // Pages read into the staging buffer are handed over once the read has
+    // finished. The frame copies them out of it, so nothing else is read
+    // into it until the frame comes around again.
+    Read &read = reads[staging_index];
+    if (read.done.valid()) {
+        if (read.done.wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready) {
+            return {};
+        }
+
+        // Slots of a failed read are left empty
+        try {
+            read.done.get();
+        } catch (...) {
+            for (size_t i = 0; i < read.pages.size(); i++) {
+                loading[read.pages[i]] = false;
+                slots[read.slots[i]].page = no_page;
+            }
+            throw;
+        }
+        for (size_t i = 0; i < read.pages.size(); i++) {
+            glm::u32vec3 position = read.uploads[i].slot;
+            page_table[read.pages[i]] = page_resident | position.x |
+                                        (position.y << 10) |
+                                        (position.z << 20);
+            loading[read.pages[i]] = false;
+            slots[read.slots[i]].last_used = frame;
+        }
+        read.pages.clear();
+        read.slots.clear();
+        return std::exchange(read.uploads, {});
+    }
+
+    // Slots are only ranked when there are pages to find them for
+    if (requested.empty()) {
+        return {};
+    }
+
+    // Empty slots are taken first, then the least recently used, but never
+    // one the frame sampled or one a page is being read into
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < slots.size(); i++) {
+        if (slots[i].last_used < frame &&
+            (slots[i].page == no_page || !loading[slots[i].page])) {
+            order.push_back(i);
+        }
+    }
+    size_t count = std::min(
+        {requested.size(), budget / get_page_bytes(), order.size()});
+    if (count == 0) {
+        return {};
+    }
+    std::partial_sort(
+        order.begin(), order.begin() + count, order.end(),
+        [&](uint32_t a, uint32_t b) {
+            return slots[a].last_used < slots[b].last_used;
+        });
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = order[i];
+        Slot &slot = slots[index];
+        if (slot.page != no_page) {
+            page_table[slot.page] = 0;
+        }
+        slot = Slot{.page = requested[i], .last_used = frame};
+        loading[requested[i]] = true;
+
+        read.pages.push_back(requested[i]);
+        read.slots.push_back(index);
+        read.uploads.push_back(PageUpload{
+            .offset = i * get_page_bytes(),
+            .slot = glm::u32vec3(
+                index % atlas_slots.x, index / atlas_slots.x % atlas_slots.y,
+                index / (atlas_slots.x * atlas_slots.y)),
+        });
+    }
+
+    // Read the pages across the pool in the background, each straight into
+    // the staging buffer. The read is only touched again once it is done.
+    Core::ThreadPool &thread_pool = Application::main().get_thread_pool();
+    read.done = thread_pool.submit([this, &read, &thread_pool, staging]() {
+        thread_pool.parallel_for(
+            read.pages.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end && !cancelled; i++) {
+                    read_page(read.pages[i], staging + read.uploads[i].offset);
+                }
+            });
+    });
+
+    return {};
+}
+
+bool Vol::Rendering::PageStreamer::is_reading() const
+{
+    return std::any_of(reads.begin(), reads.end(), [](const Read &read) {
+        return read.done.valid();
+    });
+}
+
+size_t Vol::Rendering::PageStreamer::get_page_bytes() const
+{
+    size_t voxel_size =
+        widen ? sizeof(float) : Data::get_voxel_size(dataset->type);
+    return static_cast<size_t>(page_size) * page_size * page_size *
+           voxel_size;
+}
+
+void Vol::Rendering::PageStreamer::read_page(
+    uint32_t page,
+    std::byte *dst) const
+{
+    glm::u32vec3 position(
+        page % grid_dimensions.x, page / grid_dimensions.x % grid_dimensions.y,
+        page / (grid_dimensions.x * grid_dimensions.y));
+    glm::ivec3 origin =
+        glm::ivec3(position * page_content_size) - glm::ivec3(1);
+    glm::u32vec3 extent(page_size);
+
+    if (!widen) {
+        dataset->read_region(origin, extent, dst);
+        return;
+    }
+
+    thread_local std::vector<std::byte> voxels;
+    size_t count = static_cast<size_t>(page_size) * page_size * page_size;
+    voxels.resize(count * Data::get_voxel_size(dataset->type));
+    dataset->read_region(origin, extent, voxels.data());
+    Data::widen_to_float(
+        voxels.data(), reinterpret_cast<float *>(dst), count, dataset->type);
+}
+
+glm::u32vec3 Vol::Rendering::get_page_grid_dimensions(
+    glm::u32vec3 volume_dimensions)
+{
+    glm::u32vec3 size(page_content_size);
+    return (volume_dimensions + size - glm::u32vec3(1)) / size;
+}
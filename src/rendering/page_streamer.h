@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Vol::Data
+{
+struct Dataset;
+}  // namespace Vol::Data
+
+namespace Vol::Rendering
+{
+// Edge length of the pages a volume too large for the device is streamed in,
+// in voxels. Pages overlap their neighbours by a voxel on every side, so
+// filtering never reads across into an unrelated slot of the atlas.
+const uint32_t page_size = 64;
+const uint32_t page_content_size = page_size - 2;
+
+// Set in the page table entry of a page resident in the atlas, whose slot is
+// packed into the low 30 bits, 10 bits per axis starting with x
+const uint32_t page_resident = 1u << 31;
+
+// A page read into the staging buffer, to be copied into a slot of the atlas
+struct PageUpload {
+    size_t offset;
+    glm::u32vec3 slot;
+};
+
+// Keeps the pages of the finest level of a volume that rendering samples in a
+// fixed number of atlas slots, evicting the least recently used. Pages are
+// read on the thread pool into the staging buffer of a frame, and are only
+// handed over to be copied into the atlas once that frame comes around again.
+class PageStreamer {
+  public:
+    // Pages are widened to float if the atlas can't filter the voxel type.
+    // Each of the staging buffers has a read of its own in flight.
+    PageStreamer(
+        std::shared_ptr<const Data::Dataset> dataset,
+        bool widen,
+        glm::u32vec3 atlas_slots,
+        uint32_t staging_count);
+
+    // Waits for the reads in flight, which skip the pages they have left
+    ~PageStreamer();
+
+    PageStreamer(const PageStreamer &) = delete;
+    PageStreamer &operator=(const PageStreamer &) = delete;
+
+    // Marks the pages a frame sampled as used, then hands over the pages
+    // read into the staging buffer, marking them resident. If none were
+    // being read into it, as many of the missing pages as fit in the budget
+    // are given a slot and read into it in the background instead.
+    std::vector<PageUpload> update(
+        std::span<const uint32_t> feedback,
+        uint32_t staging_index,
+        std::byte *staging,
+        size_t budget);
+
+    // Whether pages are still being read or wait to be handed over
+    bool is_reading() const;
+
+    inline const std::vector<uint32_t> &get_page_table() const
+    {
+        return page_table;
+    }
+    inline glm::u32vec3 get_grid_dimensions() const { return grid_dimensions; }
+    inline glm::u32vec3 get_atlas_slots() const { return atlas_slots; }
+
+    // Bytes of a page as stored in the atlas
+    size_t get_page_bytes() const;
+
+  private:
+    struct Slot {
+        uint32_t page;
+        uint64_t last_used;
+    };
+
+    struct Read {
+        std::vector<uint32_t> pages;
+        std::vector<uint32_t> slots;
+        std::vector<PageUpload> uploads;
+        std::future<void> done;
+    };
+
+    void read_page(uint32_t page, std::byte *dst) const;
+
+  private:
+    std::shared_ptr<const Data::Dataset> dataset;
+    bool widen;
+    glm::u32vec3 grid_dimensions;
+    glm::u32vec3 atlas_slots;
+    std::vector<uint32_t> page_table;
+    std::vector<Slot> slots;
+    uint64_t frame = 0;
+
+    // Pages given a slot whose read hasn't been handed over yet
+    std::vector<bool> loading;
+    std::vector<Read> reads;
+    std::atomic<bool> cancelled = false;
+};
+
+// Number of pages along each axis of a volume
+glm::u32vec3 get_page_grid_dimensions(glm::u32vec3 volume_dimensions);
+}  // namespace Vol::Rendering
\ No newline at end of file
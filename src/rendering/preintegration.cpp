@@ -0,0 +1,84 @@
+#include "preintegration.h"
+
+#include "core/thread_pool.h"
+#include "data/dataset.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Opacities are capped just short of opaque, so their extinction stays finite
+const float max_opacity = 1.0f - 1.0f / 1024.0f;
+
+// Rows of the table every task of the pool integrates
+const size_t preintegration_grain = 16;
+
+float srgb_to_linear(float value);
+
+std::vector<uint16_t> Vol::Rendering::preintegrate_transfer_function(
+    const std::vector<uint32_t> &data,
+    Core::ThreadPool *thread_pool)
+{
+    size_t count = data.size();
+
+    // Extinction weighted color and extinction of every texel
+    std::vector<glm::vec4> texels(count);
+    for (size_t i = 0; i < count; i++) {
+        float alpha =
+            std::min(static_cast<float>(data[i] >> 24) / 255.0f, max_opacity);
+        float extinction = -std::log(1.0f - alpha);
+        float red = srgb_to_linear((data[i] & 0xFF) / 255.0f);
+        float green = srgb_to_linear(((data[i] >> 8) & 0xFF) / 255.0f);
+        float blue = srgb_to_linear(((data[i] >> 16) & 0xFF) / 255.0f);
+        texels[i] = glm::vec4(
+            red * extinction, green * extinction, blue * extinction,
+            extinction);
+    }
+
+    // Running integrals from the first texel, with the transfer function
+    // linear in between texels. Any segment is then the difference of two.
+    std::vector<glm::vec4> integrals(count);
+    for (size_t i = 1; i < count; i++) {
+        integrals[i] = integrals[i - 1] + (texels[i - 1] + texels[i]) * 0.5f;
+    }
+
+    // Average every segment, rows are independent so fill them across the pool
+    std::vector<uint16_t> table(count * count * 4);
+    auto integrate_rows = [&](size_t begin, size_t end) {
+        for (size_t back = begin; back < end; back++) {
+            for (size_t front = 0; front < count; front++) {
+                glm::vec4 average = texels[front];
+                if (front != back) {
+                    average = (integrals[back] - integrals[front]) /
+                              (static_cast<float>(back) -
+                               static_cast<float>(front));
+                }
+
+                // The shader weighs colors by the opacity of the step it
+                // took, so the extinction weight is divided out again
+                float weight = average.w > 0.0f ? 1.0f / average.w : 0.0f;
+                uint16_t *entry = &table[(back * count + front) * 4];
+                entry[0] = Data::float_to_half(average.x * weight);
+                entry[1] = Data::float_to_half(average.y * weight);
+                entry[2] = Data::float_to_half(average.z * weight);
+                entry[3] = Data::float_to_half(average.w);
+            }
+        }
+    };
+    if (thread_pool) {
+        thread_pool->parallel_for(count, preintegration_grain, integrate_rows);
+    } else {
+        integrate_rows(0, count);
+    }
+
+    return table;
+}
+
+float srgb_to_linear(float value)
+{
+    if (value <= 0.04045f) {
+        return value / 12.92f;
+    }
+    return std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
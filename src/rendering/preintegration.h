@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Vol::Core
+{
+class ThreadPool;
+}  // namespace Vol::Core
+
+namespace Vol::Rendering
+{
+// Integrates a transfer function of RGBA8 sRGB texels, whose opacities are
+// per voxel, over every segment between a front and a back texel. Entries
+// hold the linear color weighted by extinction and the extinction per voxel,
+// both averaged over the segment, as half floats. Front texels run along
+// rows, back texels down columns. Rows are spread across the pool, without
+// one the calling thread integrates them all.
+std::vector<uint16_t> preintegrate_transfer_function(
+    const std::vector<uint32_t> &data,
+    Core::ThreadPool *thread_pool = nullptr);
+}  // namespace Vol::Rendering
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "upload_manager.h"
+
+#include "rendering/gpu_profiler.h"
+#include "rendering/vulkan_context.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+Vol::Rendering::UploadManager::UploadManager(VulkanContext *context)
+    : context(context)
+{
+    // Copies start at offsets aligned for any texel size and as the device
+    // prefers
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->get_physical_device(), &properties);
+    alignment = std::max(
+        alignment, properties.limits.optimalBufferCopyOffsetAlignment);
+
+    // Create ring buffer
+    VkBufferCreateInfo buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = upload_ring_size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    if (vkCreateBuffer(
+            context->get_device(), &buffer_create_info, nullptr, &ring) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create buffer");
+    }
+
+    // Allocate memory, mapped for as long as the ring lives
+    ring_memory = context->get_memory_allocator()->allocate_buffer(
+        ring,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        MemoryCategory::Staging);
+    ring_mapped = static_cast<std::byte *>(ring_memory.mapped);
+}
+
+Vol::Rendering::UploadManager::~UploadManager()
+{
+    wait();
+
+    vkDestroyBuffer(context->get_device(), ring, nullptr);
+    context->get_memory_allocator()->free(ring_memory);
+}
+
+void Vol::Rendering::UploadManager::upload_buffer(
+    VkBuffer dst,
+    VkDeviceSize dst_offset,
+    const void *data,
+    VkDeviceSize size)
+{
+    const std::byte *src = static_cast<const std::byte *>(data);
+    while (size > 0) {
+        VkDeviceSize chunk = std::min(size, upload_ring_size);
+        VkDeviceSize offset = allocate(chunk);
+        std::memcpy(ring_mapped + offset, src, chunk);
+
+        VkBufferCopy copy_region = {
+            .srcOffset = offset,
+            .dstOffset = dst_offset,
+            .size = chunk,
+        };
+        vkCmdCopyBuffer(get_command_buffer(), ring, dst, 1, &copy_region);
+
+        src += chunk;
+        dst_offset += chunk;
+        size -= chunk;
+    }
+}
+
+void Vol::Rendering::UploadManager::upload_image(
+    VkImage dst,
+    VkExtent3D extent,
+    size_t texel_size,
+    const void *data)
+{
+    VkDeviceSize row_size = static_cast<VkDeviceSize>(extent.width) *
+                            texel_size;
+    VkDeviceSize slice_size = row_size * extent.height;
+    if (row_size > upload_ring_size) {
+        throw std::runtime_error("Failed to fit image row in upload ring");
+    }
+
+    // Chunks are runs of whole slices, or of whole rows of one slice if a
+    // slice alone doesn't fit into the ring
+    const std::byte *src = static_cast<const std::byte *>(data);
+    for (uint32_t z = 0; z < extent.depth;) {
+        if (slice_size <= upload_ring_size) {
+            uint32_t slices = static_cast<uint32_t>(std::min<VkDeviceSize>(
+                extent.depth - z, upload_ring_size / slice_size));
+            copy_to_image(
+                dst, VkOffset3D{0, 0, static_cast<int32_t>(z)},
+                VkExtent3D{extent.width, extent.height, slices},
+                src + z * slice_size, slices * slice_size);
+            z += slices;
+            continue;
+        }
+
+        for (uint32_t y = 0; y < extent.height;) {
+            uint32_t rows = static_cast<uint32_t>(std::min<VkDeviceSize>(
+                extent.height - y, upload_ring_size / row_size));
+            copy_to_image(
+                dst,
+                VkOffset3D{
+                    0, static_cast<int32_t>(y), static_cast<int32_t>(z)},
+                VkExtent3D{extent.width, rows, 1},
+                src + z * slice_size + y * row_size, rows * row_size);
+            y += rows;
+        }
+        z++;
+    }
+}
+
+VkCommandBuffer Vol::Rendering::UploadManager::get_command_buffer()
+{
+    if (recording) {
+        return recording->command_buffer;
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = context->get_command_pool(),
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer command_buffer;
+    if (vkAllocateCommandBuffers(
+            context->get_device(), &alloc_info, &command_buffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffers");
+    }
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin command buffer");
+    }
+
+    recording = Batch{
+        .command_buffer = command_buffer,
+        .fence = VK_NULL_HANDLE,
+        .ring_bytes = 0,
+        .query = context->get_profiler()->begin_batch(
+            command_buffer, GpuScope::Uploads),
+    };
+    return command_buffer;
+}
+
+void Vol::Rendering::UploadManager::flush()
+{
+    // Release the batches that have completed since the last flush
+    while (!in_flight.empty() &&
+           vkGetFenceStatus(context->get_device(), in_flight.front().fence) ==
+               VK_SUCCESS) {
+        release(in_flight.front());
+        in_flight.pop_front();
+    }
+
+    if (!recording) {
+        return;
+    }
+
+    // Copied data is visible to whatever reads it in later submissions
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                         VK_ACCESS_INDEX_READ_BIT |
+                         VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        recording->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+    if (recording->query) {
+        context->get_profiler()->end_batch(
+            recording->command_buffer, *recording->query);
+    }
+
+    if (vkEndCommandBuffer(recording->command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to end command buffer");
+    }
+
+    // Submit without waiting, the fence tells when the ring space is free
+    VkFenceCreateInfo fence_create_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    };
+    if (vkCreateFence(
+            context->get_device(), &fence_create_info, nullptr,
+            &recording->fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fence");
+    }
+
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &recording->command_buffer,
+    };
+    if (vkQueueSubmit(
+            context->get_graphics_queue(), 1, &submit_info,
+            recording->fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload command buffer");
+    }
+
+    in_flight.push_back(*recording);
+    recording.reset();
+}
+
+void Vol::Rendering::UploadManager::wait()
+{
+    flush();
+
+    for (const Batch &batch : in_flight) {
+        vkWaitForFences(
+            context->get_device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        release(batch);
+    }
+    in_flight.clear();
+}
+
+VkDeviceSize Vol::Rendering::UploadManager::allocate(VkDeviceSize size)
+{
+    while (true) {
+        if (std::optional<VkDeviceSize> offset = try_allocate(size)) {
+            return *offset;
+        }
+
+        // The batch being recorded holds the rest of the ring if none is in
+        // flight, so it is submitted to be waited on
+        if (in_flight.empty()) {
+            flush();
+        }
+
+        const Batch &oldest = in_flight.front();
+        vkWaitForFences(
+            context->get_device(), 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+        release(oldest);
+        in_flight.pop_front();
+    }
+}
+
+std::optional<VkDeviceSize> Vol::Rendering::UploadManager::try_allocate(
+    VkDeviceSize size)
+{
+    // Free space runs from the head to the end of the ring and on from its
+    // start to the tail, or only up to the tail once the head has wrapped
+    VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+    if (head >= tail && used < upload_ring_size) {
+        if (offset + size > upload_ring_size) {
+            if (size > tail) {
+                return std::nullopt;
+            }
+            offset = 0;
+        }
+    } else if (offset + size > tail) {
+        return std::nullopt;
+    }
+
+    // Bytes skipped for alignment or at the end of the ring are released
+    // along with the region
+    VkDeviceSize consumed = offset >= head
+                                ? offset + size - head
+                                : upload_ring_size - head + size;
+    head = offset + size;
+    used += consumed;
+
+    get_command_buffer();
+    recording->ring_bytes += consumed;
+    return offset;
+}
+
+void Vol::Rendering::UploadManager::copy_to_image(
+    VkImage dst,
+    VkOffset3D offset,
+    VkExtent3D extent,
+    const std::byte *src,
+    VkDeviceSize size)
+{
+    VkDeviceSize ring_offset = allocate(size);
+    std::memcpy(ring_mapped + ring_offset, src, size);
+
+    VkBufferImageCopy copy_region{
+        .bufferOffset = ring_offset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            VkImageSubresourceLayers{
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset = offset,
+        .imageExtent = extent,
+    };
+
+    vkCmdCopyBufferToImage(
+        get_command_buffer(), ring, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &copy_region);
+}
+
+void Vol::Rendering::UploadManager::release(const Batch &batch)
+{
+    if (batch.query) {
+        context->get_profiler()->read_batch(*batch.query);
+    }
+    vkDestroyFence(context->get_device(), batch.fence, nullptr);
+    vkFreeCommandBuffers(
+        context->get_device(), context->get_command_pool(), 1,
+        &batch.command_buffer);
+
+    used -= batch.ring_bytes;
+    tail = (tail + batch.ring_bytes) % upload_ring_size;
+    if (used == 0) {
+        head = 0;
+        tail = 0;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "rendering/memory_allocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace Vol::Rendering
+{
+class VulkanContext;
+}
+
+namespace Vol::Rendering
+{
+// Size of the ring every upload is staged in, larger uploads are split into
+// chunks that each fit
+const VkDeviceSize upload_ring_size = 64ull << 20;
+
+// Stages uploads in one persistently mapped ring buffer and records their
+// copies into a shared command buffer, submitted as a single batch once per
+// frame. Every batch is tracked with a fence of its own, so its part of the
+// ring is reused as soon as the fence signals rather than after the queue
+// goes idle.
+class UploadManager {
+  public:
+    explicit UploadManager(VulkanContext *context);
+    ~UploadManager();
+
+    // Copies data into a buffer, ordered before any later submission reads
+    // it
+    void upload_buffer(
+        VkBuffer dst,
+        VkDeviceSize dst_offset,
+        const void *data,
+        VkDeviceSize size);
+
+    // Copies tightly packed texels into the first mip level of an image in
+    // the transfer destination layout. A full ring submits the batch, so the
+    // command buffer is asked for again after every upload.
+    void upload_image(
+        VkImage dst,
+        VkExtent3D extent,
+        size_t texel_size,
+        const void *data);
+
+    // Command buffer of the batch being recorded, for commands that must
+    // run along with its copies
+    VkCommandBuffer get_command_buffer();
+
+    // Submits the batch recorded since the last flush without waiting, and
+    // releases the ring space of batches that have completed
+    void flush();
+
+    // Waits for every batch submitted so far
+    void wait();
+
+  private:
+    struct Batch {
+        VkCommandBuffer command_buffer;
+        VkFence fence;
+        VkDeviceSize ring_bytes;
+
+        // Queries timing the batch as part of the uploads scope
+        std::optional<uint32_t> query;
+    };
+
+    // Offset of a region of the ring, waiting for older batches or flushing
+    // the one being recorded until there is room
+    VkDeviceSize allocate(VkDeviceSize size);
+    std::optional<VkDeviceSize> try_allocate(VkDeviceSize size);
+    void copy_to_image(
+        VkImage dst,
+        VkOffset3D offset,
+        VkExtent3D extent,
+        const std::byte *src,
+        VkDeviceSize size);
+    void release(const Batch &batch);
+
+  private:
+    VulkanContext *context;
+    VkBuffer ring = VK_NULL_HANDLE;
+    MemoryAllocation ring_memory;
+    std::byte *ring_mapped = nullptr;
+    VkDeviceSize alignment = 16;
+
+    // Bytes are handed out at the head and released at the tail, in the
+    // order batches were submitted in
+    VkDeviceSize head = 0;
+    VkDeviceSize tail = 0;
+    VkDeviceSize used = 0;
+
+    std::optional<Batch> recording;
+    std::deque<Batch> in_flight;
+};
+}  // namespace Vol::Rendering
\ No newline at end of file
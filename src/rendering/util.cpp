@@ -14,8 +14,9 @@ Vol::Rendering::QueueFamilyIndices Vol::Rendering::get_queue_families(
     vkGetPhysicalDeviceQueueFamilyProperties(
         device, &queue_count, queue_props.data());
 
-    // Scan queues
+    // Scan queues, without a surface there is nothing to present to
     Vol::Rendering::QueueFamilyIndices queue_indices{};
+    bool headless = surface == VK_NULL_HANDLE;
 
     for (size_t i = 0; i < queue_count; i++) {
         // Check queue for graphics support
@@ -25,7 +26,7 @@ Vol::Rendering::QueueFamilyIndices Vol::Rendering::get_queue_families(
         }
 
         // Check queue for presentation support
-        if (!queue_indices.presentation) {
+        if (!headless && !queue_indices.presentation) {
             VkBool32 present_support;
             vkGetPhysicalDeviceSurfaceSupportKHR(
                 device, i, surface, &present_support);
@@ -34,15 +35,25 @@ Vol::Rendering::QueueFamilyIndices Vol::Rendering::get_queue_families(
             }
         }
 
-        if (queue_indices.is_complete()) {
+        if (queue_indices.is_complete(headless)) {
             break;
         }
     }
 
-    if (!queue_indices.is_complete()) {
+    if (!queue_indices.is_complete(headless)) {
         throw std::runtime_error("Failed to find all required queues");
     }
 
+    // Look for a transfer family that can neither draw nor compute
+    for (size_t i = 0; i < queue_count; i++) {
+        VkQueueFlags flags = queue_props[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+            !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            queue_indices.transfer = i;
+            break;
+        }
+    }
+
     return queue_indices;
 }
 
@@ -77,3 +88,22 @@ Vol::Rendering::SwapChainSupportDetails Vol::Rendering::get_swap_chain_support(
 
     return support_details;
 }
+
+uint32_t Vol::Rendering::find_memory_type(
+    VkPhysicalDevice physical_device,
+    uint32_t type_filter,
+    VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memory_props;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_props);
+
+    for (uint32_t i = 0; i < memory_props.memoryTypeCount; i++) {
+        if (type_filter & (1 << i) &&
+            (memory_props.memoryTypes[i].propertyFlags & properties) ==
+                properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type");
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 
 #include <optional>
@@ -7,11 +8,22 @@
 
 namespace Vol::Rendering
 {
+// Color the offscreen image is cleared to, which volumes are blended over
+const glm::vec4 background_color = glm::vec4(0.11f, 0.11f, 0.11f, 1.0f);
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphics;
     std::optional<uint32_t> presentation;
 
-    bool is_complete() const { return graphics && presentation; }
+    // Family that only transfers, if the device has one, which copies
+    // alongside rendering rather than competing with it
+    std::optional<uint32_t> transfer;
+
+    // Headless contexts have no surface, so they only need graphics
+    bool is_complete(bool headless = false) const
+    {
+        return graphics && (headless || presentation);
+    }
 };
 
 struct SwapChainSupportDetails {
@@ -27,4 +39,9 @@ QueueFamilyIndices get_queue_families(
 SwapChainSupportDetails get_swap_chain_support(
     VkPhysicalDevice device,
     VkSurfaceKHR surface);
+
+uint32_t find_memory_type(
+    VkPhysicalDevice physical_device,
+    uint32_t type_filter,
+    VkMemoryPropertyFlags properties);
 }  // namespace Vol::Rendering
\ No newline at end of file
@@ -1,7 +1,12 @@
 #include "vulkan_context.h"
 
+#include "rendering/deletion_queue.h"
+#include "rendering/gpu_profiler.h"
+#include "rendering/headless_pass.h"
 #include "rendering/main_pass.h"
+#include "rendering/memory_allocator.h"
 #include "rendering/offscreen_pass.h"
+#include "rendering/upload_manager.h"
 #include "rendering/util.h"
 
 #include <SDL3/SDL.h>
@@ -39,6 +44,8 @@ std::optional<unsigned int> get_physical_device_ranking(
 
 bool is_physical_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface);
 
+VkCommandBuffer begin_command(VkDevice device, VkCommandPool command_pool);
+
 Vol::Rendering::VulkanContext::VulkanContext(SDL_Window *window)
     : window(window)
 {
@@ -47,55 +54,61 @@ Vol::Rendering::VulkanContext::VulkanContext(SDL_Window *window)
     select_physical_device();
     create_device();
     create_command_pool();
-    main_pass = new MainPass(this);
+    memory_allocator = new MemoryAllocator(this);
+    deletion_queue = new DeletionQueue(this);
+    profiler = new GpuProfiler(this);
+    upload_manager = new UploadManager(this);
+    if (is_headless()) {
+        headless_pass = new HeadlessPass(this);
+    } else {
+        main_pass = new MainPass(this);
+    }
     offscreen_pass = new OffscreenPass(this, 100, 100);
 }
 
 Vol::Rendering::VulkanContext::~VulkanContext()
 {
+    // Uploads still being recorded may refer to resources of the passes
+    delete upload_manager;
     delete offscreen_pass;
+    delete headless_pass;
     delete main_pass;
+    delete profiler;
+    delete deletion_queue;
+    delete memory_allocator;
+    if (has_transfer_queue()) {
+        vkDestroyCommandPool(device, transfer_command_pool, nullptr);
+    }
     vkDestroyCommandPool(device, command_pool, nullptr);
     vkDestroyDevice(device, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 }
 
 void Vol::Rendering::VulkanContext::render()
 {
-    main_pass->render();
+    if (is_headless()) {
+        headless_pass->render();
+    } else {
+        main_pass->render();
+    }
 }
 
 void Vol::Rendering::VulkanContext::wait_till_idle()
 {
+    // Uploads not yet submitted are waited on along with the rest
+    upload_manager->flush();
     vkDeviceWaitIdle(device);
+
+    // Nothing retired is in use any more
+    deletion_queue->flush();
 }
 
 VkCommandBuffer Vol::Rendering::VulkanContext::begin_single_command()
 {
-    VkCommandBufferAllocateInfo alloc_info{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-
-    VkCommandBuffer command_buffer;
-    if (vkAllocateCommandBuffers(device, &alloc_info, &command_buffer) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers");
-    }
-
-    VkCommandBufferBeginInfo begin_info{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-
-    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to begin command buffer");
-    }
-
-    return command_buffer;
+    return begin_command(device, command_pool);
 }
 
 void Vol::Rendering::VulkanContext::end_single_command(
@@ -117,6 +130,11 @@ void Vol::Rendering::VulkanContext::end_single_command(
     vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
 }
 
+VkCommandBuffer Vol::Rendering::VulkanContext::begin_transfer_command()
+{
+    return begin_command(device, transfer_command_pool);
+}
+
 void Vol::Rendering::VulkanContext::create_instance()
 {
     // Check validation layers
@@ -134,12 +152,16 @@ void Vol::Rendering::VulkanContext::create_instance()
         .apiVersion = VK_API_VERSION_1_0,
     };
 
-    // Query and retrieve required extensions
-    unsigned int extension_count;
-    SDL_Vulkan_GetInstanceExtensions(&extension_count, nullptr);
+    // Query and retrieve required extensions, headless contexts need none
+    // to present with
+    std::vector<const char *> extensions;
+    if (!is_headless()) {
+        unsigned int extension_count;
+        SDL_Vulkan_GetInstanceExtensions(&extension_count, nullptr);
 
-    std::vector<const char *> extensions(extension_count);
-    SDL_Vulkan_GetInstanceExtensions(&extension_count, extensions.data());
+        extensions.resize(extension_count);
+        SDL_Vulkan_GetInstanceExtensions(&extension_count, extensions.data());
+    }
 
     // Define instance creation information
     VkInstanceCreateInfo create_info = {
@@ -163,6 +185,10 @@ void Vol::Rendering::VulkanContext::create_instance()
 
 void Vol::Rendering::VulkanContext::create_surface()
 {
+    if (is_headless()) {
+        return;
+    }
+
     if (!SDL_Vulkan_CreateSurface(window, instance, &surface)) {
         throw std::runtime_error("Failed to create surface");
     }
@@ -212,10 +238,13 @@ void Vol::Rendering::VulkanContext::create_device()
 
     // Define queue creation informations
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-    std::set<uint32_t> unique_queue_indices = {
-        *queue_indices.graphics,
-        *queue_indices.presentation,
-    };
+    std::set<uint32_t> unique_queue_indices = {*queue_indices.graphics};
+    if (queue_indices.presentation) {
+        unique_queue_indices.insert(*queue_indices.presentation);
+    }
+    if (queue_indices.transfer) {
+        unique_queue_indices.insert(*queue_indices.transfer);
+    }
 
     float queue_priorities = 1.0f;
     for (uint32_t queue_index : unique_queue_indices) {
@@ -232,6 +261,12 @@ void Vol::Rendering::VulkanContext::create_device()
     VkPhysicalDeviceFeatures device_features;
     vkGetPhysicalDeviceFeatures(physical_device, &device_features);
 
+    // Swap chains are only needed to present with
+    std::vector<const char *> device_extensions;
+    if (!is_headless()) {
+        device_extensions = required_physical_device_extensions;
+    }
+
     // Define device creation information
     VkDeviceCreateInfo device_create_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
@@ -241,8 +276,8 @@ void Vol::Rendering::VulkanContext::create_device()
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = nullptr,
         .enabledExtensionCount =
-            static_cast<uint32_t>(required_physical_device_extensions.size()),
-        .ppEnabledExtensionNames = required_physical_device_extensions.data(),
+            static_cast<uint32_t>(device_extensions.size()),
+        .ppEnabledExtensionNames = device_extensions.data(),
         .pEnabledFeatures = &device_features,
     };
 
@@ -261,7 +296,27 @@ void Vol::Rendering::VulkanContext::create_device()
 
     // Get queues
     vkGetDeviceQueue(device, *queue_indices.graphics, 0, &graphics_queue);
-    vkGetDeviceQueue(device, *queue_indices.presentation, 0, &present_queue);
+    if (queue_indices.presentation) {
+        vkGetDeviceQueue(
+            device, *queue_indices.presentation, 0, &present_queue);
+    }
+    graphics_family = *queue_indices.graphics;
+
+    // Copies fall back to the graphics queue without a transfer family
+    transfer_family = queue_indices.transfer.value_or(graphics_family);
+    transfer_queue = graphics_queue;
+    if (queue_indices.transfer) {
+        vkGetDeviceQueue(device, transfer_family, 0, &transfer_queue);
+
+        uint32_t family_count;
+        vkGetPhysicalDeviceQueueFamilyProperties(
+            physical_device, &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> family_props(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(
+            physical_device, &family_count, family_props.data());
+        transfer_granularity =
+            family_props[transfer_family].minImageTransferGranularity;
+    }
 }
 
 void Vol::Rendering::VulkanContext::create_command_pool()
@@ -281,6 +336,17 @@ void Vol::Rendering::VulkanContext::create_command_pool()
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create command pool");
     }
+
+    // The transfer family needs a pool of its own
+    transfer_command_pool = command_pool;
+    if (has_transfer_queue()) {
+        create_info.queueFamilyIndex = transfer_family;
+        if (vkCreateCommandPool(
+                device, &create_info, nullptr, &transfer_command_pool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create command pool");
+        }
+    }
 }
 
 bool validation_layers_supported()
@@ -339,7 +405,9 @@ std::optional<unsigned int> get_physical_device_ranking(
 bool is_physical_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
     // Check device support required queue families
-    if (!Vol::Rendering::get_queue_families(device, surface).is_complete()) {
+    bool headless = surface == VK_NULL_HANDLE;
+    if (!Vol::Rendering::get_queue_families(device, surface)
+             .is_complete(headless)) {
         return false;
     }
 
@@ -351,9 +419,12 @@ bool is_physical_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface)
     vkEnumerateDeviceExtensionProperties(
         device, nullptr, &extension_count, extensions_props.data());
 
-    std::set<std::string> required_extensions(
-        required_physical_device_extensions.begin(),
-        required_physical_device_extensions.end());
+    std::set<std::string> required_extensions;
+    if (!headless) {
+        required_extensions.insert(
+            required_physical_device_extensions.begin(),
+            required_physical_device_extensions.end());
+    }
 
     for (const auto &extension_props : extensions_props) {
         required_extensions.erase(extension_props.extensionName);
@@ -363,7 +434,17 @@ bool is_physical_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface)
         return false;
     }
 
+    // The volume shader reports the pages it samples from the fragment stage
+    VkPhysicalDeviceFeatures device_features;
+    vkGetPhysicalDeviceFeatures(device, &device_features);
+    if (!device_features.fragmentStoresAndAtomics) {
+        return false;
+    }
+
     // Check swap chain support
+    if (headless) {
+        return true;
+    }
     Vol::Rendering::SwapChainSupportDetails swap_chain_support =
         Vol::Rendering::get_swap_chain_support(device, surface);
     if (swap_chain_support.formats.empty() ||
@@ -373,3 +454,30 @@ bool is_physical_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 
     return true;
 }
+
+VkCommandBuffer begin_command(VkDevice device, VkCommandPool command_pool)
+{
+    VkCommandBufferAllocateInfo alloc_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer command_buffer;
+    if (vkAllocateCommandBuffers(device, &alloc_info, &command_buffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffers");
+    }
+
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin command buffer");
+    }
+
+    return command_buffer;
+}
@@ -8,14 +8,21 @@ struct SDL_Window;
 
 namespace Vol::Rendering
 {
+class DeletionQueue;
+class GpuProfiler;
+class HeadlessPass;
 class MainPass;
+class MemoryAllocator;
 class OffscreenPass;
+class UploadManager;
 }  // namespace Vol::Rendering
 
 namespace Vol::Rendering
 {
 constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
+// Without a window the context is headless, it has no surface or swap chain
+// and only renders the offscreen pass
 class VulkanContext {
   public:
     explicit VulkanContext(SDL_Window *window);
@@ -26,6 +33,10 @@ class VulkanContext {
     VkCommandBuffer begin_single_command();
     void end_single_command(VkCommandBuffer command_buffer);
 
+    // Command buffer for the transfer queue, submitted and freed by the
+    // caller
+    VkCommandBuffer begin_transfer_command();
+
     inline VkInstance get_instance() const { return instance; }
     inline VkSurfaceKHR get_surface() const { return surface; }
     inline SDL_Window *const get_window() const { return window; }
@@ -37,9 +48,48 @@ class VulkanContext {
     inline VkQueue get_graphics_queue() const { return graphics_queue; }
     inline VkQueue get_present_queue() const { return present_queue; }
     inline VkCommandPool get_command_pool() const { return command_pool; }
+    inline uint32_t get_graphics_family() const { return graphics_family; }
+
+    // Without a transfer-only family the transfer queue is the graphics
+    // queue, and its pool the graphics pool
+    inline VkQueue get_transfer_queue() const { return transfer_queue; }
+    inline VkCommandPool get_transfer_command_pool() const
+    {
+        return transfer_command_pool;
+    }
+    inline uint32_t get_transfer_family() const { return transfer_family; }
+    inline bool has_transfer_queue() const
+    {
+        return transfer_family != graphics_family;
+    }
+
+    // Granularity image copies on the transfer queue are made in, zero if
+    // only whole mip levels may be copied
+    inline VkExtent3D get_transfer_granularity() const
+    {
+        return transfer_granularity;
+    }
+    inline bool is_headless() const { return window == nullptr; }
 
     inline MainPass *const get_main_pass() const { return main_pass; }
+    inline HeadlessPass *const get_headless_pass() const
+    {
+        return headless_pass;
+    }
     inline OffscreenPass *const get_offscreen_pass() { return offscreen_pass; }
+    inline GpuProfiler *const get_profiler() { return profiler; }
+    inline MemoryAllocator *const get_memory_allocator()
+    {
+        return memory_allocator;
+    }
+    inline DeletionQueue *const get_deletion_queue()
+    {
+        return deletion_queue;
+    }
+    inline UploadManager *const get_upload_manager()
+    {
+        return upload_manager;
+    }
 
   private:
     void create_instance();
@@ -50,7 +100,12 @@ class VulkanContext {
 
   private:
     SDL_Window *window;
-    MainPass *main_pass;
+    GpuProfiler *profiler;
+    MemoryAllocator *memory_allocator;
+    DeletionQueue *deletion_queue;
+    UploadManager *upload_manager;
+    MainPass *main_pass = nullptr;
+    HeadlessPass *headless_pass = nullptr;
     OffscreenPass *offscreen_pass;
     VkInstance instance = VK_NULL_HANDLE;
     VkSurfaceKHR surface = VK_NULL_HANDLE;
@@ -59,5 +114,10 @@ class VulkanContext {
     VkQueue graphics_queue = VK_NULL_HANDLE;
     VkQueue present_queue = VK_NULL_HANDLE;
     VkCommandPool command_pool = VK_NULL_HANDLE;
+    uint32_t graphics_family = 0;
+    VkQueue transfer_queue = VK_NULL_HANDLE;
+    VkCommandPool transfer_command_pool = VK_NULL_HANDLE;
+    uint32_t transfer_family = 0;
+    VkExtent3D transfer_granularity = {1, 1, 1};
 };
 }  // namespace Vol::Rendering
\ No newline at end of file
@@ -45,4 +45,23 @@ glm::mat4 Vol::Scene::Camera::get_view() const
     glm::mat4 rotation = glm::transpose(glm::mat4_cast(orientation));
 
     return rotation * translation;
+}
+
+glm::mat4 Vol::Scene::Camera::get_projection(float aspect) const
+{
+    // Convert to vulkan coordinate system
+    glm::mat4 coordinate_conversion =
+        glm::rotate(
+            glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
+        glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f));
+
+    return glm::perspectiveRH(
+               glm::radians(field_of_view), aspect, 0.1f, 10.0f) *
+           coordinate_conversion;
+}
+
+void Vol::Scene::Camera::set_pose(const glm::quat &orientation, float radius)
+{
+    this->orientation = orientation;
+    this->radius = std::clamp(radius, 0.1f, 10.0f);
 }
\ No newline at end of file
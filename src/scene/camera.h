@@ -6,6 +6,9 @@
 
 namespace Vol::Scene
 {
+// Vertical field of view of the camera, in degrees
+const float field_of_view = 40.0f;
+
 class Camera {
   public:
     explicit Camera();
@@ -16,6 +19,16 @@ class Camera {
     glm::vec3 get_position() const;
     glm::mat4 get_view() const;
 
+    // Projection into vulkan's clip space, which volumes are rendered with
+    // whether on the device or the CPU
+    glm::mat4 get_projection(float aspect) const;
+
+    // Orientation around the center and distance from it, which camera paths
+    // are replayed with
+    void set_pose(const glm::quat &orientation, float radius);
+    inline const glm::quat &get_orientation() const { return orientation; }
+    inline float get_radius() const { return radius; }
+
   private:
     glm::vec3 center;
     glm::quat orientation;
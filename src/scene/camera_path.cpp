@@ -0,0 +1,157 @@
+#include "camera_path.h"
+
+#include "scene/camera.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Radius the scripted paths keep, the camera's own default
+const float path_radius = 3.0f;
+
+// Closest the zoom sweep gets to the volume
+const float zoom_min_radius = 1.0f;
+
+// Width of the slab the slicing sweep leaves of the volume
+const float slab_width = 0.25f;
+
+glm::quat get_default_orientation();
+
+Vol::Scene::CameraPath Vol::Scene::CameraPath::orbit(size_t frame_count)
+{
+    CameraPath path;
+    glm::quat start = get_default_orientation();
+    for (size_t i = 0; i < frame_count; i++) {
+        float angle = 2.0f * std::numbers::pi_v<float> * i / frame_count;
+        glm::quat yaw = glm::angleAxis(angle, glm::vec3(0.0f, 0.0f, 1.0f));
+        path.append(
+            CameraPathFrame{.orientation = yaw * start, .radius = path_radius});
+    }
+    return path;
+}
+
+Vol::Scene::CameraPath Vol::Scene::CameraPath::zoom_sweep(size_t frame_count)
+{
+    CameraPath path;
+    glm::quat orientation = get_default_orientation();
+    for (size_t i = 0; i < frame_count; i++) {
+        // Cosine ease from the path radius in and back out
+        float t = static_cast<float>(i) / frame_count;
+        float closeness =
+            0.5f - 0.5f * std::cos(2.0f * std::numbers::pi_v<float> * t);
+        float radius =
+            path_radius + (zoom_min_radius - path_radius) * closeness;
+        path.append(
+            CameraPathFrame{.orientation = orientation, .radius = radius});
+    }
+    return path;
+}
+
+Vol::Scene::CameraPath Vol::Scene::CameraPath::slicing_sweep(
+    size_t frame_count)
+{
+    CameraPath path;
+    glm::quat orientation = get_default_orientation();
+    for (size_t i = 0; i < frame_count; i++) {
+        // Every axis takes a third of the frames
+        size_t axis = std::min<size_t>(i * 3 / frame_count, 2);
+        float t = static_cast<float>(i * 3 - axis * frame_count) / frame_count;
+
+        CameraPathFrame frame{
+            .orientation = orientation,
+            .radius = path_radius,
+        };
+        frame.min_slice[axis] = t * (1.0f - slab_width);
+        frame.max_slice[axis] = frame.min_slice[axis] + slab_width;
+        path.append(frame);
+    }
+    return path;
+}
+
+Vol::Scene::CameraPath Vol::Scene::CameraPath::load(
+    const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open camera path");
+    }
+
+    CameraPath camera_path;
+    std::string line;
+    while (std::getline(file, line)) {
+        // Skip blank lines and comments
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        CameraPathFrame frame{};
+        stream >> frame.orientation.w >> frame.orientation.x >>
+            frame.orientation.y >> frame.orientation.z >> frame.radius;
+        if (!stream) {
+            throw std::runtime_error("Failed to parse camera path");
+        }
+
+        // Slicing is optional, frames without it see the whole volume
+        glm::vec3 min_slice, max_slice;
+        if (stream >> min_slice.x >> min_slice.y >> min_slice.z >>
+            max_slice.x >> max_slice.y >> max_slice.z) {
+            frame.min_slice = min_slice;
+            frame.max_slice = max_slice;
+        } else {
+            frame.min_slice = glm::vec3(0.0f);
+            frame.max_slice = glm::vec3(1.0f);
+        }
+        camera_path.append(frame);
+    }
+
+    if (camera_path.empty()) {
+        throw std::runtime_error("Camera path has no frames");
+    }
+    return camera_path;
+}
+
+void Vol::Scene::CameraPath::save(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to save camera path");
+    }
+
+    file << "# w x y z radius [min_x min_y min_z max_x max_y max_z]\n";
+    for (const CameraPathFrame &frame : frames) {
+        file << frame.orientation.w << " " << frame.orientation.x << " "
+             << frame.orientation.y << " " << frame.orientation.z << " "
+             << frame.radius << " " << frame.min_slice.x << " "
+             << frame.min_slice.y << " " << frame.min_slice.z << " "
+             << frame.max_slice.x << " " << frame.max_slice.y << " "
+             << frame.max_slice.z << "\n";
+    }
+}
+
+void Vol::Scene::CameraPath::append(const CameraPathFrame &frame)
+{
+    frames.push_back(frame);
+}
+
+void Vol::Scene::CameraPath::append(
+    const Camera &camera,
+    const glm::vec3 &min_slice,
+    const glm::vec3 &max_slice)
+{
+    append(CameraPathFrame{
+        .orientation = camera.get_orientation(),
+        .radius = camera.get_radius(),
+        .min_slice = min_slice,
+        .max_slice = max_slice,
+    });
+}
+
+glm::quat get_default_orientation()
+{
+    return Vol::Scene::Camera().get_orientation();
+}
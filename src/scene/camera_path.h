@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+namespace Vol::Scene
+{
+class Camera;
+}
+
+namespace Vol::Scene
+{
+// Pose of the camera and slicing of the volume in one frame
+struct CameraPathFrame {
+    glm::quat orientation;
+    float radius;
+    glm::vec3 min_slice = glm::vec3(0.0f);
+    glm::vec3 max_slice = glm::vec3(1.0f);
+};
+
+// Frames replayed one after another, either scripted or recorded. Files hold
+// a frame per line, its orientation as w x y z, its radius and optionally its
+// slicing as min x y z and max x y z.
+class CameraPath {
+  public:
+    // One turn around the volume
+    static CameraPath orbit(size_t frame_count);
+
+    // Towards the volume and back out again
+    static CameraPath zoom_sweep(size_t frame_count);
+
+    // Slices swept through the volume along each axis in turn
+    static CameraPath slicing_sweep(size_t frame_count);
+
+    static CameraPath load(const std::filesystem::path &path);
+    void save(const std::filesystem::path &path) const;
+
+    void append(const CameraPathFrame &frame);
+    void append(
+        const Camera &camera,
+        const glm::vec3 &min_slice,
+        const glm::vec3 &max_slice);
+
+    inline size_t size() const { return frames.size(); }
+    inline bool empty() const { return frames.empty(); }
+    inline const CameraPathFrame &operator[](size_t index) const
+    {
+        return frames[index];
+    }
+
+  private:
+    std::vector<CameraPathFrame> frames;
+};
+}  // namespace Vol::Scene
\ No newline at end of file
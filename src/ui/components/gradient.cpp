@@ -6,10 +6,17 @@
 #include <algorithm>
 #include <cmath>
 #include <format>
+#include <fstream>
 #include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 using namespace Vol::UI::Components;
 
+// Ratio to the tallest column below which histogram columns flatten out
+const float histogram_log_scale = 1000.0f;
+
 template <typename T>
 static T lerp(T a, T b, float t)
 {
@@ -69,6 +76,61 @@ Vol::UI::Components::Gradient::Gradient()
 {
 }
 
+Vol::UI::Components::Gradient Vol::UI::Components::Gradient::load(
+    const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open transfer function");
+    }
+
+    // Every line holds a color and an alpha marker at the same location
+    Gradient gradient;
+    gradient.color_markers.clear();
+    gradient.alpha_markers.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        float location, alpha;
+        glm::vec3 color;
+        if (!(stream >> location >> color.r >> color.g >> color.b >> alpha)) {
+            throw std::runtime_error("Failed to parse transfer function");
+        }
+        location = std::clamp(location, 0.0f, 1.0f);
+        gradient.color_markers.push_back({location, color});
+        gradient.alpha_markers.push_back({location, alpha});
+    }
+
+    if (gradient.color_markers.empty()) {
+        throw std::runtime_error("Transfer function has no markers");
+    }
+
+    // The editor keeps a marker at either end of the gradient
+    std::stable_sort(
+        gradient.color_markers.begin(), gradient.color_markers.end());
+    std::stable_sort(
+        gradient.alpha_markers.begin(), gradient.alpha_markers.end());
+    if (gradient.color_markers.front().location > 0.0f) {
+        gradient.color_markers.insert(
+            gradient.color_markers.begin(),
+            {0.0f, gradient.color_markers.front().value});
+        gradient.alpha_markers.insert(
+            gradient.alpha_markers.begin(),
+            {0.0f, gradient.alpha_markers.front().value});
+    }
+    if (gradient.color_markers.back().location < 1.0f) {
+        gradient.color_markers.push_back(
+            {1.0f, gradient.color_markers.back().value});
+        gradient.alpha_markers.push_back(
+            {1.0f, gradient.alpha_markers.back().value});
+    }
+    return gradient;
+}
+
 glm::vec3 Vol::UI::Components::Gradient::sample_color(float location)
 {
     return sample_markers(color_markers, location);
@@ -135,7 +197,8 @@ bool Vol::UI::Components::gradient_edit(
     const char *str_id,
     Gradient &gradient,
     GradientEditState &state,
-    std::string &status_text)
+    std::string &status_text,
+    std::span<const float> histogram)
 {
     bool changed = false;
 
@@ -261,6 +324,26 @@ bool Vol::UI::Components::gradient_edit(
                     bar_origin.x + t2 * bar_size.x, bar_origin.y + bar_size.y),
                 c1_u32, c2_u32, c2_u32, c1_u32);
         }
+
+        // Draw histogram, scaled logarithmically so sparse values still show
+        float tallest = 0.0f;
+        for (float column : histogram) {
+            tallest = std::max(tallest, column);
+        }
+        float column_width = bar_size.x / histogram.size();
+        for (size_t i = 0; i < histogram.size() && tallest > 0.0f; i++) {
+            float height =
+                std::log1p(histogram[i] / tallest * histogram_log_scale) /
+                std::log1p(histogram_log_scale) * bar_size.y;
+            draw_list->AddRectFilled(
+                ImVec2(
+                    bar_origin.x + i * column_width,
+                    bar_origin.y + bar_size.y - height),
+                ImVec2(
+                    bar_origin.x + (i + 1) * column_width,
+                    bar_origin.y + bar_size.y),
+                IM_COL32(255, 255, 255, 64));
+        }
     }
 
     ImGui::PopStyleVar();
@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 #include <imgui.h>
 
+#include <filesystem>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -23,6 +25,10 @@ struct Gradient {
 
     explicit Gradient();
 
+    // Markers from a file with a line of location, red, green, blue and
+    // alpha for every pair of color and alpha marker
+    static Gradient load(const std::filesystem::path &path);
+
     glm::vec3 sample_color(float location);
     float sample_alpha(float location);
     glm::vec4 sample(float location);
@@ -64,9 +70,12 @@ struct GradientEditState {
     bool dragging = false;
 };
 
+// A histogram, given as the height of equally wide columns across the bar, is
+// drawn over the gradient
 bool gradient_edit(
     const char *str_id,
     Gradient &gradient,
     GradientEditState &state,
-    std::string &status_text);
+    std::string &status_text,
+    std::span<const float> histogram = {});
 }  // namespace Vol::UI::Components
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "imgui_context.h"
 
 #include "application.h"
+#include "rendering/deletion_queue.h"
 #include "rendering/main_pass.h"
 #include "rendering/offscreen_pass.h"
 #include "rendering/util.h"
@@ -60,15 +61,19 @@ void Vol::UI::ImGuiContext::recreate_viewport_texture(
         return;
     }
 
-    vulkan_context->wait_till_idle();
-
-    ImGui_ImplVulkan_RemoveTexture(descriptor);
-
     Vol::Rendering::OffscreenPass *const offscreen_pass =
         Application::main().get_vulkan_context().get_offscreen_pass();
 
-    offscreen_pass->framebuffer_size_changed(width, height);
+    // The texture only changes once the attachments had to grow
+    if (!offscreen_pass->framebuffer_size_changed(width, height)) {
+        return;
+    }
 
+    // Frames in flight may still draw the old texture
+    Application::main().get_vulkan_context().get_deletion_queue()->retire(
+        [descriptor = descriptor]() {
+            ImGui_ImplVulkan_RemoveTexture(descriptor);
+        });
     descriptor = ImGui_ImplVulkan_AddTexture(
         offscreen_pass->get_sampler(), offscreen_pass->get_image_view(),
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -79,15 +84,18 @@ void Vol::UI::ImGuiContext::init_backends(SDL_Window *window)
     // Initialize ImGui for SDL3
     ImGui_ImplSDL3_InitForVulkan(window);
 
-    // Initialize ImGui for Vulkan
+    // Initialize ImGui for Vulkan. Besides the font and the viewport, the
+    // pool holds the viewport textures retired while frames in flight may
+    // still draw them.
+    uint32_t texture_count = 2 + Vol::Rendering::MAX_FRAMES_IN_FLIGHT;
     VkDescriptorPoolSize pool_sizes[] = {
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, texture_count},
     };
 
     VkDescriptorPoolCreateInfo pool_create_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets = 2,
+        .maxSets = texture_count,
         .poolSizeCount = std::size(pool_sizes),
         .pPoolSizes = pool_sizes,
     };
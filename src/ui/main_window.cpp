@@ -2,8 +2,11 @@
 
 #include "application.h"
 #include "data/file_parser.h"
+#include "data/histogram.h"
 #include "data/importer.h"
 #include "imgui_context.h"
+#include "rendering/gpu_profiler.h"
+#include "rendering/memory_allocator.h"
 #include "rendering/offscreen_pass.h"
 #include "rendering/vulkan_context.h"
 #include "scene/scene.h"
@@ -17,12 +20,17 @@
 #include <imgui_internal.h>
 #include <nfd.h>
 
+#include <format>
+#include <string>
+
 void Vol::UI::MainWindow::update()
 {
     // Update content
     update_main_menu_bar();
     update_status_bar();
     update_main_window();
+    update_profiler();
+    update_memory();
 }
 
 void Vol::UI::MainWindow::update_main_menu_bar()
@@ -34,8 +42,9 @@ void Vol::UI::MainWindow::update_main_menu_bar()
         ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(4.0f, 4.0f));
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(8.0f, 8.0f));
         if (ImGui::BeginMenu("File")) {
-            // Open file menu item
-            if (ImGui::BeginMenu("Import")) {
+            // Open file menu item, one import runs at a time
+            bool importing = Application::main().get_importer().is_importing();
+            if (ImGui::BeginMenu("Import", !importing)) {
                 if (ImGui::MenuItem("Nearly Raw Raster Data (.nrrd, .nhdr)")) {
                     Application::main().get_importer().import(
                         Vol::Data::FileFormat::Nrrd);
@@ -66,6 +75,12 @@ void Vol::UI::MainWindow::update_main_menu_bar()
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("View")) {
+            ImGui::MenuItem("Profiler", nullptr, &show_profiler);
+            set_status_text_on_hover(
+                "Show the time frames take on the graphics device");
+            ImGui::MenuItem("Memory", nullptr, &show_memory);
+            set_status_text_on_hover(
+                "Show how memory of the graphics device is allocated");
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Help")) {
@@ -90,6 +105,8 @@ void Vol::UI::MainWindow::update_status_bar()
         ImGui::AlignTextToFramePadding();
         ImGui::Text(status_text.c_str());
 
+        update_import_progress();
+
         ImGui::SameLine();
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 0.0f));
 
@@ -111,6 +128,53 @@ void Vol::UI::MainWindow::update_status_bar()
     status_text = "";
 }
 
+void Vol::UI::MainWindow::update_import_progress()
+{
+    Vol::Data::Importer &importer = Application::main().get_importer();
+    if (!importer.is_importing()) {
+        return;
+    }
+
+    // Describe the current stage, totals of zero are unknown
+    const Vol::Data::ImportProgress &progress = importer.get_progress();
+    float fraction = 0.0f;
+    std::string progress_text;
+    if (progress.stage == Vol::Data::ImportStage::Parsing) {
+        size_t bytes_total = progress.bytes_total;
+        uint32_t slices_total = progress.slices_total;
+        if (slices_total > 0) {
+            fraction = static_cast<float>(progress.slices_parsed) /
+                       static_cast<float>(slices_total);
+        }
+        progress_text = std::format(
+            "Parsing {:.1f} MB", progress.bytes_read / 1e6);
+        if (bytes_total > 0) {
+            progress_text += std::format(" of {:.1f} MB", bytes_total / 1e6);
+        }
+        if (slices_total > 0) {
+            progress_text += std::format(
+                ", slice {} of {}", progress.slices_parsed.load(),
+                slices_total);
+        }
+    } else if (progress.stage == Vol::Data::ImportStage::Uploading) {
+        fraction = progress.upload;
+        progress_text = std::format("Uploading {:.0f}%", fraction * 100.0f);
+    } else {
+        fraction = progress.transfer;
+        progress_text = std::format("Transferring {:.0f}%", fraction * 100.0f);
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(ImGui::GetFontSize() * 20.0f);
+    ImGui::ProgressBar(fraction, ImVec2(0.0f, 0.0f), progress_text.c_str());
+
+    ImGui::SameLine();
+    if (ImGui::Button("Cancel")) {
+        importer.cancel();
+    }
+    set_status_text_on_hover("Cancel the running import");
+}
+
 void Vol::UI::MainWindow::update_main_window()
 {
     // Create main window
@@ -155,14 +219,16 @@ void Vol::UI::MainWindow::update_viewport()
             context.recreate_viewport_texture(width, height);
         }
 
-        // Draw scene as image
+        // Draw scene as image, which covers a corner of the texture
         ImTextureID texture =
             static_cast<ImTextureID>(context.get_descriptor());
+        glm::vec2 region =
+            app.get_vulkan_context().get_offscreen_pass()->get_image_region();
         ImGuiStyle &style = ImGui::GetStyle();
         Components::image_rounded(
-            texture, scene_window_size, ImVec2(0.0f, 0.0f), ImVec2(1.0f, 1.0f),
-            ImVec4(1.0f, 1.0f, 1.0f, 1.0f), ImVec4(0.0f, 0.0f, 0.0f, 0.0f),
-            style.ChildRounding);
+            texture, scene_window_size, ImVec2(0.0f, 0.0f),
+            ImVec2(region.x, region.y), ImVec4(1.0f, 1.0f, 1.0f, 1.0f),
+            ImVec4(0.0f, 0.0f, 0.0f, 0.0f), style.ChildRounding);
 
         // Update viewport camera
         glm::vec2 min_bound(scene_window_pos.x, scene_window_pos.y);
@@ -202,6 +268,27 @@ void Vol::UI::MainWindow::update_controls()
             Components::attribute_float(
                 "Contrast", &contrast, 0.0f, 100.0f,
                 "Adjust visualization contrast", status_text);
+
+            static float sampling_rate = 1.0f;
+            if (Components::attribute_float(
+                    "Sampling", &sampling_rate, 0.25f, 4.0f,
+                    "Adjust samples taken per voxel", status_text, "%.2f")) {
+                Application::main()
+                    .get_vulkan_context()
+                    .get_offscreen_pass()
+                    ->sampling_rate_changed(sampling_rate);
+            }
+
+            static float frame_time = 16.6f;
+            if (Components::attribute_float(
+                    "Frame time", &frame_time, 4.0f, 100.0f,
+                    "Adjust the frame time kept while moving the camera",
+                    status_text, "%.1f ms")) {
+                Application::main()
+                    .get_vulkan_context()
+                    .get_offscreen_pass()
+                    ->frame_time_target_changed(frame_time);
+            }
         }
         ImGui::EndTable();
 
@@ -245,15 +332,24 @@ void Vol::UI::MainWindow::update_controls()
 
         heading("Transfer function");
 
+        // The gradient spans the density window, so does the histogram
+        constexpr size_t histogram_columns = 128;
+        Rendering::OffscreenPass *offscreen_pass =
+            Application::main().get_vulkan_context().get_offscreen_pass();
+        std::vector<float> histogram;
+        if (auto volume_histogram = offscreen_pass->get_histogram()) {
+            auto [min, max] = volume_histogram->get_window();
+            histogram =
+                volume_histogram->resample(min, max, histogram_columns);
+        }
+
         static Components::Gradient gradient;
         static Components::GradientEditState gradient_state;
         if (Components::gradient_edit(
-                "transfer_func", gradient, gradient_state, status_text)) {
+                "transfer_func", gradient, gradient_state, status_text,
+                histogram)) {
             std::vector<uint32_t> gradient_data = gradient.discretize(256);
-            Application::main()
-                .get_vulkan_context()
-                .get_offscreen_pass()
-                ->transfer_function_changed(gradient_data);
+            offscreen_pass->transfer_function_changed(gradient_data);
         }
     }
 
@@ -264,6 +360,138 @@ void Vol::UI::MainWindow::update_controls()
     ImGui::PopStyleVar();
 }
 
+void Vol::UI::MainWindow::update_profiler()
+{
+    if (!show_profiler) {
+        return;
+    }
+
+    // Begin window
+    ImGui::SetNextWindowSize(ImVec2(360.0f, 0.0f), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Profiler", &show_profiler)) {
+        Rendering::GpuProfiler *profiler =
+            Application::main().get_vulkan_context().get_profiler();
+
+        if (!profiler->is_supported()) {
+            ImGui::TextWrapped("The graphics device can't time frames");
+        }
+
+        // Statistics over the last frames every scope was timed in
+        if (ImGui::BeginTable("profiler_scopes", 5)) {
+            ImGui::TableSetupColumn("Scope");
+            ImGui::TableSetupColumn("Min");
+            ImGui::TableSetupColumn("Avg");
+            ImGui::TableSetupColumn("P95");
+            ImGui::TableSetupColumn("Max");
+            ImGui::TableHeadersRow();
+
+            for (size_t i = 0; i < Rendering::gpu_scope_count; i++) {
+                auto scope = static_cast<Rendering::GpuScope>(i);
+                Rendering::GpuScopeStats stats = profiler->get_stats(scope);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text(Rendering::get_gpu_scope_name(scope));
+                for (float time :
+                     {stats.min, stats.average, stats.p95, stats.max}) {
+                    ImGui::TableNextColumn();
+                    ImGui::Text(std::format("{:.2f} ms", time).c_str());
+                }
+            }
+        }
+        ImGui::EndTable();
+
+        // Log every frame to a file for comparing runs
+        if (profiler->is_logging()) {
+            if (ImGui::Button("Stop log")) {
+                profiler->stop_log();
+            }
+        } else if (ImGui::Button("Log to CSV...")) {
+            nfdfilteritem_t filter = {"CSV", "csv"};
+            nfdchar_t *out_path = nullptr;
+            if (NFD_SaveDialog(
+                    &out_path, &filter, 1, nullptr, "gpu_profile.csv") ==
+                NFD_OKAY) {
+                std::filesystem::path path(out_path);
+                NFD_FreePath(out_path);
+                try {
+                    profiler->start_log(path);
+                } catch (std::exception &e) {
+                    Application::main().get_ui().show_error(
+                        "Profiler Error", e.what());
+                }
+            }
+        }
+        set_status_text_on_hover(
+            "Write the time of every frame to a CSV file");
+    }
+    ImGui::End();
+}
+
+void Vol::UI::MainWindow::update_memory()
+{
+    if (!show_memory) {
+        return;
+    }
+
+    // Begin window
+    ImGui::SetNextWindowSize(ImVec2(360.0f, 0.0f), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Memory", &show_memory)) {
+        Rendering::MemoryStats stats = Application::main()
+                                           .get_vulkan_context()
+                                           .get_memory_allocator()
+                                           ->get_stats();
+        auto megabytes = [](VkDeviceSize bytes) {
+            return static_cast<double>(bytes) / (1 << 20);
+        };
+
+        // Blocks resources are sub-allocated from
+        ImGui::Text(std::format(
+                        "Blocks: {} ({:.1f} of {:.1f} MB used)",
+                        stats.block_count, megabytes(stats.used_bytes),
+                        megabytes(stats.block_bytes))
+                        .c_str());
+        ImGui::Text(
+            std::format("Fragmentation: {:.1f}%", stats.fragmentation * 100.0f)
+                .c_str());
+        set_status_text_on_hover(
+            "Share of free memory in blocks that large resources can't use");
+        ImGui::Text(std::format(
+                        "Dedicated: {} ({:.1f} MB)", stats.dedicated_count,
+                        megabytes(stats.dedicated_bytes))
+                        .c_str());
+        ImGui::Text(std::format(
+                        "Allocations: {} of {}", stats.allocation_count,
+                        stats.max_allocation_count)
+                        .c_str());
+        set_status_text_on_hover(
+            "Allocations made of the graphics device and the most it allows");
+
+        // Resources bound per category
+        if (ImGui::BeginTable("memory_categories", 3)) {
+            ImGui::TableSetupColumn("Category");
+            ImGui::TableSetupColumn("Resources");
+            ImGui::TableSetupColumn("Size");
+            ImGui::TableHeadersRow();
+
+            for (size_t i = 0; i < Rendering::memory_category_count; i++) {
+                auto category = static_cast<Rendering::MemoryCategory>(i);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text(Rendering::get_memory_category_name(category));
+                ImGui::TableNextColumn();
+                ImGui::Text(
+                    std::format("{}", stats.category_counts[i]).c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text(
+                    std::format("{:.1f} MB", megabytes(stats.category_bytes[i]))
+                        .c_str());
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
 void Vol::UI::MainWindow::update_viewport_rotation(
     const glm::vec2 &min_bound,
     const glm::vec2 &max_bound)
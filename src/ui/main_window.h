@@ -22,9 +22,12 @@ class MainWindow {
   private:
     void update_main_menu_bar();
     void update_status_bar();
+    void update_import_progress();
     void update_main_window();
     void update_viewport();
     void update_controls();
+    void update_profiler();
+    void update_memory();
 
     void update_viewport_rotation(
         const glm::vec2 &min_bound,
@@ -38,6 +41,8 @@ class MainWindow {
   private:
     std::string status_text = "";
     double framerate = 0.0;
+    bool show_profiler = false;
+    bool show_memory = false;
     glm::u32vec2 current_scene_window_size{};
 };
 }  // namespace Vol::UI
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "data/dataset.h"
+#include "rendering/cpu_raymarcher.h"
+#include "rendering/util.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Opacity of the transfer function's texels, out of 255
+const uint32_t texel_alpha = 128;
+
+// Samples per voxel the ray is marched with. The single voxel spans the
+// volume, so samples are 0.4 apart along the ray and those at 0.4 and 0.8
+// fall inside the slicing box, well clear of its faces.
+const float samples_per_voxel = 2.5f;
+const int sample_count = 2;
+const float slice_margin = 0.1f;
+
+// Pixels may be a step of rounding off, from the half float transfer function
+const int tolerance = 1;
+
+std::shared_ptr<const Vol::Data::Dataset> create_single_voxel();
+std::vector<uint8_t> render_pixel(
+    const Vol::Rendering::CpuRaymarcher &raymarcher,
+    glm::vec3 target);
+bool check_pixel(
+    const char *name,
+    const std::vector<uint8_t> &pixel,
+    glm::vec4 expected);
+
+// Renders one pixel through the middle of a single voxel volume and one past
+// it, and checks both against the device's blend of the ray over the cleared
+// attachment worked out by hand
+int main()
+{
+    // Red at the same opacity everywhere, so every segment of the ray is
+    // classified alike whatever densities it samples
+    uint32_t texel = (texel_alpha << 24) | 0xFF;
+    Vol::Rendering::CpuRaymarcher raymarcher(
+        create_single_voxel(), std::vector<uint32_t>(2, texel));
+    raymarcher.sampling_rate_changed(samples_per_voxel);
+    raymarcher.ray_termination_changed(0.0f);
+
+    // Each sample's opacity is the texel's, corrected for the step taken
+    float alpha = texel_alpha / 255.0f;
+    float step_alpha = 1.0f - std::pow(1.0f - alpha, 1.0f / samples_per_voxel);
+    float ray_alpha = 1.0f - std::pow(1.0f - step_alpha, sample_count);
+    glm::vec4 ray = glm::vec4(ray_alpha, 0.0f, 0.0f, ray_alpha);
+
+    // Blended with the source's alpha over the background
+    glm::vec4 background = Vol::Rendering::background_color;
+    glm::vec4 hit = ray * ray_alpha + background * (1.0f - ray_alpha);
+
+    bool passed = true;
+    passed &= check_pixel(
+        "hit", render_pixel(raymarcher, glm::vec3(0.0f)), hit);
+    passed &= check_pixel(
+        "miss", render_pixel(raymarcher, glm::vec3(0.0f, 0.0f, 4.0f)),
+        background);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+std::shared_ptr<const Vol::Data::Dataset> create_single_voxel()
+{
+    float density = 1.0f;
+    auto dataset = std::make_shared<Vol::Data::Dataset>();
+    dataset->dimensions = glm::u32vec3(1);
+    dataset->type = Vol::Data::VoxelType::Float32;
+    dataset->min = 0.0f;
+    dataset->max = 1.0f;
+    dataset->data.resize(sizeof(density));
+    std::memcpy(dataset->data.data(), &density, sizeof(density));
+    return dataset;
+}
+
+std::vector<uint8_t> render_pixel(
+    const Vol::Rendering::CpuRaymarcher &raymarcher,
+    glm::vec3 target)
+{
+    // The pixel's ray runs from the camera straight at the target
+    glm::vec3 camera_position = glm::vec3(0.0f, 0.0f, 2.0f);
+    Vol::Rendering::CpuView view = {
+        .view = glm::lookAt(camera_position, target, glm::vec3(0, 1, 0)),
+        .proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 10.0f),
+        .camera_position = camera_position,
+        .min_slice = glm::vec3(0.0f, 0.0f, slice_margin),
+        .max_slice = glm::vec3(1.0f, 1.0f, 1.0f - slice_margin),
+    };
+    return raymarcher.render(view, 1, 1);
+}
+
+bool check_pixel(
+    const char *name,
+    const std::vector<uint8_t> &pixel,
+    glm::vec4 expected)
+{
+    bool passed = true;
+    for (int channel = 0; channel < 4; channel++) {
+        int value = static_cast<int>(expected[channel] * 255.0f + 0.5f);
+        if (std::abs(pixel[channel] - value) > tolerance) {
+            passed = false;
+        }
+    }
+    if (!passed) {
+        std::cerr << name << ": got (" << +pixel[0] << ", " << +pixel[1]
+                  << ", " << +pixel[2] << ", " << +pixel[3] << ")"
+                  << ", expected (" << expected.r * 255.0f << ", "
+                  << expected.g * 255.0f << ", " << expected.b * 255.0f
+                  << ", " << expected.a * 255.0f << ")" << std::endl;
+    }
+    return passed;
+}